@@ -0,0 +1,57 @@
+#include "cnn/CNN.h"
+#include "cnn/MNISTReader.h"
+#include "data/AugmentationPipeline.h"
+#include "data/InMemoryDataSource.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include <chrono>
+
+// Compares the throughput of the augmentation pipeline (all transforms enabled) for growing
+// worker counts with the rate at which the default MNIST network trains, to show whether
+// augmentation can keep up.
+
+namespace {
+
+const size_t samples = 20000;
+
+double samplesPerSecond(DataSource& source, size_t count) {
+    auto start = std::chrono::steady_clock::now();
+    source.startEpoch();
+    std::vector<ImageData> batch;
+    size_t seen = 0;
+    while (seen < count && source.nextBatch(batch, 32)) {
+        seen += batch.size();
+    }
+    return seen / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    auto trainDataset = MNISTReader::readMNISTData("../data/train-images.idx3-ubyte", "../data/train-labels.idx1-ubyte");
+    std::vector<ImageData> subset(trainDataset.begin(), trainDataset.begin() + std::min(samples, trainDataset.size()));
+
+    AugmentationConfig config;
+    config.elasticAlpha = 8.0;
+    config.noiseStddev = 0.05;
+
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int workers = 1; workers <= hardwareThreads; workers *= 2) {
+        InMemoryDataSource source(subset);
+        AugmentationPipeline pipeline(source, config, workers, 42);
+        std::cout << "augmentation, " << workers << " workers: " << samplesPerSecond(pipeline, subset.size()) << " samples/s\n";
+    }
+
+    CNN cnn(0.02, {1, 28, 28});
+    cnn.addLayer(std::make_shared<FlattenLayer>());
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(60, std::make_shared<ELU>(1.0)));
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(10, std::make_shared<ELU>(1.0)));
+    cnn.addLayer(std::make_shared<SoftmaxLayer>());
+    auto start = std::chrono::steady_clock::now();
+    cnn.SGD(subset, 1, 32, {});
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "training: " << subset.size() / seconds << " samples/s\n";
+    return 0;
+}
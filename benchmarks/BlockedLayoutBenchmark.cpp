@@ -0,0 +1,55 @@
+#include "cnn/CNN.h"
+#include "layers/ConvolutionalLayer.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/MaxPoolingLayer.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <chrono>
+#include <random>
+
+// Inference time of conv stacks with the nested [channel][row][column] kernels (CNN::forward)
+// versus the channel-blocked kernels (CNN::predict), for growing channel counts.
+
+namespace {
+
+const int iterations = 20;
+
+template <typename Forward>
+double secondsPerImage(Forward forward) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        forward();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> pixel(0.0, 1.0);
+
+    for (int channels : {1, 8, 16, 32}) {
+        CNN cnn(0.02, {channels, 32, 32});
+        cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 32, 1, std::make_shared<ReLU>()));
+        cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 32, 1, std::make_shared<ReLU>()));
+        cnn.addLayer(std::make_shared<MaxPoolingLayer>(2));
+        cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 64, 1, std::make_shared<ReLU>()));
+        cnn.addLayer(std::make_shared<FlattenLayer>());
+
+        std::vector<std::vector<std::vector<double>>> input(channels, std::vector<std::vector<double>>(32, std::vector<double>(32)));
+        for (auto& channel : input) {
+            for (auto& row : channel) {
+                for (auto& value : row) {
+                    value = pixel(gen);
+                }
+            }
+        }
+
+        double nested = secondsPerImage([&] { cnn.forward(input); });
+        double blocked = secondsPerImage([&] { cnn.predict(input); });
+        std::cout << channels << " input channels: nested " << nested * 1000 << " ms, blocked " << blocked * 1000
+                  << " ms (" << nested / blocked << "x)\n";
+    }
+    return 0;
+}
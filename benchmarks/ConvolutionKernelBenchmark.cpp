@@ -0,0 +1,63 @@
+#include "utils/ConvolutionKernels.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// Times the specialized single-channel kernels against the generic one for every specialized
+// filter size and stride, and checks that both produce the same output.
+
+namespace {
+
+const int inputSize = 128;
+const int iterations = 200;
+
+double secondsPerCall(ConvolutionKernels::ChannelKernel kernel, const std::vector<std::vector<double>>& input,
+                      const std::vector<double>& filter, int filterSize, int stride, std::vector<std::vector<double>>& output) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        kernel(input, filter.data(), filterSize, stride, 1, output);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> value(-1.0, 1.0);
+    std::vector<std::vector<double>> input(inputSize, std::vector<double>(inputSize));
+    for (auto& row : input) {
+        for (auto& v : row) {
+            v = value(gen);
+        }
+    }
+
+    for (int filterSize : {1, 3, 5, 7}) {
+        std::vector<double> filter(filterSize * filterSize);
+        for (auto& v : filter) {
+            v = value(gen);
+        }
+
+        for (int stride : {1, 2}) {
+            int outputSize = (inputSize - filterSize) / stride + 1;
+            std::vector<std::vector<double>> genericOutput(outputSize, std::vector<double>(outputSize, 0.0));
+            std::vector<std::vector<double>> specializedOutput = genericOutput;
+            auto kernel = ConvolutionKernels::select(filterSize, stride, 1);
+
+            double genericTime = secondsPerCall(ConvolutionKernels::generic, input, filter, filterSize, stride, genericOutput);
+            double specializedTime = secondsPerCall(kernel, input, filter, filterSize, stride, specializedOutput);
+
+            double maxDifference = 0.0;
+            for (int y = 0; y < outputSize; ++y) {
+                for (int x = 0; x < outputSize; ++x) {
+                    maxDifference = std::max(maxDifference, std::fabs(genericOutput[y][x] - specializedOutput[y][x]));
+                }
+            }
+            std::cout << filterSize << "x" << filterSize << " stride " << stride << ": generic " << genericTime * 1e6
+                      << " us, specialized " << specializedTime * 1e6 << " us (" << genericTime / specializedTime
+                      << "x), max difference " << maxDifference << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "layers/ConvolutionalLayer.h"
+#include "utils/ConvolutionTuner.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+// Times every forward configuration of ConvolutionalLayer for a few layer shapes, then shows the
+// tuner's choice and how long initialize takes with an empty and with a warm tuning cache.
+//   ConvolutionTunerBenchmark [cacheFile]   (default: a fresh file in /tmp, removed at the end)
+
+namespace {
+
+struct Shape {
+    int depth;
+    int size;
+    int filterSize;
+    int numFilters;
+    int stride;
+};
+
+double secondsFor(const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string cachePath = argc > 1 ? argv[1] : "/tmp/CNNcpp-tuner-benchmark.cache";
+    if (argc <= 1) {
+        std::remove(cachePath.c_str());
+    }
+    std::cout << "CPU: " << ConvolutionTuner::cpuModel() << "\n";
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> value(-1.0, 1.0);
+    const std::vector<Shape> shapes = {{1, 28, 5, 8, 1}, {8, 28, 3, 16, 1}, {16, 14, 3, 32, 2}, {32, 14, 1, 64, 1}, {3, 64, 7, 16, 2}};
+
+    for (const auto& shape : shapes) {
+        std::vector<int> inputShape = {shape.depth, shape.size, shape.size};
+        std::vector<std::vector<std::vector<double>>> input(shape.depth, std::vector<std::vector<double>>(shape.size, std::vector<double>(shape.size)));
+        for (auto& channel : input) {
+            for (auto& row : channel) {
+                for (auto& v : row) {
+                    v = value(gen);
+                }
+            }
+        }
+
+        std::cout << shape.depth << "x" << shape.size << "x" << shape.size << " input, " << shape.numFilters << " filters "
+                  << shape.filterSize << "x" << shape.filterSize << " stride " << shape.stride << ":\n";
+
+        ConvolutionTuner::disable();
+        ConvolutionalLayer layer(shape.filterSize, shape.numFilters, shape.stride, std::make_shared<ReLU>());
+        layer.initialize(inputShape);
+        LayerCache cache;
+        std::vector<ConvolutionConfig> configs = {{ConvolutionConfig::Generic, 0}, {ConvolutionConfig::Specialized, 0},
+                                                  {ConvolutionConfig::Im2col, 64}, {ConvolutionConfig::Im2col, 256},
+                                                  {ConvolutionConfig::Blocked, 0}};
+        for (const auto& config : configs) {
+            layer.setForwardConfig(config);
+            double seconds = ConvolutionTuner::secondsPerRun([&] { layer.forward(input, cache); });
+            std::cout << "  " << config.toString() << ": " << seconds * 1e6 << " us\n";
+        }
+
+        ConvolutionTuner::enable(cachePath);
+        ConvolutionalLayer tuned(shape.filterSize, shape.numFilters, shape.stride, std::make_shared<ReLU>());
+        double coldSeconds = secondsFor([&] { tuned.initialize(inputShape); });
+        ConvolutionalLayer cached(shape.filterSize, shape.numFilters, shape.stride, std::make_shared<ReLU>());
+        double warmSeconds = secondsFor([&] { cached.initialize(inputShape); });
+        std::cout << "  tuned: " << tuned.getForwardConfig().toString() << ", initialize " << coldSeconds * 1e3
+                  << " ms tuning, " << warmSeconds * 1e3 << " ms from cache (" << cached.getForwardConfig().toString() << ")\n";
+    }
+
+    if (argc <= 1) {
+        std::remove(cachePath.c_str());
+    }
+    return 0;
+}
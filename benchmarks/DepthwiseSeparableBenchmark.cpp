@@ -0,0 +1,78 @@
+#include "cnn/CNN.h"
+#include "layers/ConvolutionalLayer.h"
+#include "layers/DepthwiseConvolutionalLayer.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <chrono>
+#include <random>
+
+// Parameters, multiply-adds and measured inference time of a dense 3x3 convolution against the
+// depthwise-separable block that replaces it in MobileNet-style models: a 3x3 depthwise
+// convolution followed by a 1x1 pointwise convolution, for the same input and output shapes.
+
+namespace {
+
+const int iterations = 10;
+
+size_t parameterCount(const CNN& cnn) {
+    size_t count = 0;
+    for (size_t l = 0; l < cnn.getLayerCount(); ++l) {
+        if (auto layer = std::dynamic_pointer_cast<ParameterizedLayer>(cnn.getLayer(l))) {
+            count += layer->getParameterCount();
+        }
+    }
+    return count;
+}
+
+double secondsPerImage(const CNN& cnn, const std::vector<std::vector<std::vector<double>>>& input) {
+    CNN::InferenceWorkspace workspace;
+    cnn.predict(input, workspace);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        cnn.predict(input, workspace);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> pixel(0.0, 1.0);
+
+    struct Shape {
+        int inputChannels;
+        int outputChannels;
+        int size;
+    };
+    for (Shape shape : {Shape{32, 64, 56}, Shape{64, 128, 28}, Shape{128, 256, 14}}) {
+        CNN dense(0.01, {shape.inputChannels, shape.size, shape.size});
+        dense.addLayer(std::make_shared<ConvolutionalLayer>(3, shape.outputChannels, 1, std::make_shared<ReLU>()));
+        CNN separable(0.01, {shape.inputChannels, shape.size, shape.size});
+        separable.addLayer(std::make_shared<DepthwiseConvolutionalLayer>(3, 1, std::make_shared<ReLU>()));
+        separable.addLayer(std::make_shared<ConvolutionalLayer>(1, shape.outputChannels, 1, std::make_shared<ReLU>()));
+
+        // Both produce (outputChannels, size - 2, size - 2)
+        double pixels = static_cast<double>(shape.size - 2) * (shape.size - 2);
+        double denseMacs = pixels * shape.outputChannels * shape.inputChannels * 9;
+        double separableMacs = pixels * shape.inputChannels * 9 + pixels * shape.inputChannels * shape.outputChannels;
+        size_t denseParameters = parameterCount(dense);
+        size_t separableParameters = parameterCount(separable);
+
+        std::vector<std::vector<std::vector<double>>> input(shape.inputChannels, std::vector<std::vector<double>>(shape.size, std::vector<double>(shape.size)));
+        for (auto& channel : input) {
+            for (auto& row : channel) {
+                for (auto& value : row) {
+                    value = pixel(gen);
+                }
+            }
+        }
+        double denseSeconds = secondsPerImage(dense, input);
+        double separableSeconds = secondsPerImage(separable, input);
+
+        std::cout << shape.inputChannels << " -> " << shape.outputChannels << " channels at " << shape.size << "x" << shape.size << ": parameters "
+                  << denseParameters << " vs " << separableParameters << " (" << static_cast<double>(denseParameters) / separableParameters
+                  << "x), multiply-adds " << denseMacs / 1e6 << "M vs " << separableMacs / 1e6 << "M (" << denseMacs / separableMacs << "x), "
+                  << denseSeconds * 1000 << " ms vs " << separableSeconds * 1000 << " ms (" << denseSeconds / separableSeconds << "x)\n";
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "cnn/CNN.h"
+#include "cnn/MNISTReader.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include <chrono>
+#include <thread>
+
+// Compares synchronous mini-batch SGD with Hogwild! SGD at growing thread counts:
+// throughput of one epoch (images/sec) and wall-clock time until the test accuracy
+// first reaches the target.
+
+namespace {
+
+const double targetAccuracy = 0.95;
+const int maxEpochs = 10;
+
+CNN buildNetwork() {
+    CNN cnn(0.02, {1, 28, 28});
+    cnn.addLayer(std::make_shared<FlattenLayer>());
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(60, std::make_shared<ELU>(1.0)));
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(10, std::make_shared<ELU>(1.0)));
+    cnn.addLayer(std::make_shared<SoftmaxLayer>());
+    return cnn;
+}
+
+template <typename TrainEpoch>
+void run(const std::string& name, const std::vector<ImageData>& trainData, const std::vector<ImageData>& testData, TrainEpoch trainEpoch) {
+    CNN cnn = buildNetwork();
+    double firstEpochSeconds = 0.0;
+    double elapsed = 0.0;
+    int epoch = 0;
+    double accuracy = 0.0;
+
+    while (epoch < maxEpochs && accuracy < targetAccuracy) {
+        auto start = std::chrono::steady_clock::now();
+        trainEpoch(cnn);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (epoch == 0) {
+            firstEpochSeconds = seconds;
+        }
+        elapsed += seconds;
+        ++epoch;
+        accuracy = static_cast<double>(cnn.evaluate(testData)) / testData.size();
+    }
+
+    std::cout << name << ": " << trainData.size() / firstEpochSeconds << " images/sec, ";
+    if (accuracy >= targetAccuracy) {
+        std::cout << elapsed << " s to " << targetAccuracy * 100 << "% (" << epoch << " epochs)\n";
+    } else {
+        std::cout << "did not reach " << targetAccuracy * 100 << "% in " << maxEpochs << " epochs (" << accuracy * 100 << "%)\n";
+    }
+}
+
+} // namespace
+
+int main() {
+    auto trainDataset = MNISTReader::readMNISTData("../data/train-images.idx3-ubyte", "../data/train-labels.idx1-ubyte");
+    auto testDataset = MNISTReader::readMNISTData("../data/t10k-images.idx3-ubyte", "../data/t10k-labels.idx1-ubyte");
+    const std::vector<ImageData> noTestData;
+
+    run("SGD (mini-batch 32)", trainDataset, testDataset, [&](CNN& cnn) {
+        cnn.SGD(trainDataset, 1, 32, noTestData);
+    });
+
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        run("Hogwild (" + std::to_string(threads) + " threads)", trainDataset, testDataset, [&](CNN& cnn) {
+            cnn.SGDHogwild(trainDataset, 1, threads, noTestData);
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "cnn/HyperparameterSweep.h"
+#include "cnn/MNISTReader.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include <chrono>
+#include <thread>
+
+// Runs one grid over learning rate, mini-batch size and hidden layer widths on a slice of MNIST
+// three ways: one trial at a time without early stopping (like a process per configuration),
+// all trials concurrently, and concurrently with the median stopping rule. Reports wall-clock
+// time, the trial epochs trained and the best validation accuracy found.
+
+namespace {
+
+const size_t trainingSamples = 10000;
+const size_t validationSamples = 2000;
+
+CNN buildNetwork(const HyperparameterConfig& config) {
+    CNN cnn(config.learningRate, {1, 28, 28});
+    cnn.addLayer(std::make_shared<FlattenLayer>());
+    for (int width : config.layerWidths) {
+        cnn.addLayer(std::make_shared<FullyConnectedLayer>(width, std::make_shared<ELU>(1.0)));
+    }
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(10, std::make_shared<ELU>(1.0)));
+    cnn.addLayer(std::make_shared<SoftmaxLayer>());
+    return cnn;
+}
+
+void run(const std::string& name, HyperparameterSweep& sweep, const std::vector<HyperparameterConfig>& configs, const SweepOptions& options,
+         std::ostream& summary) {
+    auto start = std::chrono::steady_clock::now();
+    SweepResult result = sweep.run(configs, options);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t epochs = 0;
+    size_t stopped = 0;
+    for (const auto& trial : result.trials) {
+        epochs += trial.accuracies.size();
+        stopped += trial.stoppedEarly ? 1 : 0;
+    }
+    summary << name << ": " << seconds << " s, " << epochs << " trial epochs (" << stopped << " trials stopped early), "
+            << configs.size() * 3600.0 / seconds << " configurations/hour, best " << result.trials[result.bestTrial].bestAccuracy() * 100 << "%\n";
+}
+
+} // namespace
+
+int main() {
+    auto trainDataset = MNISTReader::readMNISTData("../data/train-images.idx3-ubyte", "../data/train-labels.idx1-ubyte");
+    auto testDataset = MNISTReader::readMNISTData("../data/t10k-images.idx3-ubyte", "../data/t10k-labels.idx1-ubyte");
+    trainDataset.erase(trainDataset.begin() + std::min(trainDataset.size(), trainingSamples), trainDataset.end());
+    testDataset.erase(testDataset.begin() + std::min(testDataset.size(), validationSamples), testDataset.end());
+
+    HyperparameterSweep sweep(trainDataset, testDataset, buildNetwork);
+    auto configs = HyperparameterSweep::grid({0.002, 0.02, 0.2}, {16, 64}, {{30}, {100}});
+
+    std::ostringstream summary;
+    SweepOptions options;
+    options.epochs = 5;
+
+    options.numWorkers = 1;
+    options.minPeers = 0;
+    run("sequential", sweep, configs, options, summary);
+
+    options.numWorkers = std::max(1u, std::thread::hardware_concurrency());
+    run("concurrent (" + std::to_string(options.numWorkers) + " workers)", sweep, configs, options, summary);
+
+    options.minPeers = 2;
+    run("concurrent with early stopping", sweep, configs, options, summary);
+
+    std::cout << summary.str();
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "cnn/CNN.h"
+#include "cnn/MNISTReader.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include <chrono>
+
+// Trains the same MNIST network in full precision and in bfloat16 mixed precision and
+// reports the test accuracy after each epoch and the training time per epoch.
+
+namespace {
+
+const int epochs = 5;
+
+void run(const std::string& name, bool mixedPrecision, const std::vector<ImageData>& trainData, const std::vector<ImageData>& testData) {
+    CNN cnn(0.02, {1, 28, 28});
+    cnn.addLayer(std::make_shared<FlattenLayer>());
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(300, std::make_shared<ELU>(1.0)));
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(100, std::make_shared<ELU>(1.0)));
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(10, std::make_shared<ELU>(1.0)));
+    cnn.addLayer(std::make_shared<SoftmaxLayer>());
+    cnn.setMixedPrecision(mixedPrecision);
+
+    const std::vector<ImageData> noTestData;
+    for (int epoch = 1; epoch <= epochs; ++epoch) {
+        auto start = std::chrono::steady_clock::now();
+        cnn.SGD(trainData, 1, 32, noTestData);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double accuracy = static_cast<double>(cnn.evaluate(testData)) / testData.size();
+        std::cout << name << " epoch " << epoch << ": " << accuracy * 100 << "% (" << seconds << " s)\n";
+    }
+}
+
+} // namespace
+
+int main() {
+    auto trainDataset = MNISTReader::readMNISTData("../data/train-images.idx3-ubyte", "../data/train-labels.idx1-ubyte");
+    auto testDataset = MNISTReader::readMNISTData("../data/t10k-images.idx3-ubyte", "../data/t10k-labels.idx1-ubyte");
+
+    run("fp64", false, trainDataset, testDataset);
+    run("bf16 mixed", true, trainDataset, testDataset);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "cnn/CNN.h"
+#include "cnn/LayerPipeline.h"
+#include "layers/ConvolutionalLayer.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/MaxPoolingLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <chrono>
+#include <random>
+
+// Throughput of pipeline-parallel stages against running all layers in sequence, for inference
+// and GPipe training, with the measured bubble (share of stage time spent idle) next to the
+// GPipe estimate (S - 1) / (M + S - 1) for S stages and M micro-batches per mini-batch.
+
+namespace {
+
+using Tensor = std::vector<std::vector<std::vector<double>>>;
+
+const int samples = 256;
+const int miniBatchSize = 32;
+
+CNN buildNetwork() {
+    CNN cnn(0.01, {3, 32, 32});
+    cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 16, 1, ConvolutionalLayer::SamePadding, 1, 1, std::make_shared<ReLU>()));
+    cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 16, 1, ConvolutionalLayer::SamePadding, 1, 1, std::make_shared<ReLU>()));
+    cnn.addLayer(std::make_shared<MaxPoolingLayer>(2));
+    cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 32, 1, ConvolutionalLayer::SamePadding, 1, 1, std::make_shared<ReLU>()));
+    cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 32, 1, ConvolutionalLayer::SamePadding, 1, 1, std::make_shared<ReLU>()));
+    cnn.addLayer(std::make_shared<MaxPoolingLayer>(2));
+    cnn.addLayer(std::make_shared<FlattenLayer>());
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(128, std::make_shared<ReLU>()));
+    cnn.addLayer(std::make_shared<FullyConnectedLayer>(10, std::make_shared<ReLU>()));
+    cnn.addLayer(std::make_shared<SoftmaxLayer>());
+    return cnn;
+}
+
+double secondsFor(const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> pixel(0.0, 1.0);
+    std::vector<Tensor> inputs;
+    std::vector<ImageData> trainingData;
+    for (int k = 0; k < samples; ++k) {
+        Tensor image(3, std::vector<std::vector<double>>(32, std::vector<double>(32)));
+        for (auto& channel : image) {
+            for (auto& row : channel) {
+                for (auto& value : row) {
+                    value = pixel(gen);
+                }
+            }
+        }
+        std::vector<double> label(10, 0.0);
+        label[k % 10] = 1.0;
+        inputs.push_back(image);
+        trainingData.emplace_back(image, label);
+    }
+
+    CNN cnn = buildNetwork();
+    double sequentialInference = secondsFor([&] { cnn.forwardPipelined(inputs); });
+    double sequentialTraining = secondsFor([&] { cnn.SGD(trainingData, 1, miniBatchSize, {}); });
+    std::cout << "sequential: inference " << samples / sequentialInference << " images/s, training "
+              << samples / sequentialTraining << " samples/s\n";
+
+    for (int stages : {2, 4}) {
+        for (int microBatchSize : {1, 4, 8}) {
+            cnn.setPipelineStages(stages, microBatchSize);
+            double inference = secondsFor([&] { cnn.forwardPipelined(inputs); });
+            double inferenceBubble = cnn.getPipeline()->getLastStats().bubbleFraction();
+            double training = secondsFor([&] { cnn.SGD(trainingData, 1, miniBatchSize, {}); });
+            double trainingBubble = cnn.getPipeline()->getLastStats().bubbleFraction();
+            int microBatches = (miniBatchSize + microBatchSize - 1) / microBatchSize;
+            double gpipeBubble = static_cast<double>(stages - 1) / (microBatches + stages - 1);
+
+            std::cout << stages << " stages, micro-batch " << microBatchSize << ": inference " << samples / inference
+                      << " images/s (" << sequentialInference / inference << "x, bubble " << inferenceBubble * 100
+                      << "%), training " << samples / training << " samples/s (" << sequentialTraining / training
+                      << "x, bubble " << trainingBubble * 100 << "%, GPipe estimate " << gpipeBubble * 100 << "%)\n";
+        }
+    }
+    return 0;
+}
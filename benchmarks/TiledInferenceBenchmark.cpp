@@ -0,0 +1,81 @@
+#include "cnn/CNN.h"
+#include "layers/ConvolutionalLayer.h"
+#include "layers/MaxPoolingLayer.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <sys/resource.h>
+
+// Tiled inference of a fully convolutional network on growing single-channel "document" images.
+// The input is generated and the output consumed tile by tile, so neither is ever held whole:
+// the peak resident size stays flat while the image grows. For the smallest image the tiled
+// output is compared with a whole-image CNN::forward.
+
+namespace {
+
+using Tensor = std::vector<std::vector<std::vector<double>>>;
+
+double pixelAt(int y, int x) {
+    return 0.5 + 0.5 * std::sin(0.05 * y) * std::cos(0.07 * x);
+}
+
+double peakResidentMegabytes() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+} // namespace
+
+int main() {
+    CNN cnn(0.02, {1, 256, 256});
+    cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 16, 1, ConvolutionalLayer::SamePadding, 1, 1, std::make_shared<ReLU>()));
+    cnn.addLayer(std::make_shared<MaxPoolingLayer>(2));
+    cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 32, 1, ConvolutionalLayer::SamePadding, 1, 1, std::make_shared<ReLU>()));
+    cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 32, 1, 2, 2, 1, std::make_shared<ReLU>()));
+    cnn.addLayer(std::make_shared<ConvolutionalLayer>(1, 4, 1, std::make_shared<ReLU>()));
+
+    auto readTile = [](int y, int x, int height, int width, Tensor& tile) {
+        tile.assign(1, std::vector<std::vector<double>>(height, std::vector<double>(width)));
+        for (int i = 0; i < height; ++i) {
+            for (int j = 0; j < width; ++j) {
+                tile[0][i][j] = pixelAt(y + i, x + j);
+            }
+        }
+    };
+
+    for (int height : {600, 1200, 2400}) {
+        int width = height * 3 / 4;
+        std::atomic<long> pixels(0);
+        auto start = std::chrono::steady_clock::now();
+        cnn.forwardTiled(height, width, readTile, [&](int, int, const Tensor& tile) {
+            pixels += static_cast<long>(tile[0].size() * tile[0][0].size());
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << height << "x" << width << ": tiled " << seconds * 1000 << " ms, " << pixels << " output pixels, peak RSS "
+                  << peakResidentMegabytes() << " MB\n";
+    }
+
+    Tensor image;
+    readTile(0, 0, 600, 450, image);
+    auto start = std::chrono::steady_clock::now();
+    auto whole = cnn.forward(image);
+    double wholeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto tiled = cnn.forwardTiled(image);
+    double maxDifference = 0.0;
+    for (size_t d = 0; d < whole.size(); ++d) {
+        for (size_t i = 0; i < whole[d].size(); ++i) {
+            for (size_t j = 0; j < whole[d][i].size(); ++j) {
+                maxDifference = std::max(maxDifference, std::fabs(whole[d][i][j] - tiled[d][i][j]));
+            }
+        }
+    }
+    std::cout << "600x450 whole image: " << wholeSeconds * 1000 << " ms, peak RSS " << peakResidentMegabytes()
+              << " MB, max difference to tiled " << maxDifference << "\n";
+    return 0;
+}
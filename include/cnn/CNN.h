@@ -4,6 +4,10 @@
 #include "interfaces/Layer.h"
 #include "interfaces/AdaptiveLayer.h"
 #include "interfaces/ParameterizedLayer.h"
+#include "interfaces/BatchLayer.h"
+#include "interfaces/BlockedLayer.h"
+#include "interfaces/DataSource.h"
+#include "interfaces/SpatialLayer.h"
 #include "utils/ImageData.h"
 #include <vector>
 #include <string>
@@ -13,6 +17,12 @@
 #include <fstream>
 #include <sstream>
 #include <initializer_list>
+#include <atomic>
+#include <functional>
+
+class GradientSynchronizer;
+class LayerPipeline;
+class ParameterStore;
 
 class CNN {
 public:
@@ -21,23 +31,126 @@ public:
     void addLayer(std::shared_ptr<Layer> layer);
     std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input);
     std::vector<std::vector<std::vector<double>>> backward(const std::vector<std::vector<std::vector<double>>>& gradient);
+    // Scratch memory for the const inference calls below: a workspace for every layer plus the
+    // channel-blocked buffers. Each thread keeps its own and reuses it across calls.
+    struct InferenceWorkspace {
+        std::vector<LayerCache> caches;
+        std::vector<BlockedTensor> blocked;
+        BlockedTensor next;
+    };
+
+    // Inference over several inputs, run layer by layer so each layer's weights stay hot across
+    // the batch. Consecutive BlockedLayers run in the channel-blocked layout, converted only at the
+    // start and end of each such run. The network is only read, so any number of threads can run
+    // inference on one instance at once, each with its own workspace.
+    std::vector<std::vector<std::vector<std::vector<double>>>> forwardBatch(const std::vector<std::vector<std::vector<std::vector<double>>>>& inputs, InferenceWorkspace& workspace) const;
+    // Inference for one input through the same path as forwardBatch.
+    std::vector<std::vector<std::vector<double>>> predict(const std::vector<std::vector<std::vector<double>>>& input, InferenceWorkspace& workspace) const;
+    // Same with a temporary workspace.
+    std::vector<std::vector<std::vector<double>>> predict(const std::vector<std::vector<std::vector<double>>>& input) const;
+
+    // Image access for forwardTiled. A TileReader fills tile with every channel of input rows
+    // [y, y + height) and columns [x, x + width), which always lie inside the image; a TileWriter
+    // receives the output pixels starting at row y and column x. Both are called concurrently from
+    // several threads, for disjoint tiles.
+    using TileReader = std::function<void(int y, int x, int height, int width, std::vector<std::vector<std::vector<double>>>& tile)>;
+    using TileWriter = std::function<void(int y, int x, const std::vector<std::vector<std::vector<double>>>& tile)>;
+    // Roughly what fits in a per-core L2 cache
+    static constexpr size_t DefaultTileBytes = 1 << 20;
+
+    // Inference for a fully convolutional network (only SpatialLayers) on an image of any height
+    // and width. The output is split into tiles whose largest layer input and output fit in about
+    // tileBytes; each tile reads the overlapping input region its receptive field needs and the
+    // tiles run in parallel. The result matches running the whole image at once, and the working
+    // memory is bounded by the tile size and thread count rather than the image size.
+    void forwardTiled(int height, int width, const TileReader& readTile, const TileWriter& writeTile, size_t tileBytes = DefaultTileBytes) const;
+    // Same for an image held in memory; returns the whole output.
+    std::vector<std::vector<std::vector<double>>> forwardTiled(const std::vector<std::vector<std::vector<double>>>& input, size_t tileBytes = DefaultTileBytes) const;
+    // (depth, height, width) of forwardTiled's output for an image of the given size.
+    std::vector<int> getTiledOutputShape(int height, int width) const;
+    // Both sweep the network's contiguous parameter store once rather than visiting each layer.
     void updateParameters(int miniBatchSize);
     void resetGradients();
     void SGD(const std::vector<ImageData>& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData, const std::string& saveFilePath);
     void SGD(const std::vector<ImageData>& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData);
-    int evaluate(const std::vector<ImageData>& testData);
+    // Same as above with the training samples pulled from a DataSource, e.g. an AugmentationPipeline.
+    void SGD(DataSource& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData, const std::string& saveFilePath);
+    void SGD(DataSource& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData);
+    // When enabled, SGD evaluates a snapshot of the parameters taken at each epoch boundary on a
+    // background thread while the next epoch trains. Results and best-model saves stay in epoch order.
+    void setOverlappedEvaluation(bool enabled);
+    // Switches the fully connected layers to bfloat16 compute with full-precision master weights.
+    void setMixedPrecision(bool enabled);
+    // Splits the layers into numStages contiguous stages, balanced by their measured forward and
+    // backward time, each run by its own thread (see LayerPipeline). SGD then trains every
+    // mini-batch with the GPipe schedule over micro-batches of microBatchSize samples, and
+    // forwardPipelined streams inference through the stages. numStages <= 1 turns this off.
+    // Configure after the last layer is added; adding or folding layers turns it off again.
+    void setPipelineStages(int numStages, int microBatchSize, bool pinThreads = false);
+    // Same with explicit stages: stageEnds[s] is one past the last layer of stage s.
+    void setPipelineStages(const std::vector<size_t>& stageEnds, int microBatchSize, bool pinThreads = false);
+    // The configured pipeline, or nullptr; exposes the timing of its last run.
+    const LayerPipeline* getPipeline() const;
+    // Inference over several inputs through the pipeline stages, or layer by layer without one.
+    std::vector<std::vector<std::vector<std::vector<double>>>> forwardPipelined(const std::vector<std::vector<std::vector<std::vector<double>>>>& inputs);
+    // Lock-free asynchronous SGD (Hogwild!): numThreads workers pull samples from a shared
+    // shuffled order and each applies its per-sample update straight to the shared parameters.
+    void SGDHogwild(const std::vector<ImageData>& trainingData, int epochs, int numThreads, const std::vector<ImageData>& testData);
+    // Data-parallel SGD: every rank trains on its own shard of trainingData and the gradients of
+    // each mini-batch are averaged across ranks by the synchronizer. Only rank 0 evaluates. The
+    // shards are equal, so trainingData.size() % worldSize samples sit out each epoch, a different
+    // window of them every epoch. A BatchLayer normalizes over each rank's part of the mini-batch,
+    // and its running statistics stay per rank. Throws if pipeline stages are configured.
+    void SGD(const std::vector<ImageData>& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData, GradientSynchronizer& synchronizer);
+    int evaluate(const std::vector<ImageData>& testData) const;
     void printNetworkSummary() const;
     void saveNetwork(const std::string& filePath) const;
+    // Merges every BatchNormLayer that directly follows a ConvolutionalLayer or FullyConnectedLayer
+    // with an Identity activation into that layer's weights, using the running statistics, and
+    // removes it. Meant for deployment: the result infers identically but trains without batch
+    // normalization. Returns the number of layers folded.
+    size_t foldBatchNormalization();
     static CNN loadNetwork(const std::string& filePath);
+    // Deep copy of the network; the copy shares no layers or parameters with this one.
+    CNN clone() const;
+    const std::vector<int>& getInputShape() const;
+    size_t getLayerCount() const;
+    std::shared_ptr<Layer> getLayer(size_t index) const;
+    const std::vector<int>& getLayerInputShape(size_t index) const;
+    const std::vector<int>& getLayerOutputShape(size_t index) const;
 
 private:
     std::vector<std::shared_ptr<Layer>> layers;
     double learningRate;
     std::vector<int> inputShape;
     std::vector<std::vector<int>> layerShapes;
+    bool overlappedEvaluation = false;
+    std::shared_ptr<LayerPipeline> pipeline;
+    size_t pipelineMicroBatchSize = 1;
+    // Every ParameterizedLayer's parameters and gradients, one aligned block per network.
+    std::shared_ptr<ParameterStore> parameterStore;
+    // Index-aligned with layers; nullptr for layers without parameters.
+    std::vector<ParameterizedLayer*> parameterizedLayers;
+
+    // Lays the parameters of all layers out back to back in a new store.
+    void rebuildParameterStore();
+    // The window of every layer; throws if some layer is not a SpatialLayer.
+    std::vector<SpatialLayer::Window> getSpatialWindows() const;
+    // Output side of the square tiles forwardTiled uses for an output of the given size.
+    int chooseTileSize(const std::vector<SpatialLayer::Window>& windows, int outputHeight, int outputWidth, size_t tileBytes) const;
 
+    void train(DataSource& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData, const std::string& saveFilePath);
     std::vector<std::vector<ImageData>> createMiniBatches(const std::vector<ImageData>& trainingData, int miniBatchSize);
     void updateMiniBatch(const std::vector<ImageData>& miniBatch, int miniBatchSize);
+    void updateMiniBatchLayerwise(const std::vector<ImageData>& miniBatch, int miniBatchSize);
+    // Accumulates the gradients of the mini-batch moved through the network one layer at a time,
+    // calling layerDone(l) once layer l's gradients are complete.
+    void accumulateLayerwise(const std::vector<ImageData>& miniBatch, const std::function<void(size_t)>& layerDone);
+    void updateMiniBatchPipelined(const std::vector<ImageData>& miniBatch, int miniBatchSize);
+    // Seconds of one per-sample forward and backward pass through each layer.
+    std::vector<double> measureLayerSeconds();
+    void updateMiniBatch(const std::vector<ImageData>& miniBatch, int miniBatchSize, GradientSynchronizer& synchronizer, const std::vector<int>& synchronizedIndex);
+    void hogwildWorker(const std::vector<ImageData>& trainingData, const std::vector<size_t>& order, std::atomic<size_t>& next);
     std::vector<std::vector<std::vector<double>>> computeLossGradient(const std::vector<double>& output, const std::vector<double>& target);
     int argMax(const std::vector<double>& array) const;
 };
@@ -0,0 +1,77 @@
+#ifndef HYPERPARAMETER_SWEEP_H
+#define HYPERPARAMETER_SWEEP_H
+
+#include "cnn/CNN.h"
+#include "utils/ImageData.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One point of a sweep. The builder turns it into a network; layerWidths is free for it to
+// interpret, e.g. as the sizes of the hidden layers.
+struct HyperparameterConfig {
+    double learningRate = 0.01;
+    int miniBatchSize = 32;
+    std::vector<int> layerWidths;
+};
+
+struct SweepOptions {
+    int epochs = 10;
+    // Trials training at the same time; 0 means one per hardware thread.
+    int numWorkers = 0;
+    // Epochs every trial trains before it may be stopped early.
+    int gracePeriod = 2;
+    // Median stopping rule: after each epoch past the grace period, a trial whose best accuracy so
+    // far is below the median of what at least minPeers other trials reached at the same epoch is
+    // stopped. While fewer have got that far, the latest earlier epoch with enough of them is
+    // used. Off when minPeers is 0.
+    int minPeers = 2;
+    // When set, the best model is saved here at the end of the sweep.
+    std::string saveFilePath;
+};
+
+struct TrialResult {
+    HyperparameterConfig config;
+    // Validation accuracy after each epoch the trial trained
+    std::vector<double> accuracies;
+    bool stoppedEarly = false;
+    double seconds = 0.0;
+
+    double bestAccuracy() const;
+};
+
+struct SweepResult {
+    // In the order of the configs
+    std::vector<TrialResult> trials;
+    size_t bestTrial = 0;
+    // Snapshot of the best trial at its best epoch
+    std::shared_ptr<CNN> bestModel;
+};
+
+// Trains many network configurations concurrently in one process. Every trial reads the same
+// training and validation data, which are shared read-only rather than copied, and draws its
+// mini-batches from its own shuffled order over them. Workers take trials round-robin, one epoch
+// at a time, so all trials advance together and each epoch's accuracy can be compared with the
+// others' at the same epoch to stop hopeless ones early.
+class HyperparameterSweep {
+public:
+    using NetworkBuilder = std::function<CNN(const HyperparameterConfig& config)>;
+
+    HyperparameterSweep(const std::vector<ImageData>& trainingData, const std::vector<ImageData>& validationData, NetworkBuilder buildNetwork);
+
+    // Builds every network on the calling thread, then trains them on the workers. Prints one line
+    // per trial epoch and the best trial at the end.
+    SweepResult run(const std::vector<HyperparameterConfig>& configs, const SweepOptions& options);
+
+    // Every combination of the given values.
+    static std::vector<HyperparameterConfig> grid(const std::vector<double>& learningRates, const std::vector<int>& miniBatchSizes,
+                                                  const std::vector<std::vector<int>>& layerWidths);
+
+private:
+    const std::vector<ImageData>& trainingData;
+    const std::vector<ImageData>& validationData;
+    NetworkBuilder buildNetwork;
+};
+
+#endif // HYPERPARAMETER_SWEEP_H
@@ -0,0 +1,108 @@
+#ifndef LAYER_PIPELINE_H
+#define LAYER_PIPELINE_H
+
+#include "interfaces/Layer.h"
+#include "utils/SpscQueue.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pipeline-parallel execution of a network: the layers are split into contiguous stages, each run
+// by its own thread, and micro-batches of samples stream from stage to stage through bounded
+// lock-free SPSC queues. Inference is a plain pipeline. Training follows the GPipe schedule:
+// every micro-batch goes forward, then every micro-batch goes backward in reverse order, with the
+// gradients accumulating in the layers. Only one forward or train call may run at a time; the
+// stage threads sleep in between. If a layer throws, the rest of the call's micro-batches pass
+// through untouched and the first exception is rethrown by forward or train.
+class LayerPipeline {
+public:
+    using Tensor = std::vector<std::vector<std::vector<double>>>;
+    // Loss gradient for sample k of a train call given the network's output for it.
+    using LossGradient = std::function<Tensor(size_t k, const Tensor& output)>;
+
+    struct Stats {
+        double seconds = 0.0;
+        std::vector<double> stageBusySeconds;
+        // Share of the stages' time spent waiting: 1 - sum(busy) / (stages * seconds).
+        double bubbleFraction() const;
+    };
+
+    // stageEnds[s] is one past the last layer of stage s, so the last entry is layers.size().
+    // With pinThreads, stage s is bound to CPU s where the platform supports it.
+    LayerPipeline(std::vector<std::shared_ptr<Layer>> layers, const std::vector<size_t>& stageEnds, bool pinThreads);
+    ~LayerPipeline();
+
+    LayerPipeline(const LayerPipeline&) = delete;
+    LayerPipeline& operator=(const LayerPipeline&) = delete;
+
+    // Per-sample inference forward; the outputs are in input order.
+    std::vector<Tensor> forward(const std::vector<Tensor>& inputs, size_t microBatchSize);
+    // Forward and backward of one mini-batch. Gradients are added to the layers' accumulators;
+    // resetting and applying them is left to the caller. A BatchLayer normalizes over each micro-batch.
+    void train(std::vector<Tensor> inputs, size_t microBatchSize, const LossGradient& lossGradient);
+
+    size_t getStageCount() const;
+    // Timing of the last forward or train call.
+    const Stats& getLastStats() const;
+
+private:
+    enum class Kind { Inference, Training, Backward };
+    struct MicroBatch {
+        Kind kind = Kind::Inference;
+        size_t index = 0;
+        std::vector<Tensor> tensors;
+        // Set once a stage has thrown on this micro-batch; later stages pass it on unprocessed
+        bool failed = false;
+    };
+    struct Stage {
+        size_t firstLayer;
+        size_t endLayer;
+        // Fed by the previous stage (the caller for the first stage) and, during training, by
+        // the next stage (the caller for the last stage).
+        std::unique_ptr<SpscQueue<MicroBatch>> forwardInput;
+        std::unique_ptr<SpscQueue<MicroBatch>> backwardInput;
+        // Training caches [microBatch][layer - firstLayer][sample], kept from forward to backward.
+        std::vector<std::vector<std::vector<LayerCache>>> trainingCaches;
+        // One workspace per layer for inference
+        std::vector<LayerCache> inferenceCaches;
+        double busySeconds = 0.0;
+        std::thread thread;
+    };
+
+    std::vector<std::shared_ptr<Layer>> layers;
+    std::vector<std::unique_ptr<Stage>> stages;
+    // Results of the last stage's forward passes and of the first stage's backward passes
+    SpscQueue<MicroBatch> forwardOutput;
+    SpscQueue<MicroBatch> backwardOutput;
+    std::atomic<bool> stopping{false};
+    Stats lastStats;
+
+    // running is set for the duration of a forward or train call; it and stopping change under
+    // runMutex, so a stage waiting on runChanged cannot miss either. runMutex also guards the
+    // first exception a stage threw during the current call.
+    std::atomic<bool> running{false};
+    std::mutex runMutex;
+    std::condition_variable runChanged;
+    std::exception_ptr error;
+
+    void stageLoop(size_t s, bool pinThread);
+    // Sleeps until a run starts; returns false once the pipeline is being destroyed.
+    bool waitForRun();
+    // Runs one direction of a stage on batch, recording an exception instead of letting it escape.
+    void runStage(Stage& stage, MicroBatch& batch, void (LayerPipeline::*direction)(Stage&, MicroBatch&));
+    void runForward(Stage& stage, MicroBatch& batch);
+    void runBackward(Stage& stage, MicroBatch& batch);
+    // Pushes batches[0..n) into input while draining output into results, until every result is back.
+    void stream(std::vector<MicroBatch>& batches, SpscQueue<MicroBatch>& input, SpscQueue<MicroBatch>& output, std::vector<MicroBatch>& results);
+    void startRun();
+    // Records the stats and puts the stages to sleep; rethrows a stage's exception, if any.
+    void finishRun(double seconds);
+};
+
+#endif // LAYER_PIPELINE_H
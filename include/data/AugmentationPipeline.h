@@ -0,0 +1,50 @@
+#ifndef AUGMENTATION_PIPELINE_H
+#define AUGMENTATION_PIPELINE_H
+
+#include "data/Augmenter.h"
+#include "interfaces/DataSource.h"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+// Augments the samples of an upstream DataSource on worker threads while training consumes
+// them. Workers pull small chunks from the upstream source, transform them with their own
+// Augmenter and RNG (seeded with seed + worker index) and queue the results, keeping at most
+// capacity samples buffered. Samples come out in completion order, which is not deterministic
+// with more than one worker. An exception from the upstream source or from augmenting a sample
+// ends the epoch and is rethrown by nextBatch.
+class AugmentationPipeline : public DataSource {
+public:
+    AugmentationPipeline(DataSource& upstream, const AugmentationConfig& config, int numWorkers, unsigned int seed, size_t capacity = 1024);
+    ~AugmentationPipeline() override;
+
+    AugmentationPipeline(const AugmentationPipeline&) = delete;
+    AugmentationPipeline& operator=(const AugmentationPipeline&) = delete;
+
+    void startEpoch() override;
+    bool nextBatch(std::vector<ImageData>& batch, size_t maxSamples) override;
+
+private:
+    DataSource& upstream;
+    size_t capacity;
+    std::vector<std::thread> workers;
+
+    // All state below is guarded by mutex.
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<ImageData> ready;
+    // Samples taken from upstream whose augmentation has not finished yet.
+    size_t inFlight = 0;
+    bool upstreamExhausted = true;
+    bool stopping = false;
+    // A worker's exception, until nextBatch rethrows it
+    std::exception_ptr error;
+
+    void worker(const AugmentationConfig& config, unsigned int seed);
+    // Records a worker's exception and ends the epoch; called with mutex held.
+    void fail(std::exception_ptr workerError);
+};
+
+#endif // AUGMENTATION_PIPELINE_H
@@ -0,0 +1,41 @@
+#ifndef AUGMENTER_H
+#define AUGMENTER_H
+
+#include <random>
+#include <vector>
+
+// Strength of each random transform; a zero disables it.
+struct AugmentationConfig {
+    // Maximum translation in pixels along each axis.
+    double maxShift = 2.0;
+    // Maximum rotation about the image centre, in degrees.
+    double maxRotationDegrees = 10.0;
+    // Elastic distortion (Simard et al.): a random displacement field smoothed with a Gaussian of
+    // elasticSigma pixels and scaled by elasticAlpha.
+    double elasticAlpha = 0.0;
+    double elasticSigma = 4.0;
+    // Standard deviation of additive Gaussian pixel noise.
+    double noiseStddev = 0.0;
+};
+
+// Applies a random shift, rotation, elastic distortion and noise to an image, the same geometric
+// transform for every channel, with bilinear sampling and zeros outside the image. Keeps scratch
+// buffers between calls, so each thread needs its own Augmenter.
+class Augmenter {
+public:
+    explicit Augmenter(const AugmentationConfig& config);
+
+    std::vector<std::vector<std::vector<double>>> apply(const std::vector<std::vector<std::vector<double>>>& image, std::mt19937& gen);
+
+private:
+    AugmentationConfig config;
+    std::vector<double> gaussianKernel;
+    // Displacement fields and blur scratch, height * width each.
+    std::vector<double> displacementX;
+    std::vector<double> displacementY;
+    std::vector<double> blurScratch;
+
+    void randomDisplacement(std::vector<double>& field, int height, int width, std::mt19937& gen);
+};
+
+#endif // AUGMENTER_H
@@ -0,0 +1,65 @@
+#ifndef CHUNKED_DATA_SOURCE_H
+#define CHUNKED_DATA_SOURCE_H
+
+#include "data/ChunkedDataset.h"
+#include "interfaces/DataSource.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+
+struct ChunkedDataSourceConfig {
+    // Samples held for shuffling; larger buffers give a more uniform shuffle.
+    size_t shuffleBufferSize = 4096;
+    // Chunks read ahead of the shuffle buffer by the background reader.
+    size_t readAheadChunks = 2;
+    unsigned int seed = std::random_device{}();
+};
+
+// Streams a chunked dataset file. Each epoch visits the chunks in a new random order, read by a
+// background thread, and draws samples at random from a bounded shuffle buffer that the chunks
+// are poured into. Memory use is about (readAheadChunks + 1) chunks plus shuffleBufferSize
+// records, independent of the size of the file.
+class ChunkedDataSource : public DataSource {
+public:
+    ChunkedDataSource(const std::string& filePath, const ChunkedDataSourceConfig& config);
+    explicit ChunkedDataSource(const std::string& filePath);
+    ~ChunkedDataSource() override;
+
+    ChunkedDataSource(const ChunkedDataSource&) = delete;
+    ChunkedDataSource& operator=(const ChunkedDataSource&) = delete;
+
+    void startEpoch() override;
+    bool nextBatch(std::vector<ImageData>& batch, size_t maxSamples) override;
+    const ChunkedDatasetHeader& getHeader() const;
+
+private:
+    std::string filePath;
+    ChunkedDatasetHeader header;
+    ChunkedDataSourceConfig config;
+    std::mt19937 gen;
+    std::vector<int> chunkOrder;
+
+    // Reader thread state, guarded by mutex.
+    std::thread reader;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> readChunks;
+    bool readerDone = true;
+    bool stopReader = false;
+    std::string readerError;
+
+    // Consumer side: the chunk being poured into the shuffle buffer, and the buffer itself.
+    std::vector<uint8_t> currentChunk;
+    size_t currentPosition = 0;
+    std::vector<uint8_t> shuffleBuffer;
+    size_t buffered = 0;
+
+    void readChunksInOrder(std::vector<int> order);
+    void stopReading();
+    bool refillShuffleBuffer();
+    ImageData decode(const uint8_t* record) const;
+};
+
+#endif // CHUNKED_DATA_SOURCE_H
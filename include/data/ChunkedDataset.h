@@ -0,0 +1,48 @@
+#ifndef CHUNKED_DATASET_H
+#define CHUNKED_DATASET_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Out-of-core training set format. A header followed by fixed-size records, each holding the
+// pixels of one sample as uint8 (channel, row, column order) and its class index as uint16.
+// Records are grouped into chunks of samplesPerChunk consecutive records, the unit that
+// ChunkedDataSource reads and shuffles; the last chunk may be shorter.
+struct ChunkedDatasetHeader {
+    int depth = 0;
+    int height = 0;
+    int width = 0;
+    int numClasses = 0;
+    int samplesPerChunk = 0;
+    int sampleCount = 0;
+    // Stored pixels are multiplied by this when decoded.
+    double pixelScale = 1.0 / 255.0;
+
+    size_t pixelCount() const { return static_cast<size_t>(depth) * height * width; }
+    size_t recordSize() const { return pixelCount() + sizeof(uint16_t); }
+    int chunkCount() const { return static_cast<int>((static_cast<int64_t>(sampleCount) + samplesPerChunk - 1) / samplesPerChunk); }
+    // Byte offset of the first record, i.e. the size of the header.
+    static std::streamoff dataOffset();
+
+    void write(std::ostream& stream) const;
+    static ChunkedDatasetHeader read(std::istream& stream);
+};
+
+// Appends samples to a new chunked dataset file. The sample count in the header is filled in by close,
+// which throws if the file could not be written; the destructor closes too but drops that error.
+class ChunkedDatasetWriter {
+public:
+    ChunkedDatasetWriter(const std::string& filePath, int depth, int height, int width, int numClasses, int samplesPerChunk, double pixelScale = 1.0 / 255.0);
+    ~ChunkedDatasetWriter();
+
+    // pixels holds depth * height * width values.
+    void addSample(const uint8_t* pixels, int label);
+    void close();
+
+private:
+    std::ofstream file;
+    ChunkedDatasetHeader header;
+};
+
+#endif // CHUNKED_DATASET_H
@@ -0,0 +1,23 @@
+#ifndef IN_MEMORY_DATA_SOURCE_H
+#define IN_MEMORY_DATA_SOURCE_H
+
+#include "interfaces/DataSource.h"
+#include <random>
+
+// Serves a dataset held in memory in a fresh random order every epoch. The samples are not
+// copied; data must outlive the source.
+class InMemoryDataSource : public DataSource {
+public:
+    explicit InMemoryDataSource(const std::vector<ImageData>& data);
+
+    void startEpoch() override;
+    bool nextBatch(std::vector<ImageData>& batch, size_t maxSamples) override;
+
+private:
+    const std::vector<ImageData>& data;
+    std::vector<size_t> order;
+    size_t position = 0;
+    std::mt19937 gen;
+};
+
+#endif // IN_MEMORY_DATA_SOURCE_H
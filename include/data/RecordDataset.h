@@ -0,0 +1,67 @@
+#ifndef RECORD_DATASET_H
+#define RECORD_DATASET_H
+
+#include "utils/ImageData.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Layout of a binary dataset made of fixed-size records, each holding a uint8 class index and
+// uint8 pixels in [channel][row][column] order. The label byte may lie before or after the pixels.
+struct RecordFormat {
+    // Bytes skipped at the start of every file.
+    int fileHeaderBytes = 0;
+    int labelOffset = 0;
+    int pixelOffset = 1;
+    int depth = 1;
+    int height = 0;
+    int width = 0;
+    int numClasses = 10;
+
+    size_t pixelCount() const { return static_cast<size_t>(depth) * height * width; }
+    size_t recordSize() const;
+
+    // <1 x label><3072 x pixel> records of 32x32 RGB images.
+    static RecordFormat cifar10();
+    // <1 x coarse label><1 x fine label><3072 x pixel>; selects the 100 fine or 20 coarse classes.
+    static RecordFormat cifar100(bool fineLabels = true);
+};
+
+struct ChannelStatistics {
+    std::vector<double> mean;
+    std::vector<double> stddev;
+};
+
+// A decoded dataset held in one contiguous float array, with pixels scaled to [0, 1] and then
+// optionally normalized per channel.
+class RecordDataset {
+public:
+    // Decodes every record of the files with numThreads threads, each reading and decoding its own
+    // range of records straight into place. Per-channel statistics of the [0, 1] pixels are
+    // accumulated in the same pass. With normalize set, pixels are then standardized with them.
+    static RecordDataset read(const std::vector<std::string>& files, const RecordFormat& format, int numThreads, bool normalize);
+    // Same, but standardizes with the given statistics (e.g. the training set's) during decoding;
+    // their standard deviations must be positive.
+    static RecordDataset read(const std::vector<std::string>& files, const RecordFormat& format, int numThreads, const ChannelStatistics& normalization);
+
+    size_t size() const;
+    std::vector<int> getShape() const;
+    int getNumClasses() const;
+    int getLabel(size_t index) const;
+    const float* getPixels(size_t index) const;
+    // Statistics of the pixels as decoded, before any normalization.
+    const ChannelStatistics& getStatistics() const;
+
+    ImageData getSample(size_t index) const;
+    std::vector<ImageData> toImageData() const;
+
+private:
+    RecordFormat format;
+    std::vector<float> pixels;
+    std::vector<uint8_t> labels;
+    ChannelStatistics statistics;
+
+    static RecordDataset decode(const std::vector<std::string>& files, const RecordFormat& format, int numThreads, const ChannelStatistics* normalization);
+};
+
+#endif // RECORD_DATASET_H
@@ -0,0 +1,69 @@
+#ifndef GRADIENT_SYNCHRONIZER_H
+#define GRADIENT_SYNCHRONIZER_H
+
+#include "distributed/RingAllReduce.h"
+#include "interfaces/ParameterizedLayer.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Averages accumulated gradients across ranks for data-parallel training.
+// Layers are grouped into buckets of about bucketBytes in backward order. As soon as backward
+// has produced the gradients of every layer in a bucket, the bucket is handed to a
+// communication thread and all-reduced while backward continues through earlier layers.
+// A failed all-reduce (e.g. a peer that died) stops the communication thread; markReady and
+// synchronize then rethrow its exception, and so does every later call.
+class GradientSynchronizer {
+public:
+    GradientSynchronizer(std::shared_ptr<Transport> transport, size_t bucketBytes = 1 << 20);
+    ~GradientSynchronizer();
+
+    GradientSynchronizer(const GradientSynchronizer&) = delete;
+    GradientSynchronizer& operator=(const GradientSynchronizer&) = delete;
+
+    // Sets the layers to synchronize, in forward order, and rebuilds the buckets.
+    void setLayers(const std::vector<ParameterizedLayer*>& layers);
+
+    // Copies rank 0's parameters to every rank so all replicas start identical.
+    void broadcastParameters();
+
+    // Signals that backward has finished accumulating the gradients of layers[layerIndex].
+    void markReady(size_t layerIndex);
+
+    // Waits for all buckets and writes the averaged gradients back into the layers.
+    void synchronize();
+
+    int getRank() const;
+    int getWorldSize() const;
+
+private:
+    struct Bucket {
+        std::vector<size_t> layerIndices;
+        std::vector<double> buffer;
+        size_t pending;
+    };
+
+    RingAllReduce allReduce;
+    size_t bucketBytes;
+    std::vector<ParameterizedLayer*> layers;
+    std::vector<Bucket> buckets;
+    std::vector<size_t> bucketOfLayer;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Bucket*> queue;
+    size_t completedBuckets;
+    bool stopping;
+    // The communication thread's exception, if an all-reduce failed
+    std::exception_ptr error;
+
+    void communicate();
+};
+
+#endif // GRADIENT_SYNCHRONIZER_H
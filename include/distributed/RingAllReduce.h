@@ -0,0 +1,25 @@
+#ifndef RING_ALL_REDUCE_H
+#define RING_ALL_REDUCE_H
+
+#include "interfaces/Transport.h"
+#include <memory>
+#include <vector>
+
+// Bandwidth-optimal sum all-reduce over a ring: a reduce-scatter followed by an all-gather,
+// each taking worldSize - 1 steps in which every rank sends and receives 1/worldSize of the data.
+class RingAllReduce {
+public:
+    explicit RingAllReduce(std::shared_ptr<Transport> transport);
+
+    // Replaces data[0..count) on every rank with the element-wise sum over all ranks.
+    void allReduce(double* data, size_t count);
+
+    int getRank() const;
+    int getWorldSize() const;
+
+private:
+    std::shared_ptr<Transport> transport;
+    std::vector<double> receiveBuffer;
+};
+
+#endif // RING_ALL_REDUCE_H
@@ -0,0 +1,37 @@
+#ifndef SHARED_MEMORY_TRANSPORT_H
+#define SHARED_MEMORY_TRANSPORT_H
+
+#include "interfaces/Transport.h"
+#include <string>
+#include <cstddef>
+
+// Transport between processes on one host through POSIX shared memory. Every rank owns an
+// inbox segment named "/<jobName>.<rank>" holding a single-producer/single-consumer byte ring
+// that only the previous rank writes to.
+class SharedMemoryTransport : public Transport {
+public:
+    SharedMemoryTransport(int rank, int worldSize, const std::string& jobName, size_t capacity = 1 << 20);
+    ~SharedMemoryTransport() override;
+
+    SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+    SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+
+    int getRank() const override;
+    int getWorldSize() const override;
+    void exchange(const void* sendData, size_t sendSize, void* recvData, size_t recvSize) override;
+
+private:
+    struct Channel;
+
+    int rank;
+    int worldSize;
+    size_t capacity;
+    std::string inboxName;
+    Channel* inbox;
+    Channel* outbox;
+
+    size_t segmentSize() const;
+    static std::string segmentName(const std::string& jobName, int rank);
+};
+
+#endif // SHARED_MEMORY_TRANSPORT_H
@@ -0,0 +1,32 @@
+#ifndef SOCKET_TRANSPORT_H
+#define SOCKET_TRANSPORT_H
+
+#include "interfaces/Transport.h"
+#include <string>
+
+// Transport between processes on one host over Unix domain sockets. Every rank listens on
+// "<directory>/<jobName>.<rank>.sock", connects to the next rank and accepts the previous one.
+class SocketTransport : public Transport {
+public:
+    SocketTransport(int rank, int worldSize, const std::string& directory, const std::string& jobName);
+    ~SocketTransport() override;
+
+    SocketTransport(const SocketTransport&) = delete;
+    SocketTransport& operator=(const SocketTransport&) = delete;
+
+    int getRank() const override;
+    int getWorldSize() const override;
+    void exchange(const void* sendData, size_t sendSize, void* recvData, size_t recvSize) override;
+
+private:
+    int rank;
+    int worldSize;
+    std::string socketPath;
+    int listenSocket;
+    int nextSocket;
+    int previousSocket;
+
+    static std::string socketName(const std::string& directory, const std::string& jobName, int rank);
+};
+
+#endif // SOCKET_TRANSPORT_H
@@ -2,6 +2,8 @@
 #define ACTIVATION_FUNCTION_H
 
 #include <vector>
+#include <cstddef>
+#include <ostream>
 
 class ActivationFunction {
 public:
@@ -13,6 +15,9 @@ public:
     // Computes the derivative of the activation function for a given input value.
     virtual double derivative(double x) const = 0;
 
+    // Writes the function's type and settings; read back by Serialization::readActivationFunction.
+    virtual void save(std::ostream& stream) const = 0;
+
     // Applies the activation function to an array of input values.
     virtual std::vector<double> activate(const std::vector<double>& input) const {
         std::vector<double> output(input.size());
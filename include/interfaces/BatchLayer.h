@@ -0,0 +1,25 @@
+#ifndef BATCH_LAYER_H
+#define BATCH_LAYER_H
+
+#include "interfaces/Layer.h"
+#include <vector>
+
+// A layer whose training forward pass depends on the whole mini-batch, such as batch
+// normalization. CNN trains a network containing one layer by layer over the mini-batch and calls
+// these instead of the per-sample forward/backward, with one cache per sample. The per-sample
+// methods remain the inference path.
+class BatchLayer : public virtual Layer {
+public:
+    virtual ~BatchLayer() = default;
+
+    // Replaces every sample of the batch with its output. Whatever backwardMiniBatch needs goes in
+    // the caches rather than the layer, since LayerPipeline runs several mini-batches forward
+    // before any of them goes backward.
+    virtual void forwardMiniBatch(std::vector<std::vector<std::vector<std::vector<double>>>>& batch, std::vector<LayerCache>& caches) = 0;
+
+    // Replaces every output gradient with the input gradient and accumulates the parameter
+    // gradients; must follow forwardMiniBatch on the same batch.
+    virtual void backwardMiniBatch(std::vector<std::vector<std::vector<std::vector<double>>>>& gradients, std::vector<LayerCache>& caches) = 0;
+};
+
+#endif // BATCH_LAYER_H
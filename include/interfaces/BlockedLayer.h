@@ -0,0 +1,17 @@
+#ifndef BLOCKED_LAYER_H
+#define BLOCKED_LAYER_H
+
+#include "interfaces/Layer.h"
+#include "utils/BlockedTensor.h"
+
+// A layer with an inference kernel for the channel-blocked layout. CNN runs consecutive blocked
+// layers without converting between them, so the layout changes only where such a run starts and ends.
+class BlockedLayer : public virtual Layer {
+public:
+    virtual ~BlockedLayer() = default;
+
+    // Inference-only forward pass; does not touch any cache, so it is safe to call concurrently.
+    virtual void forwardBlocked(const BlockedTensor& input, BlockedTensor& output) const = 0;
+};
+
+#endif // BLOCKED_LAYER_H
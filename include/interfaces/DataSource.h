@@ -0,0 +1,21 @@
+#ifndef DATA_SOURCE_H
+#define DATA_SOURCE_H
+
+#include "utils/ImageData.h"
+#include <cstddef>
+#include <vector>
+
+// A stream of training samples consumed epoch by epoch by CNN::SGD.
+class DataSource {
+public:
+    virtual ~DataSource() = default;
+
+    // Begins a new pass over the data.
+    virtual void startEpoch() = 0;
+
+    // Replaces the contents of batch with up to maxSamples samples of the current pass. Returns
+    // false, with batch empty, once the pass is exhausted.
+    virtual bool nextBatch(std::vector<ImageData>& batch, size_t maxSamples) = 0;
+};
+
+#endif // DATA_SOURCE_H
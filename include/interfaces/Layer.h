@@ -1,7 +1,10 @@
 #ifndef LAYER_H
 #define LAYER_H
 
+#include "interfaces/LayerCache.h"
 #include <vector>
+#include <ostream>
+#include <memory>
 
 class Layer {
 public:
@@ -10,8 +13,24 @@ public:
     virtual std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input) = 0;
     
     virtual std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient) = 0;
+
+    // Same as forward/backward, but the activations needed by backward live in the caller's cache instead of the layer.
+    virtual std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) = 0;
+
+    virtual std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) = 0;
+
+    // Inference-only forward pass. It only reads the layer and writes scratch data to the caller's
+    // workspace, so any number of threads can share one layer, each with its own workspace.
+    virtual std::vector<std::vector<std::vector<double>>> infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const = 0;
     
     virtual std::vector<int> getOutputShape(const std::vector<int>& inputShape) = 0;
+
+    // Deep copy of the layer, parameters included; used to snapshot a network.
+    virtual std::shared_ptr<Layer> clone() const = 0;
+
+    // Writes the layer's type tag and constructor arguments for CNN::saveNetwork.
+    // Learned parameters are written separately through ParameterizedLayer.
+    virtual void save(std::ostream& stream) const = 0;
 };
 
-#endif // LAYER_H
\ No newline at end of file
+#endif // LAYER_H
@@ -0,0 +1,20 @@
+#ifndef LAYER_CACHE_H
+#define LAYER_CACHE_H
+
+#include <vector>
+#include <cstdint>
+
+// Per-sample state a layer keeps between forward and backward.
+// Owning one cache per layer per thread lets several threads run the same layers at once.
+// Layer::infer uses it as scratch space only; what it leaves there is not meant for backward.
+struct LayerCache {
+    std::vector<std::vector<std::vector<double>>> input;
+    std::vector<std::vector<std::vector<double>>> output;
+    // bfloat16 copy of the input, kept instead of `input` by layers running in mixed precision.
+    std::vector<uint16_t> compactInput;
+    // Per-channel statistics a BatchLayer computes over its whole mini-batch, kept in the first
+    // sample's cache.
+    std::vector<double> batchStatistics;
+};
+
+#endif // LAYER_CACHE_H
@@ -2,6 +2,10 @@
 #define PARAMETERIZED_LAYER_H
 
 #include "interfaces/Layer.h"
+#include <cstddef>
+#include <memory>
+
+class ParameterStore;
 
 class ParameterizedLayer : public virtual Layer {
 public:
@@ -12,6 +16,34 @@ public:
 
     // Resets the accumulated gradients to zero.
     virtual void resetGradients() = 0;
+
+    // Backpropagates like backward(gradient, cache), but applies the SGD step directly to the
+    // parameters instead of accumulating it. Used by Hogwild! training, where unsynchronized
+    // concurrent updates from several threads are accepted by design.
+    virtual std::vector<std::vector<std::vector<double>>> backwardAndUpdate(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache, double learningRate) = 0;
+
+    // Number of values (weights followed by biases) exchanged by the read/write methods below.
+    virtual size_t getParameterCount() const = 0;
+
+    // Copy the parameters or accumulated gradients to/from a flat buffer of getParameterCount() values.
+    virtual void readParameters(double* buffer) const = 0;
+    virtual void writeParameters(const double* buffer) = 0;
+    virtual void readGradients(double* buffer) const = 0;
+    virtual void writeGradients(const double* buffer) = 0;
+
+    // Moves the parameters and gradients into store at offset (getParameterCount() values each,
+    // in the flat order above); the layer works on them there from then on. CNN binds all of its
+    // layers into one store so that whole-network updates and copies are single sweeps.
+    virtual void bindStorage(std::shared_ptr<ParameterStore> store, size_t offset) = 0;
+
+    // Rebuilds whatever the layer derives from its parameters (packed or reduced-precision copies)
+    // after they were changed in place through the store.
+    virtual void parametersChanged() {}
+    // Called before several threads start changing the parameters in place through
+    // backwardAndUpdate; parametersChanged follows once they are done. In between, the layer
+    // computes from the parameters themselves and leaves its derived copies alone, since
+    // rebuilding them while other threads read them would race.
+    virtual void parametersChanging() {}
 };
 
-#endif // PARAMETERIZED_LAYER_H
\ No newline at end of file
+#endif // PARAMETERIZED_LAYER_H
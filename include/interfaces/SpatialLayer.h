@@ -0,0 +1,26 @@
+#ifndef SPATIAL_LAYER_H
+#define SPATIAL_LAYER_H
+
+#include "interfaces/Layer.h"
+
+// A layer on (depth, height, width) inputs whose output pixel (y, x) depends only on a window of
+// input pixels around (y * stride - padding, x * stride - padding), the same along both axes.
+// Networks made only of such layers are fully convolutional: CNN::forwardTiled runs them on any
+// image size, one overlapping tile at a time.
+class SpatialLayer : public virtual Layer {
+public:
+    struct Window {
+        int size;
+        int stride;
+        // Zeros added on every side of the input
+        int padding;
+        // Distance between neighbouring taps of the window
+        int dilation;
+    };
+
+    virtual ~SpatialLayer() = default;
+
+    virtual Window getWindow() const = 0;
+};
+
+#endif // SPATIAL_LAYER_H
@@ -0,0 +1,20 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <cstddef>
+
+// Point-to-point link of one rank in a ring of processes.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual int getRank() const = 0;
+    virtual int getWorldSize() const = 0;
+
+    // Sends sendSize bytes to the next rank ((rank + 1) % worldSize) while receiving recvSize
+    // bytes from the previous one. Both directions progress together, so every rank can call
+    // this at the same time without deadlocking on full buffers.
+    virtual void exchange(const void* sendData, size_t sendSize, void* recvData, size_t recvSize) = 0;
+};
+
+#endif // TRANSPORT_H
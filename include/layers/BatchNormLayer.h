@@ -0,0 +1,91 @@
+#ifndef BATCH_NORM_LAYER_H
+#define BATCH_NORM_LAYER_H
+
+#include <vector>
+#include <istream>
+#include <memory>
+#include "interfaces/ActivationFunction.h"
+#include "interfaces/AdaptiveLayer.h"
+#include "interfaces/BatchLayer.h"
+#include "interfaces/ParameterizedLayer.h"
+#include "interfaces/SpatialLayer.h"
+#include "utils/LayerParameters.h"
+
+// Batch normalization followed by the layer's activation: each channel (each feature for a flat
+// input) is normalized to zero mean and unit variance, then scaled by gamma and shifted by beta.
+// Training normalizes with the statistics of the mini-batch and tracks their running averages;
+// the per-sample forward used for inference normalizes with the running averages. Hogwild! only
+// uses the per-sample path, so it leaves the running averages as they are; distributed training
+// normalizes over each rank's part of the mini-batch and keeps the running averages per rank.
+//
+// Give the preceding ConvolutionalLayer or FullyConnectedLayer an Identity activation and
+// CNN::foldBatchNormalization can merge this layer into its weights for deployment.
+class BatchNormLayer : public AdaptiveLayer, public ParameterizedLayer, public BatchLayer, public SpatialLayer {
+public:
+    // Running averages move by momentum towards each mini-batch's statistics; epsilon is added to
+    // the variance before taking its square root.
+    BatchNormLayer(double momentum, double epsilon, std::shared_ptr<ActivationFunction> activationFunction);
+    explicit BatchNormLayer(std::shared_ptr<ActivationFunction> activationFunction);
+
+    void initialize(const std::vector<int>& inputShape) override;
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input) override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient) override;
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> backwardAndUpdate(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache, double learningRate) override;
+    void forwardMiniBatch(std::vector<std::vector<std::vector<std::vector<double>>>>& batch, std::vector<LayerCache>& caches) override;
+    void backwardMiniBatch(std::vector<std::vector<std::vector<std::vector<double>>>>& gradients, std::vector<LayerCache>& caches) override;
+    void updateParameters(double learningRate, int miniBatchSize) override;
+    void resetGradients() override;
+    size_t getParameterCount() const override;
+    void readParameters(double* buffer) const override;
+    void writeParameters(const double* buffer) override;
+    void readGradients(double* buffer) const override;
+    void writeGradients(const double* buffer) override;
+    void bindStorage(std::shared_ptr<ParameterStore> store, size_t offset) override;
+    void parametersChanged() override;
+    std::vector<int> getOutputShape(const std::vector<int>& inputShape) override;
+    // Pointwise: a 1x1 window.
+    Window getWindow() const override;
+    std::shared_ptr<Layer> clone() const override;
+    // Also writes the running statistics, which are state rather than learned parameters.
+    void save(std::ostream& stream) const override;
+
+    // Reconstructs a layer from what save wrote after the type tag.
+    static std::shared_ptr<BatchNormLayer> load(std::istream& stream);
+
+    // The inference transform as activation(scale[c] * x + shift[c]).
+    void getInferenceAffine(std::vector<double>& scale, std::vector<double>& shift) const;
+    std::shared_ptr<ActivationFunction> getActivationFunction() const;
+
+private:
+    double momentum;
+    double epsilon;
+    // Flat inputs are normalized per feature; otherwise per channel over height and width.
+    bool perFeature = false;
+    size_t channels = 0;
+    // Gamma for each channel followed by beta for each channel; the gradients use the same layout.
+    LayerParameters parameters;
+    std::vector<double> runningMean;
+    std::vector<double> runningVariance;
+    // Used by the single-argument forward and backward
+    LayerCache defaultCache;
+    std::shared_ptr<ActivationFunction> activationFunction;
+    // getInferenceAffine for infer, rebuilt whenever the parameters or running statistics change.
+    std::vector<double> inferenceScale;
+    std::vector<double> inferenceShift;
+
+    void refreshInferenceAffine();
+
+    // Calls visit(channel, value) for every value of a sample, in storage order.
+    template <typename Tensor, typename Visit>
+    void forEachValue(Tensor& tensor, Visit visit) const;
+
+    // Shared by backward and backwardAndUpdate: adds scale * gradient to target, which is laid out
+    // like the parameters. cache.input holds the normalized input, as written by forward.
+    std::vector<std::vector<std::vector<double>>> backpropagate(std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                double* target, double scale);
+};
+
+#endif // BATCH_NORM_LAYER_H
@@ -2,41 +2,129 @@
 #define CONVOLUTIONAL_LAYER_H
 
 #include <vector>
+#include <istream>
 #include <memory>
 #include <random>
+#include <string>
 #include "interfaces/ActivationFunction.h"
 #include "interfaces/AdaptiveLayer.h"
+#include "interfaces/BlockedLayer.h"
 #include "interfaces/ParameterizedLayer.h"
+#include "interfaces/SpatialLayer.h"
 #include "interfaces/Layer.h"
+#include "utils/ConvolutionKernels.h"
+#include "utils/ConvolutionTuner.h"
+#include "utils/LayerParameters.h"
 
-class ConvolutionalLayer : public AdaptiveLayer, public ParameterizedLayer {
+class ConvolutionalLayer : public AdaptiveLayer, public ParameterizedLayer, public BlockedLayer, public SpatialLayer {
 public:
+    // Pass as padding to keep the spatial size unchanged at stride 1 (for odd filter sizes).
+    static constexpr int SamePadding = -1;
+
+    // padding zeros are added around every side of the input and filter taps are dilation pixels
+    // apart. With groups > 1 the input channels and filters are split into that many groups and each
+    // filter only spans the input channels of its own group; both counts must be divisible by groups.
+    ConvolutionalLayer(int filterSize, int numFilters, int stride, int padding, int dilation, int groups, std::shared_ptr<ActivationFunction> activationFunction);
+    ConvolutionalLayer(int filterSize, int numFilters, int stride, int groups, std::shared_ptr<ActivationFunction> activationFunction);
     ConvolutionalLayer(int filterSize, int numFilters, int stride, std::shared_ptr<ActivationFunction> activationFunction);
     ConvolutionalLayer(int filterSize, int numFilters, std::shared_ptr<ActivationFunction> activationFunction);
     ConvolutionalLayer(int filterSize, int numFilters);
     
+    // While ConvolutionTuner is enabled this also picks the fastest forward configuration for
+    // inputShape, from the tuning cache or by timing each candidate.
     void initialize(const std::vector<int>& inputShape) override;
     std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input) override;
     std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient) override;
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> backwardAndUpdate(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache, double learningRate) override;
     void updateParameters(double learningRate, int miniBatchSize) override;
     void resetGradients() override;
+    size_t getParameterCount() const override;
+    void readParameters(double* buffer) const override;
+    void writeParameters(const double* buffer) override;
+    void readGradients(double* buffer) const override;
+    void writeGradients(const double* buffer) override;
+    void bindStorage(std::shared_ptr<ParameterStore> store, size_t offset) override;
+    void parametersChanged() override;
+    void parametersChanging() override;
     std::vector<int> getOutputShape(const std::vector<int>& inputShape) override;
+    void forwardBlocked(const BlockedTensor& input, BlockedTensor& output) const override;
+    Window getWindow() const override;
+    std::shared_ptr<Layer> clone() const override;
+    void save(std::ostream& stream) const override;
+
+    // Reconstructs a layer from what save wrote after the type tag.
+    static std::shared_ptr<ConvolutionalLayer> load(std::istream& stream);
+
+    std::shared_ptr<ActivationFunction> getActivationFunction() const;
+    // Folds a per-filter affine map into the weights: the layer then computes
+    // activation(scale[f] * z + shift[f]) where z was its pre-activation output.
+    // Only meaningful while the current activation is Identity.
+    void foldAffine(const std::vector<double>& scale, const std::vector<double>& shift, std::shared_ptr<ActivationFunction> activation);
+
+    // How forward computes a sample; initialize resets it to the default or the tuned choice.
+    const ConvolutionConfig& getForwardConfig() const;
+    void setForwardConfig(const ConvolutionConfig& config);
 
 private:
     int filterSize;
     int numFilters;
     int stride;
-    std::vector<std::vector<std::vector<std::vector<double>>>> filters;
-    std::vector<double> biases;
-    std::vector<std::vector<std::vector<double>>> input;
-    std::vector<std::vector<std::vector<double>>> activatedOutput;
+    int padding;
+    int dilation;
+    int groups;
+    // Input channels seen by each filter (the input depth divided by groups).
+    int filterDepth = 0;
+    // Filters [f][d][i][j] followed by one bias per filter; the gradients use the same layout.
+    LayerParameters parameters;
+    // Used by the single-argument forward and backward
+    LayerCache defaultCache;
     std::shared_ptr<ActivationFunction> activationFunction;
-    std::vector<std::vector<std::vector<std::vector<double>>>> accumulatedFilterGradients;
-    std::vector<double> accumulatedBiasGradients;
+    // Copy of filters/biases for forwardBlocked, laid out [filterBlock][depth][i][j][BlockSize]
+    // so one tap of BlockSize consecutive filters is a single vector load.
+    std::vector<double> blockedFilters;
+    std::vector<double> blockedBiases;
+    // Set between parametersChanging and parametersChanged, when the blocked copy lags the
+    // parameters and a Blocked forward runs the direct kernel instead.
+    bool blockedFiltersStale = false;
+    ConvolutionConfig forwardConfig;
+    // Per-channel kernel used by the Generic and Specialized configurations.
+    ConvolutionKernels::ChannelKernel channelKernel = ConvolutionKernels::generic;
+
+    void initializeFilters();
+    void packBlockedFilters();
+    // Flat index of the taps of filter f on its channel d, and of the first bias.
+    size_t filterOffset(int f, int d) const;
+    size_t biasOffset() const;
+    // First input channel seen by filter f.
+    int groupOffset(int f) const;
+    // Output size along one axis for an unpadded input of the given size.
+    int outputSize(int inputSize) const;
+    // Throws if the padded input is smaller than the dilated filter along either axis.
+    void checkInputSize(const std::vector<int>& inputShape) const;
+    // Indices per thread pool task when each index costs workPerIndex multiply-adds.
+    static size_t grainSize(size_t workPerIndex);
+
+    // The convolution plus bias under the configured algorithm, followed by the activation if
+    // activate is set. Leaves the halo-padded input in workspace.input and the result in
+    // workspace.output.
+    void convolve(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace, bool activate) const;
+    // The forward algorithms; both read the halo-padded input.
+    void forwardDirect(const std::vector<std::vector<std::vector<double>>>& paddedInput, std::vector<std::vector<std::vector<double>>>& output, bool activate) const;
+    void forwardIm2col(const std::vector<std::vector<std::vector<double>>>& paddedInput, std::vector<std::vector<std::vector<double>>>& output, bool activate) const;
+    void convolveBlocked(const BlockedTensor& unpaddedInput, BlockedTensor& output, bool activate) const;
+    // Times every forward configuration for inputShape and keeps the fastest.
+    void tune(const std::vector<int>& inputShape);
+    std::string tuningKey(const std::vector<int>& inputShape) const;
 
-    void initializeFilters(int inputDepth);
-    void initializeBiases();
-    void initializeAccumulatedGradients();
+    // Shared by backward and backwardAndUpdate: adds scale * gradient to target, which is laid out
+    // like the parameters (the gradients, or the parameters themselves).
+    // cache.input holds the input with its zero halo and cache.output the pre-activation, as
+    // written by forward.
+    std::vector<std::vector<std::vector<double>>> backpropagate(std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                double* target, double scale);
 };
 
 #endif // CONVOLUTIONAL_LAYER_H
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef DEPTHWISE_CONVOLUTIONAL_LAYER_H
+#define DEPTHWISE_CONVOLUTIONAL_LAYER_H
+
+#include <vector>
+#include <istream>
+#include <memory>
+#include "interfaces/ActivationFunction.h"
+#include "interfaces/AdaptiveLayer.h"
+#include "interfaces/BlockedLayer.h"
+#include "interfaces/ParameterizedLayer.h"
+#include "interfaces/SpatialLayer.h"
+#include "interfaces/Layer.h"
+#include "utils/LayerParameters.h"
+
+// Convolves every input channel with its own filterSize x filterSize filter, so the output has as
+// many channels as the input. Followed by a 1x1 ConvolutionalLayer this forms a depthwise-separable
+// convolution at a fraction of the cost of a dense one.
+class DepthwiseConvolutionalLayer : public AdaptiveLayer, public ParameterizedLayer, public BlockedLayer, public SpatialLayer {
+public:
+    DepthwiseConvolutionalLayer(int filterSize, int stride, std::shared_ptr<ActivationFunction> activationFunction);
+    DepthwiseConvolutionalLayer(int filterSize, std::shared_ptr<ActivationFunction> activationFunction);
+    explicit DepthwiseConvolutionalLayer(int filterSize);
+
+    void initialize(const std::vector<int>& inputShape) override;
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input) override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient) override;
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> backwardAndUpdate(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache, double learningRate) override;
+    void updateParameters(double learningRate, int miniBatchSize) override;
+    void resetGradients() override;
+    size_t getParameterCount() const override;
+    void readParameters(double* buffer) const override;
+    void writeParameters(const double* buffer) override;
+    void readGradients(double* buffer) const override;
+    void writeGradients(const double* buffer) override;
+    void bindStorage(std::shared_ptr<ParameterStore> store, size_t offset) override;
+    void parametersChanged() override;
+    std::vector<int> getOutputShape(const std::vector<int>& inputShape) override;
+    void forwardBlocked(const BlockedTensor& input, BlockedTensor& output) const override;
+    Window getWindow() const override;
+    std::shared_ptr<Layer> clone() const override;
+    void save(std::ostream& stream) const override;
+
+    // Reconstructs a layer from what save wrote after the type tag.
+    static std::shared_ptr<DepthwiseConvolutionalLayer> load(std::istream& stream);
+
+private:
+    int filterSize;
+    int stride;
+    int channels = 0;
+    // One filter per channel, [channel][i][j], followed by one bias per channel; the gradients
+    // use the same layout.
+    LayerParameters parameters;
+    // Used by the single-argument forward and backward
+    LayerCache defaultCache;
+    std::shared_ptr<ActivationFunction> activationFunction;
+    // Copy of filters/biases for forwardBlocked, laid out [channelBlock][i][j][BlockSize].
+    std::vector<double> blockedFilters;
+    std::vector<double> blockedBiases;
+
+    void packBlockedFilters();
+    // Convolution plus bias, before the activation.
+    void convolve(const std::vector<std::vector<std::vector<double>>>& input, std::vector<std::vector<std::vector<double>>>& preActivation) const;
+    void applyActivation(std::vector<std::vector<std::vector<double>>>& values) const;
+
+    // Shared by backward and backwardAndUpdate: adds scale * gradient to target, which is laid out
+    // like the parameters (the gradients, or the parameters themselves). cache.output holds the
+    // pre-activation, as written by forward.
+    std::vector<std::vector<std::vector<double>>> backpropagate(std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                double* target, double scale);
+};
+
+#endif // DEPTHWISE_CONVOLUTIONAL_LAYER_H
@@ -3,6 +3,8 @@
 
 #include "interfaces/AdaptiveLayer.h"
 #include <vector>
+#include <istream>
+#include <memory>
 
 class FlattenLayer : public AdaptiveLayer {
 public:
@@ -11,7 +13,15 @@ public:
     void initialize(const std::vector<int>& inputShape) override;
     std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input) override;
     std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient) override;
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) override;
     std::vector<int> getOutputShape(const std::vector<int>& inputShape) override;
+    std::shared_ptr<Layer> clone() const override;
+    void save(std::ostream& stream) const override;
+
+    // Reconstructs a layer from what save wrote after the type tag.
+    static std::shared_ptr<FlattenLayer> load(std::istream& stream);
 
 private:
     int depth;
@@ -4,7 +4,10 @@
 #include "interfaces/AdaptiveLayer.h"
 #include "interfaces/ParameterizedLayer.h"
 #include "interfaces/ActivationFunction.h"
+#include "utils/LayerParameters.h"
 #include <vector>
+#include <cstdint>
+#include <istream>
 #include <random>
 #include <memory>
 
@@ -15,22 +18,66 @@ public:
     void initialize(const std::vector<int>& inputShape) override;
     std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input) override;
     std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient) override;
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> backwardAndUpdate(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache, double learningRate) override;
     void updateParameters(double learningRate, int miniBatchSize) override;
     void resetGradients() override;
+    size_t getParameterCount() const override;
+    void readParameters(double* buffer) const override;
+    void writeParameters(const double* buffer) override;
+    void readGradients(double* buffer) const override;
+    void writeGradients(const double* buffer) override;
+    void bindStorage(std::shared_ptr<ParameterStore> store, size_t offset) override;
+    void parametersChanged() override;
+    void parametersChanging() override;
     std::vector<int> getOutputShape(const std::vector<int>& inputShape) override;
+    std::shared_ptr<Layer> clone() const override;
+    void save(std::ostream& stream) const override;
+
+    // Reconstructs a layer from what save wrote after the type tag.
+    static std::shared_ptr<FullyConnectedLayer> load(std::istream& stream);
+
+    std::shared_ptr<ActivationFunction> getActivationFunction() const;
+    // Folds a per-output affine map into the weights: the layer then computes
+    // activation(scale[j] * z + shift[j]) where z was its pre-activation output.
+    // Only meaningful while the current activation is Identity.
+    void foldAffine(const std::vector<double>& scale, const std::vector<double>& shift, std::shared_ptr<ActivationFunction> activation);
+
+    // In mixed precision the layer computes with a bfloat16 copy of the weights, caches its input
+    // as bfloat16 and rounds the activations and gradients it passes on to bfloat16, all with
+    // float32 accumulation. The double weights stay the master copy updated by updateParameters.
+    // Between parametersChanging and parametersChanged the layer computes in full precision.
+    void setMixedPrecision(bool enabled);
 
 private:
     int inputSize;
     int outputSize;
-    std::vector<std::vector<double>> weights;
-    std::vector<double> biases;
-    std::vector<std::vector<std::vector<double>>> input;
+    // Weights [input][output] followed by one bias per output; the gradients use the same layout.
+    LayerParameters parameters;
+    // Used by the single-argument forward and backward
+    LayerCache defaultCache;
     std::shared_ptr<ActivationFunction> activationFunction;
-    std::vector<std::vector<double>> accumulatedWeightGradients;
-    std::vector<double> accumulatedBiasGradients;
+    bool mixedPrecision = false;
+    std::vector<uint16_t> compactWeights; // bfloat16, transposed to [output][input]
+    bool compactWeightsStale = false;
 
     void initializeWeights();
-    void initializeAccumulatedGradients();
+    void refreshCompactWeights();
+    bool usesCompactWeights() const;
+    std::vector<double> compactPreActivation(const std::vector<uint16_t>& compactInput) const;
+    std::vector<double> fullPrecisionPreActivation(const std::vector<double>& input) const;
+    // Indices per thread pool task when each index costs workPerIndex multiply-adds.
+    static size_t grainSize(size_t workPerIndex);
+    const double* biases() const;
+
+    // Shared by backward and backwardAndUpdate: adds scale * gradient to target, which is laid out
+    // like the parameters (the gradients, or the parameters themselves).
+    std::vector<std::vector<std::vector<double>>> backpropagate(const std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                double* target, double scale);
+    std::vector<std::vector<std::vector<double>>> backpropagateMixed(const std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                     double* target, double scale);
 };
 
 #endif // FULLY_CONNECTED_LAYER_H
\ No newline at end of file
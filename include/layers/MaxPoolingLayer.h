@@ -0,0 +1,35 @@
+#ifndef MAX_POOLING_LAYER_H
+#define MAX_POOLING_LAYER_H
+
+#include "interfaces/BlockedLayer.h"
+#include "interfaces/SpatialLayer.h"
+#include <vector>
+#include <istream>
+#include <memory>
+
+// Non-overlapping max pooling over poolSize x poolSize windows of every channel.
+class MaxPoolingLayer : public BlockedLayer, public SpatialLayer {
+public:
+    explicit MaxPoolingLayer(int poolSize);
+
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input) override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient) override;
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) override;
+    void forwardBlocked(const BlockedTensor& input, BlockedTensor& output) const override;
+    Window getWindow() const override;
+    std::vector<int> getOutputShape(const std::vector<int>& inputShape) override;
+    std::shared_ptr<Layer> clone() const override;
+    void save(std::ostream& stream) const override;
+
+    // Reconstructs a layer from what save wrote after the type tag.
+    static std::shared_ptr<MaxPoolingLayer> load(std::istream& stream);
+
+private:
+    int poolSize;
+    // Used by the single-argument forward and backward
+    LayerCache defaultCache;
+};
+
+#endif // MAX_POOLING_LAYER_H
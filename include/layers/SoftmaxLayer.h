@@ -3,16 +3,25 @@
 
 #include "interfaces/Layer.h"
 #include <vector>
+#include <istream>
+#include <memory>
 
 class SoftmaxLayer : public Layer {
 public:
     std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input) override;
     std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient) override;
+    std::vector<std::vector<std::vector<double>>> forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) override;
+    std::vector<std::vector<std::vector<double>>> infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const override;
+    std::vector<std::vector<std::vector<double>>> backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) override;
     std::vector<int> getOutputShape(const std::vector<int>& inputShape) override;
+    std::shared_ptr<Layer> clone() const override;
+    void save(std::ostream& stream) const override;
+
+    // Reconstructs a layer from what save wrote after the type tag.
+    static std::shared_ptr<SoftmaxLayer> load(std::istream& stream);
 
 private:
-    std::vector<std::vector<std::vector<double>>> input;
-    std::vector<double> softmax(const std::vector<double>& input);
+    std::vector<double> softmax(const std::vector<double>& input) const;
 };
 
 #endif // SOFTMAX_LAYER_H
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef INFERENCE_CLIENT_H
+#define INFERENCE_CLIENT_H
+
+#include <string>
+#include <vector>
+
+// Blocking client for InferenceServer; one request in flight per client.
+class InferenceClient {
+public:
+    explicit InferenceClient(const std::string& socketPath);
+    ~InferenceClient();
+
+    InferenceClient(const InferenceClient&) = delete;
+    InferenceClient& operator=(const InferenceClient&) = delete;
+
+    // Sends a flattened (depth, height, width) input and returns the flattened network output.
+    std::vector<double> infer(const std::vector<double>& input);
+    std::vector<int> getInputShape();
+    std::string getStats();
+
+private:
+    int fd;
+
+    std::vector<char> call(unsigned type, const void* payload, unsigned count, size_t payloadBytes);
+};
+
+#endif // INFERENCE_CLIENT_H
@@ -0,0 +1,77 @@
+#ifndef INFERENCE_SERVER_H
+#define INFERENCE_SERVER_H
+
+#include "cnn/CNN.h"
+#include "serving/ServerStats.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct InferenceServerConfig {
+    int maxBatchSize = 32;
+    std::chrono::microseconds maxWait = std::chrono::microseconds(2000);
+    int numWorkers = 4;
+};
+
+// Serves CNN::forward over a Unix domain socket. Requests arriving concurrently on any
+// connection are coalesced into batches of up to maxBatchSize, or whatever has arrived maxWait
+// after the oldest pending request, and each batch runs on one thread of a worker pool. The
+// workers share the model read-only, each with its own CNN::InferenceWorkspace.
+class InferenceServer {
+public:
+    InferenceServer(const CNN& model, const InferenceServerConfig& config);
+    ~InferenceServer();
+
+    InferenceServer(const InferenceServer&) = delete;
+    InferenceServer& operator=(const InferenceServer&) = delete;
+
+    // Listens on socketPath and blocks serving connections until stop() is called.
+    void run(const std::string& socketPath);
+    void stop();
+
+    const ServerStats& getStats() const;
+
+private:
+    struct Request {
+        std::vector<std::vector<std::vector<double>>> input;
+        std::promise<std::vector<std::vector<std::vector<double>>>> result;
+    };
+    using Batch = std::vector<std::unique_ptr<Request>>;
+
+    const CNN& model;
+    InferenceServerConfig config;
+    ServerStats stats;
+    std::vector<int> inputShape;
+    size_t inputSize;
+
+    std::mutex mutex;
+    std::condition_variable pendingCondition;
+    std::condition_variable batchCondition;
+    std::deque<std::pair<std::unique_ptr<Request>, std::chrono::steady_clock::time_point>> pending;
+    std::deque<Batch> batches;
+    bool stopping;
+
+    std::mutex connectionMutex;
+    std::set<int> connections;
+    // Connection threads that have returned, for run to join
+    std::vector<std::thread::id> finishedConnections;
+    int listenSocket;
+
+    std::thread batcher;
+    std::vector<std::thread> workers;
+
+    void batchLoop();
+    void workerLoop();
+    void serveConnection(int fd);
+    bool handleRequest(int fd);
+    std::future<std::vector<std::vector<std::vector<double>>>> submit(std::vector<std::vector<std::vector<double>>> input);
+};
+
+#endif // INFERENCE_SERVER_H
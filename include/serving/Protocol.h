@@ -0,0 +1,38 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Wire format of the inference server. A request is a RequestHeader followed by
+// `count` doubles (Infer) or nothing (Stats, Shape). A response is a ResponseHeader followed by
+// `count` doubles (Infer), int32 dimensions (Shape) or characters (Stats and errors).
+class Protocol {
+public:
+    enum MessageType : uint32_t {
+        Infer = 1,
+        Stats = 2,
+        Shape = 3,
+    };
+
+    enum Status : uint32_t {
+        Ok = 0,
+        Error = 1,
+    };
+
+    struct RequestHeader {
+        uint32_t type;
+        uint32_t count;
+    };
+
+    struct ResponseHeader {
+        uint32_t status;
+        uint32_t count;
+    };
+
+    // Blocking full-length socket I/O; return false when the peer has gone away.
+    static bool readFully(int fd, void* data, size_t size);
+    static bool writeFully(int fd, const void* data, size_t size);
+};
+
+#endif // PROTOCOL_H
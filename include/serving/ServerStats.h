@@ -0,0 +1,30 @@
+#ifndef SERVER_STATS_H
+#define SERVER_STATS_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Thread-safe latency and batching statistics of the inference server. Latency percentiles are
+// computed over the most recent latencyWindow requests.
+class ServerStats {
+public:
+    explicit ServerStats(int maxBatchSize, size_t latencyWindow = 100000);
+
+    void recordBatch(int batchSize);
+    void recordLatency(double microseconds);
+
+    // Human-readable summary: request count, p50/p90/p99/p99.9 latency and batch-size histogram.
+    std::string report() const;
+
+private:
+    mutable std::mutex mutex;
+    size_t latencyWindow;
+    std::deque<double> latencies;
+    std::vector<uint64_t> batchSizeCounts;
+    uint64_t totalRequests;
+};
+
+#endif // SERVER_STATS_H
@@ -0,0 +1,24 @@
+#ifndef BFLOAT16_H
+#define BFLOAT16_H
+
+#include <cstddef>
+#include <cstdint>
+
+// bfloat16 values stored as raw uint16_t: the upper half of an IEEE float32.
+// Kernels take bf16 operands but always accumulate in float32. The dot product uses
+// AVX512-BF16 instructions when compiled for a CPU that has them, and plain float math otherwise.
+class BFloat16 {
+public:
+    // Rounds to the nearest bf16 value, ties to even; NaNs stay NaN.
+    static uint16_t fromFloat(float value);
+    static float toFloat(uint16_t value);
+
+    static void fromDoubles(const double* input, uint16_t* output, size_t count);
+
+    // The double closest to value that is exactly representable in bf16.
+    static double round(double value);
+
+    static float dot(const uint16_t* a, const uint16_t* b, size_t count);
+};
+
+#endif // BFLOAT16_H
@@ -0,0 +1,30 @@
+#ifndef BLOCKED_TENSOR_H
+#define BLOCKED_TENSOR_H
+
+#include <cstddef>
+#include <vector>
+
+// Channel-blocked (NCHWc) activation layout: channels are grouped in blocks of BlockSize and a
+// block is stored as [height][width][BlockSize], so the BlockSize channels of one pixel are
+// contiguous and kernels can vectorize across channels. Channels are zero-padded to a whole
+// number of blocks.
+struct BlockedTensor {
+    static const int BlockSize = 8;
+
+    int channels = 0;
+    int height = 0;
+    int width = 0;
+    std::vector<double> data;
+
+    void resize(int channels, int height, int width);
+    int blocks() const { return (channels + BlockSize - 1) / BlockSize; }
+    double* pixel(int block, int y, int x) { return &data[((static_cast<size_t>(block) * height + y) * width + x) * BlockSize]; }
+    const double* pixel(int block, int y, int x) const { return &data[((static_cast<size_t>(block) * height + y) * width + x) * BlockSize]; }
+
+    static BlockedTensor fromNested(const std::vector<std::vector<std::vector<double>>>& input);
+    std::vector<std::vector<std::vector<double>>> toNested() const;
+    // Copies this tensor into padded, surrounded by a zero border of the given width.
+    void copyWithHalo(int padding, BlockedTensor& padded) const;
+};
+
+#endif // BLOCKED_TENSOR_H
@@ -0,0 +1,24 @@
+#ifndef CONVOLUTION_KERNELS_H
+#define CONVOLUTION_KERNELS_H
+
+#include <vector>
+
+// Single-channel convolution kernels used by ConvolutionalLayer::forward. Each kernel adds the
+// convolution of one (already halo-padded) input channel with one filter onto output, whose size
+// determines how many output pixels are computed. filter holds filterSize * filterSize taps in
+// row-major order.
+class ConvolutionKernels {
+public:
+    using ChannelKernel = void (*)(const std::vector<std::vector<double>>& input, const double* filter, int filterSize,
+                                   int stride, int dilation, std::vector<std::vector<double>>& output);
+
+    // Returns a kernel specialized for the filter size and stride when one exists (filter sizes
+    // 1, 3, 5 and 7, strides 1 and 2, no dilation); otherwise the generic kernel.
+    static ChannelKernel select(int filterSize, int stride, int dilation);
+
+    // Handles any filter size, stride and dilation.
+    static void generic(const std::vector<std::vector<double>>& input, const double* filter, int filterSize,
+                        int stride, int dilation, std::vector<std::vector<double>>& output);
+};
+
+#endif // CONVOLUTION_KERNELS_H
@@ -0,0 +1,63 @@
+#ifndef CONVOLUTION_TUNER_H
+#define CONVOLUTION_TUNER_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+// How ConvolutionalLayer::forward computes one sample.
+struct ConvolutionConfig {
+    enum Algorithm {
+        // Per-channel kernels: the generic one, or the one specialized for the filter size and stride
+        Generic,
+        Specialized,
+        // Input patches unrolled into a matrix and multiplied by the filters, tileSize output
+        // pixels at a time
+        Im2col,
+        // The channel-blocked forwardBlocked path, converting to and from the blocked layout
+        Blocked
+    };
+
+    Algorithm algorithm = Specialized;
+    int tileSize = 0;
+
+    std::string toString() const;
+    // Parses what toString wrote; returns false for anything else.
+    static bool parse(const std::string& text, ConvolutionConfig& config);
+};
+
+// Process-wide settings and cache for tuning convolutions. While enabled, ConvolutionalLayer::initialize
+// times every configuration for its exact shape and keeps the fastest. Choices are keyed by the CPU
+// model, the thread count and the shape, and are appended to a cache file, so later runs on the same
+// machine pick up the tuned configuration without timing anything.
+class ConvolutionTuner {
+public:
+    // An empty cachePath keeps the choices for this process only.
+    static void enable(const std::string& cachePath);
+    static void disable();
+    static bool isEnabled();
+
+    static bool lookup(const std::string& key, ConvolutionConfig& config);
+    static void store(const std::string& key, const ConvolutionConfig& config);
+
+    // The host CPU's model name, or "unknown CPU" where it cannot be read.
+    static std::string cpuModel();
+    // Best time in seconds of several calls to run, after one warm-up call.
+    static double secondsPerRun(const std::function<void()>& run);
+
+private:
+    struct State {
+        std::mutex mutex;
+        bool enabled = false;
+        bool loaded = false;
+        std::string cachePath;
+        std::map<std::string, ConvolutionConfig> choices;
+    };
+
+    static State& state();
+    // Reads the cache file into choices once; the caller holds the mutex.
+    static void load(State& state);
+};
+
+#endif // CONVOLUTION_TUNER_H
@@ -1,18 +1,37 @@
 #ifndef IMAGE_DATA_H
 #define IMAGE_DATA_H
 
+#include <cstdint>
 #include <vector>
 
+// A labelled sample. Samples decoded from 8-bit sources are stored compactly, as one uint8 pixel
+// buffer with a scale factor and a class index, and are only expanded to doubles and a one-hot
+// label when a batch asks for them. Floating-point samples (normalized or augmented) keep the
+// nested form.
 class ImageData {
 public:
     ImageData(const std::vector<std::vector<std::vector<double>>>& imageData, const std::vector<double>& label);
+    // pixels holds depth * height * width values in [depth][height][width] order.
+    ImageData(int depth, int height, int width, std::vector<uint8_t> pixels, double pixelScale, uint16_t label, uint16_t numClasses);
 
-    const std::vector<std::vector<std::vector<double>>>& getImageData() const;
-    const std::vector<double>& getLabel() const;
+    std::vector<std::vector<std::vector<double>>> getImageData() const;
+    // One-hot for compact samples.
+    std::vector<double> getLabel() const;
+    int getLabelIndex() const;
+    int getNumClasses() const;
+    bool isCompact() const;
 
 private:
     std::vector<std::vector<std::vector<double>>> imageData;
     std::vector<double> label;
+
+    std::vector<uint8_t> pixels;
+    double pixelScale = 1.0;
+    uint16_t depth = 0;
+    uint16_t height = 0;
+    uint16_t width = 0;
+    uint16_t labelIndex = 0;
+    uint16_t numClasses = 0;
 };
 
-#endif // IMAGE_DATA_H
\ No newline at end of file
+#endif // IMAGE_DATA_H
@@ -0,0 +1,46 @@
+#ifndef LAYER_PARAMETERS_H
+#define LAYER_PARAMETERS_H
+
+#include "utils/ParameterStore.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// A layer's parameters and their accumulated gradients as two flat arrays of equal size. They
+// start out in storage owned by the layer; bind moves them into a range of a ParameterStore, where
+// the layer then reads and writes them in place. A copy always owns its storage, so cloning a
+// layer never shares parameters with the original.
+class LayerParameters {
+public:
+    LayerParameters() = default;
+    LayerParameters(const LayerParameters& other);
+    LayerParameters& operator=(const LayerParameters& other);
+
+    // Switches to owned storage of count zeroed parameters and gradients.
+    void resize(size_t count);
+    // Copies the current values into store at offset and uses that range from then on.
+    void bind(std::shared_ptr<ParameterStore> store, size_t offset);
+
+    size_t size() const { return count; }
+    double* parameters() { return parameterData; }
+    const double* parameters() const { return parameterData; }
+    double* gradients() { return gradientData; }
+    const double* gradients() const { return gradientData; }
+
+    void zeroGradients();
+    // parameters -= step * gradients, then the gradients are zeroed.
+    void applyGradients(double step);
+
+private:
+    size_t count = 0;
+    double* parameterData = nullptr;
+    double* gradientData = nullptr;
+    std::vector<double> ownedParameters;
+    std::vector<double> ownedGradients;
+    // Keeps the bound store alive for as long as this layer uses it.
+    std::shared_ptr<ParameterStore> store;
+
+    void copyFrom(const LayerParameters& other);
+};
+
+#endif // LAYER_PARAMETERS_H
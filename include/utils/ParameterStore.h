@@ -0,0 +1,37 @@
+#ifndef PARAMETER_STORE_H
+#define PARAMETER_STORE_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
+// One contiguous, cache-line aligned buffer of parameters and one of gradients, shared by all
+// parameterized layers of a network. Each layer's values occupy a range at some offset, in the
+// order of its flat read/write methods, so whole-network operations are single sweeps.
+class ParameterStore {
+public:
+    static constexpr size_t Alignment = 64;
+
+    explicit ParameterStore(size_t size);
+
+    size_t size() const;
+    double* parameters();
+    const double* parameters() const;
+    double* gradients();
+    const double* gradients() const;
+
+    void zeroGradients();
+    // parameters -= step * gradients, then the gradients are zeroed, in one pass.
+    void applyGradients(double step);
+
+private:
+    struct FreeDeleter {
+        void operator()(double* buffer) const { std::free(buffer); }
+    };
+
+    size_t count;
+    std::unique_ptr<double[], FreeDeleter> parameterBuffer;
+    std::unique_ptr<double[], FreeDeleter> gradientBuffer;
+};
+
+#endif // PARAMETER_STORE_H
@@ -0,0 +1,31 @@
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+#include "interfaces/ActivationFunction.h"
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Binary helpers for the network file format. Values are written in host byte order;
+// the read functions throw std::runtime_error on a truncated or malformed stream.
+class Serialization {
+public:
+    static void writeInt(std::ostream& stream, int32_t value);
+    static int32_t readInt(std::istream& stream);
+
+    static void writeDouble(std::ostream& stream, double value);
+    static double readDouble(std::istream& stream);
+
+    static void writeString(std::ostream& stream, const std::string& value);
+    static std::string readString(std::istream& stream);
+
+    static void writeDoubles(std::ostream& stream, const double* values, size_t count);
+    static void readDoubles(std::istream& stream, double* values, size_t count);
+
+    // Reads an activation function written by ActivationFunction::save.
+    static std::shared_ptr<ActivationFunction> readActivationFunction(std::istream& stream);
+};
+
+#endif // SERIALIZATION_H
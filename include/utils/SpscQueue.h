@@ -0,0 +1,96 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread. The ring
+// holds a power-of-two number of slots; head and tail only ever grow and are masked on access.
+// Each side keeps a cached copy of the other side's index in its own cache line, so the shared
+// indices are only reloaded when the queue looks full or empty.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. Moves value in and returns true, or returns false (leaving value alone) when full.
+    bool tryPush(T& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead == slots.size()) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead == slots.size()) {
+                return false;
+            }
+        }
+        slots[position & mask] = std::move(value);
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Moves the oldest element into value, or returns false when empty.
+    bool tryPop(T& value) {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(slots[position & mask]);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Blocking versions that back off while the queue is full or empty.
+    void push(T value) {
+        for (Backoff backoff; !tryPush(value); backoff.wait()) {
+        }
+    }
+
+    T pop() {
+        T value;
+        for (Backoff backoff; !tryPop(value); backoff.wait()) {
+        }
+        return value;
+    }
+
+    // Spins with yields first, then sleeps, so a long wait does not keep a core busy.
+    class Backoff {
+    public:
+        void wait() {
+            if (++attempts < 1000) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+
+    private:
+        int attempts = 0;
+    };
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    // Written by the consumer
+    alignas(64) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+    // Written by the producer
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,77 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for loops inside a single operator. parallelFor splits its range lazily in
+// halves: the running thread keeps one half and pushes the other onto its own deque, where idle
+// workers steal it from the opposite end. A thread waiting for its loop runs queued tasks in the
+// meantime, so parallelFor can be called from any thread, including from inside another
+// parallelFor body or from an outer data-parallel worker, without deadlocking.
+class ThreadPool {
+public:
+    // numThreads workers besides the threads calling parallelFor; 0 runs every loop on the caller.
+    // With pinThreads, worker i is bound to CPU i + 1 where the platform supports it.
+    ThreadPool(int numThreads, bool pinThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Calls body(chunkBegin, chunkEnd) on disjoint chunks of at most grain indices covering
+    // [begin, end), and returns once all of them have run. If a chunk throws, the chunks not yet
+    // started are skipped and the first exception is rethrown on the calling thread.
+    void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
+    int getThreadCount() const;
+
+    // Pool shared by the layers. Unless configured, it has one worker per hardware thread minus one.
+    static ThreadPool& global();
+    // Replaces the shared pool; only call while no loop is running on it.
+    static void configureGlobal(int numThreads, bool pinThreads);
+
+private:
+    // State of one parallelFor call, shared by its tasks; lives on the caller's stack until every
+    // task has finished.
+    struct Loop {
+        const std::function<void(size_t, size_t)>* body;
+        size_t grain;
+        std::atomic<size_t> pending{1};
+        std::atomic<bool> failed{false};
+        std::mutex errorMutex;
+        std::exception_ptr error;
+    };
+    struct Task {
+        Loop* loop;
+        size_t begin;
+        size_t end;
+    };
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // One queue per worker, plus a last one shared by all threads outside the pool.
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void workerLoop(int index, bool pinThread);
+    int currentQueue() const;
+    void push(int queue, const Task& task);
+    bool runQueuedTask(int queue);
+    void run(Task task, int queue);
+};
+
+#endif // THREAD_POOL_H
@@ -9,6 +9,7 @@ public:
 
     double activate(double x) const override;
     double derivative(double x) const override;
+    void save(std::ostream& stream) const override;
 
 private:
     double alpha;
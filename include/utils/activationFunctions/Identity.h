@@ -0,0 +1,15 @@
+#ifndef IDENTITY_H
+#define IDENTITY_H
+
+#include "interfaces/ActivationFunction.h"
+
+// Leaves values unchanged; for a layer whose output is normalized and activated by a following
+// BatchNormLayer.
+class Identity : public ActivationFunction {
+public:
+    double activate(double x) const override;
+    double derivative(double x) const override;
+    void save(std::ostream& stream) const override;
+};
+
+#endif // IDENTITY_H
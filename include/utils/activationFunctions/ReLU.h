@@ -7,6 +7,7 @@ class ReLU : public ActivationFunction {
 public:
     double activate(double x) const override;
     double derivative(double x) const override;
+    void save(std::ostream& stream) const override;
 };
 
 #endif // RELU_H
\ No newline at end of file
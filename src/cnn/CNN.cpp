@@ -1,5 +1,26 @@
 #include "cnn/CNN.h"
+#include "cnn/LayerPipeline.h"
+#include "data/InMemoryDataSource.h"
+#include "distributed/GradientSynchronizer.h"
+#include "layers/BatchNormLayer.h"
+#include "layers/ConvolutionalLayer.h"
+#include "layers/DepthwiseConvolutionalLayer.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/MaxPoolingLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/ParameterStore.h"
+#include "utils/Serialization.h"
+#include "utils/ThreadPool.h"
+#include "utils/activationFunctions/Identity.h"
 #include <random> 
+#include <numeric>
+#include <thread>
+#include <stdexcept>
+#include <future>
+#include <deque>
+#include <chrono>
+#include <limits>
 
 CNN::CNN(double learningRate, std::initializer_list<int> inputShape)
     : learningRate(learningRate), inputShape(inputShape.begin(), inputShape.end()) {}
@@ -14,6 +35,30 @@ void CNN::addLayer(std::shared_ptr<Layer> layer) {
     layers.push_back(layer);
     layerShapes.push_back(currentShape);
     layerShapes.push_back(inputShape);
+    rebuildParameterStore();
+    pipeline.reset();
+}
+
+void CNN::rebuildParameterStore() {
+    parameterizedLayers.clear();
+    size_t total = 0;
+    for (const auto& layer : layers) {
+        auto* paramLayer = dynamic_cast<ParameterizedLayer*>(layer.get());
+        parameterizedLayers.push_back(paramLayer);
+        if (paramLayer) {
+            total += paramLayer->getParameterCount();
+        }
+    }
+
+    // Each layer copies its current values over, so this is safe on a trained network
+    parameterStore = std::make_shared<ParameterStore>(total);
+    size_t offset = 0;
+    for (auto* paramLayer : parameterizedLayers) {
+        if (paramLayer) {
+            paramLayer->bindStorage(parameterStore, offset);
+            offset += paramLayer->getParameterCount();
+        }
+    }
 }
 
 std::vector<std::vector<std::vector<double>>> CNN::forward(const std::vector<std::vector<std::vector<double>>>& input) {
@@ -32,68 +77,518 @@ std::vector<std::vector<std::vector<double>>> CNN::backward(const std::vector<st
     return grad;
 }
 
-void CNN::updateParameters(int miniBatchSize) {
+std::vector<std::vector<std::vector<std::vector<double>>>> CNN::forwardBatch(const std::vector<std::vector<std::vector<std::vector<double>>>>& inputs, InferenceWorkspace& workspace) const {
+    auto& caches = workspace.caches;
+    caches.resize(layers.size());
+    auto outputs = inputs;
+    for (size_t l = 0; l < layers.size();) {
+        if (!dynamic_cast<const BlockedLayer*>(layers[l].get())) {
+            for (auto& output : outputs) {
+                output = layers[l]->infer(output, caches[l]);
+            }
+            ++l;
+            continue;
+        }
+
+        size_t runEnd = l;
+        while (runEnd < layers.size() && dynamic_cast<const BlockedLayer*>(layers[runEnd].get())) {
+            ++runEnd;
+        }
+        auto& blocked = workspace.blocked;
+        auto& next = workspace.next;
+        blocked.resize(outputs.size());
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            blocked[i] = BlockedTensor::fromNested(outputs[i]);
+        }
+        for (; l < runEnd; ++l) {
+            const auto* blockedLayer = dynamic_cast<const BlockedLayer*>(layers[l].get());
+            for (auto& tensor : blocked) {
+                blockedLayer->forwardBlocked(tensor, next);
+                std::swap(tensor, next);
+            }
+        }
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            outputs[i] = blocked[i].toNested();
+        }
+    }
+    return outputs;
+}
+
+std::vector<std::vector<std::vector<double>>> CNN::predict(const std::vector<std::vector<std::vector<double>>>& input, InferenceWorkspace& workspace) const {
+    return forwardBatch({ input }, workspace).front();
+}
+
+std::vector<std::vector<std::vector<double>>> CNN::predict(const std::vector<std::vector<std::vector<double>>>& input) const {
+    InferenceWorkspace workspace;
+    return predict(input, workspace);
+}
+
+namespace {
+
+// A half-open range [begin, end) of rows or columns.
+struct Span {
+    int begin;
+    int end;
+};
+
+int outputExtent(const SpatialLayer::Window& window, int inputSize) {
+    int reach = inputSize + 2 * window.padding - window.dilation * (window.size - 1) - 1;
+    return reach < 0 ? 0 : reach / window.stride + 1;
+}
+
+// The input rows a layer needs for its output rows, clipped to the input; the clipped part is
+// exactly the layer's own zero padding.
+Span inputSpan(const SpatialLayer::Window& window, Span output, int inputSize) {
+    int begin = std::max(0, output.begin * window.stride - window.padding);
+    // Starting on a multiple of the stride keeps local output rows aligned with global ones
+    begin -= begin % window.stride;
+    int end = std::min(inputSize, (output.end - 1) * window.stride - window.padding + window.dilation * (window.size - 1) + 1);
+    return {begin, end};
+}
+
+void crop(const std::vector<std::vector<std::vector<double>>>& input, Span rows, Span columns,
+          std::vector<std::vector<std::vector<double>>>& output) {
+    output.resize(input.size());
+    for (size_t d = 0; d < input.size(); ++d) {
+        output[d].resize(rows.end - rows.begin);
+        for (int i = rows.begin; i < rows.end; ++i) {
+            const auto& row = input[d][i];
+            output[d][i - rows.begin].assign(row.begin() + columns.begin, row.begin() + columns.end);
+        }
+    }
+}
+
+} // namespace
+
+std::vector<SpatialLayer::Window> CNN::getSpatialWindows() const {
+    std::vector<SpatialLayer::Window> windows;
     for (const auto& layer : layers) {
-        if (auto paramLayer = std::dynamic_pointer_cast<ParameterizedLayer>(layer)) {
-            paramLayer->updateParameters(learningRate, miniBatchSize);
+        auto* spatialLayer = dynamic_cast<const SpatialLayer*>(layer.get());
+        if (!spatialLayer) {
+            throw std::invalid_argument("Tiled inference needs a fully convolutional network.");
+        }
+        windows.push_back(spatialLayer->getWindow());
+    }
+    return windows;
+}
+
+std::vector<int> CNN::getTiledOutputShape(int height, int width) const {
+    if (getInputShape().size() != 3) {
+        throw std::invalid_argument("Tiled inference needs a (depth, height, width) input.");
+    }
+    for (const auto& window : getSpatialWindows()) {
+        height = outputExtent(window, height);
+        width = outputExtent(window, width);
+    }
+    if (height < 1 || width < 1) {
+        throw std::invalid_argument("The image is smaller than the network's receptive field.");
+    }
+    int depth = layerShapes.empty() ? inputShape[0] : layerShapes.back()[0];
+    return {depth, height, width};
+}
+
+int CNN::chooseTileSize(const std::vector<SpatialLayer::Window>& windows, int outputHeight, int outputWidth, size_t tileBytes) const {
+    // Working set of the largest layer for a tile of side t, counting the padded copy of the
+    // input and the copy of the output each layer keeps next to what it receives and returns.
+    auto bytesFor = [&](int t) {
+        size_t largest = 0;
+        size_t length = t;
+        for (size_t l = windows.size(); l-- > 0;) {
+            const auto& window = windows[l];
+            size_t inputLength = (length - 1) * window.stride + window.dilation * (window.size - 1) + window.stride;
+            size_t paddedLength = inputLength + 2 * window.padding;
+            size_t inputChannels = layerShapes[2 * l][0];
+            size_t outputChannels = layerShapes[2 * l + 1][0];
+            size_t values = inputChannels * (inputLength * inputLength + paddedLength * paddedLength) + 2 * outputChannels * length * length;
+            largest = std::max(largest, values * sizeof(double));
+            length = inputLength;
+        }
+        return largest;
+    };
+
+    // The working set grows with t, so the largest fitting side is found by bisection
+    int low = 1;
+    int high = std::max(outputHeight, outputWidth);
+    while (low < high) {
+        int middle = low + (high - low + 1) / 2;
+        if (bytesFor(middle) <= tileBytes) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+void CNN::forwardTiled(int height, int width, const TileReader& readTile, const TileWriter& writeTile, size_t tileBytes) const {
+    auto outputShape = getTiledOutputShape(height, width);
+    auto windows = getSpatialWindows();
+    size_t layerCount = windows.size();
+    int depth = getInputShape()[0];
+
+    // Input height and width of every layer, and of the final output
+    std::vector<int> heights = {height};
+    std::vector<int> widths = {width};
+    for (const auto& window : windows) {
+        heights.push_back(outputExtent(window, heights.back()));
+        widths.push_back(outputExtent(window, widths.back()));
+    }
+
+    int tileSize = chooseTileSize(windows, outputShape[1], outputShape[2], tileBytes);
+    int tileRows = (outputShape[1] + tileSize - 1) / tileSize;
+    int tileColumns = (outputShape[2] + tileSize - 1) / tileSize;
+
+    // A tile that throws stops the remaining ones; parallelFor rethrows its exception here
+    ThreadPool::global().parallelFor(0, static_cast<size_t>(tileRows) * tileColumns, 1, [&](size_t begin, size_t end) {
+        std::vector<Span> rows(layerCount + 1);
+        std::vector<Span> columns(layerCount + 1);
+        std::vector<std::vector<std::vector<double>>> current;
+        LayerCache cache;
+        for (size_t tile = begin; tile < end; ++tile) {
+            int y = static_cast<int>(tile / tileColumns) * tileSize;
+            int x = static_cast<int>(tile % tileColumns) * tileSize;
+            rows[layerCount] = {y, std::min(outputShape[1], y + tileSize)};
+            columns[layerCount] = {x, std::min(outputShape[2], x + tileSize)};
+            for (size_t l = layerCount; l-- > 0;) {
+                rows[l] = inputSpan(windows[l], rows[l + 1], heights[l]);
+                columns[l] = inputSpan(windows[l], columns[l + 1], widths[l]);
+            }
+
+            readTile(rows[0].begin, columns[0].begin, rows[0].end - rows[0].begin, columns[0].end - columns[0].begin, current);
+            if (current.size() != static_cast<size_t>(depth) || current[0].size() != static_cast<size_t>(rows[0].end - rows[0].begin) ||
+                current[0][0].size() != static_cast<size_t>(columns[0].end - columns[0].begin)) {
+                throw std::runtime_error("The tile reader returned a region of the wrong shape.");
+            }
+
+            for (size_t l = 0; l < layerCount; ++l) {
+                auto output = layers[l]->infer(current, cache);
+                // Local output row o is global row o + rows[l].begin / stride
+                int top = rows[l].begin / windows[l].stride;
+                int left = columns[l].begin / windows[l].stride;
+                crop(output, {rows[l + 1].begin - top, rows[l + 1].end - top}, {columns[l + 1].begin - left, columns[l + 1].end - left}, current);
+            }
+            writeTile(y, x, current);
+        }
+    });
+}
+
+std::vector<std::vector<std::vector<double>>> CNN::forwardTiled(const std::vector<std::vector<std::vector<double>>>& input, size_t tileBytes) const {
+    if (input.empty() || input[0].empty() || static_cast<int>(input.size()) != getInputShape()[0]) {
+        throw std::invalid_argument("Input depth does not match the network.");
+    }
+    int height = input[0].size();
+    int width = input[0][0].size();
+    auto outputShape = getTiledOutputShape(height, width);
+    std::vector<std::vector<std::vector<double>>> output(outputShape[0], std::vector<std::vector<double>>(outputShape[1], std::vector<double>(outputShape[2])));
+
+    forwardTiled(height, width,
+        [&](int y, int x, int tileHeight, int tileWidth, std::vector<std::vector<std::vector<double>>>& tile) {
+            crop(input, {y, y + tileHeight}, {x, x + tileWidth}, tile);
+        },
+        [&](int y, int x, const std::vector<std::vector<std::vector<double>>>& tile) {
+            // Tiles are disjoint, so concurrent writers never touch the same element
+            for (size_t d = 0; d < tile.size(); ++d) {
+                for (size_t i = 0; i < tile[d].size(); ++i) {
+                    std::copy(tile[d][i].begin(), tile[d][i].end(), output[d][y + i].begin() + x);
+                }
+            }
+        },
+        tileBytes);
+    return output;
+}
+
+void CNN::updateParameters(int miniBatchSize) {
+    if (!parameterStore) {
+        return;
+    }
+    parameterStore->applyGradients(learningRate / miniBatchSize);
+    for (auto* paramLayer : parameterizedLayers) {
+        if (paramLayer) {
+            paramLayer->parametersChanged();
         }
     }
 }
 
 void CNN::resetGradients() {
+    if (parameterStore) {
+        parameterStore->zeroGradients();
+    }
+}
+
+void CNN::SGD(const std::vector<ImageData>& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData, const std::string& saveFilePath) {
+    InMemoryDataSource source(trainingData);
+    train(source, epochs, miniBatchSize, testData, saveFilePath);
+}
+
+void CNN::SGD(const std::vector<ImageData>& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData) {
+    InMemoryDataSource source(trainingData);
+    train(source, epochs, miniBatchSize, testData, "");
+}
+
+void CNN::SGD(DataSource& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData, const std::string& saveFilePath) {
+    train(trainingData, epochs, miniBatchSize, testData, saveFilePath);
+}
+
+void CNN::SGD(DataSource& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData) {
+    train(trainingData, epochs, miniBatchSize, testData, "");
+}
+
+void CNN::setOverlappedEvaluation(bool enabled) {
+    overlappedEvaluation = enabled;
+}
+
+void CNN::setMixedPrecision(bool enabled) {
     for (const auto& layer : layers) {
-        if (auto paramLayer = std::dynamic_pointer_cast<ParameterizedLayer>(layer)) {
-            paramLayer->resetGradients();
+        if (auto fullyConnected = std::dynamic_pointer_cast<FullyConnectedLayer>(layer)) {
+            fullyConnected->setMixedPrecision(enabled);
         }
     }
 }
 
-void CNN::SGD(const std::vector<ImageData>& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData, const std::string& saveFilePath) {
+void CNN::train(DataSource& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData, const std::string& saveFilePath) {
     int nTest = static_cast<int>(testData.size());
     double bestAccuracy = 0.0;
 
-    for (int epoch = 0; epoch < epochs; ++epoch) {
-        auto shuffledData = trainingData;
-        
-        // Use std::shuffle instead of std::random_shuffle
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(shuffledData.begin(), shuffledData.end(), g);
-        
-        auto miniBatches = createMiniBatches(shuffledData, miniBatchSize);
+    // Snapshots under evaluation on background threads, oldest epoch first
+    struct PendingEvaluation {
+        int epoch;
+        std::shared_ptr<CNN> snapshot;
+        std::future<int> correct;
+    };
+    std::deque<PendingEvaluation> pending;
+    const size_t maxPendingEvaluations = 2;
 
-        for (const auto& miniBatch : miniBatches) {
+    auto report = [&](int epoch, int correct, const CNN& model) {
+        double accuracy = static_cast<double>(correct) / nTest;
+        std::cout << "Epoch " << epoch << ": " << correct << " / " << nTest << " (" << accuracy * 100 << "%)\n";
+
+        if (!saveFilePath.empty() && accuracy > bestAccuracy) {
+            bestAccuracy = accuracy;
+            model.saveNetwork(saveFilePath);
+            std::cout << "New best model saved with accuracy: " << bestAccuracy * 100 << "%\n";
+        }
+    };
+    auto reportFront = [&]() {
+        report(pending.front().epoch, pending.front().correct.get(), *pending.front().snapshot);
+        pending.pop_front();
+    };
+
+    for (int epoch = 0; epoch < epochs; ++epoch) {
+        trainingData.startEpoch();
+        std::vector<ImageData> miniBatch;
+        while (trainingData.nextBatch(miniBatch, miniBatchSize)) {
             updateMiniBatch(miniBatch, miniBatchSize);
         }
 
+        if (nTest == 0) {
+            continue;
+        }
+        if (!overlappedEvaluation) {
+            report(epoch + 1, evaluate(testData), *this);
+            continue;
+        }
+
+        // Evaluate a snapshot of this epoch's parameters while the next epoch trains
+        auto snapshot = std::make_shared<CNN>(clone());
+        auto correct = std::async(std::launch::async, [snapshot, &testData] { return snapshot->evaluate(testData); });
+        pending.push_back(PendingEvaluation{ epoch + 1, snapshot, std::move(correct) });
+
+        // Report finished evaluations in epoch order, and bound the snapshots kept alive
+        while (!pending.empty() && (pending.size() > maxPendingEvaluations ||
+                                    pending.front().correct.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+            reportFront();
+        }
+    }
+
+    while (!pending.empty()) {
+        reportFront();
+    }
+}
+
+std::vector<double> CNN::measureLayerSeconds() {
+    const int runs = 3;
+    std::vector<double> seconds;
+    LayerCache cache;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        // Flat shapes are carried as a single row, like the loss gradient
+        const auto& shape = layerShapes[2 * l];
+        std::vector<std::vector<std::vector<double>>> input = shape.size() == 3
+            ? std::vector<std::vector<std::vector<double>>>(shape[0], std::vector<std::vector<double>>(shape[1], std::vector<double>(shape[2], 0.5)))
+            : std::vector<std::vector<std::vector<double>>>(1, std::vector<std::vector<double>>(1, std::vector<double>(shape[0], 0.5)));
+
+        double best = 0.0;
+        for (int run = 0; run <= runs; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            auto output = layers[l]->forward(input, cache);
+            // A zero gradient leaves the accumulated gradients as they are
+            for (auto& channel : output) {
+                for (auto& row : channel) {
+                    std::fill(row.begin(), row.end(), 0.0);
+                }
+            }
+            layers[l]->backward(std::move(output), cache);
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            // Run 0 only warms up
+            if (run > 0) {
+                best = run == 1 ? elapsed : std::min(best, elapsed);
+            }
+        }
+        seconds.push_back(best);
+    }
+    return seconds;
+}
+
+void CNN::setPipelineStages(int numStages, int microBatchSize, bool pinThreads) {
+    pipeline.reset();
+    if (numStages <= 1) {
+        return;
+    }
+    size_t stageCount = std::min(static_cast<size_t>(numStages), layers.size());
+    std::vector<double> seconds = measureLayerSeconds();
+    std::vector<double> prefix(layers.size() + 1, 0.0);
+    for (size_t l = 0; l < layers.size(); ++l) {
+        prefix[l + 1] = prefix[l] + seconds[l];
+    }
+
+    // cost[s][n]: the smallest possible slowest stage when the first n layers form s stages
+    const double infinity = std::numeric_limits<double>::max();
+    std::vector<std::vector<double>> cost(stageCount + 1, std::vector<double>(layers.size() + 1, infinity));
+    std::vector<std::vector<size_t>> split(stageCount + 1, std::vector<size_t>(layers.size() + 1, 0));
+    cost[0][0] = 0.0;
+    for (size_t s = 1; s <= stageCount; ++s) {
+        for (size_t n = s; n <= layers.size(); ++n) {
+            for (size_t first = s - 1; first < n; ++first) {
+                double slowest = std::max(cost[s - 1][first], prefix[n] - prefix[first]);
+                if (slowest < cost[s][n]) {
+                    cost[s][n] = slowest;
+                    split[s][n] = first;
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> stageEnds(stageCount);
+    for (size_t s = stageCount, n = layers.size(); s > 0; n = split[s][n], --s) {
+        stageEnds[s - 1] = n;
+    }
+    setPipelineStages(stageEnds, microBatchSize, pinThreads);
+}
+
+void CNN::setPipelineStages(const std::vector<size_t>& stageEnds, int microBatchSize, bool pinThreads) {
+    if (microBatchSize < 1) {
+        throw std::invalid_argument("Micro-batch size must be positive.");
+    }
+    pipeline.reset();
+    if (stageEnds.size() <= 1) {
+        return;
+    }
+    pipeline = std::make_shared<LayerPipeline>(layers, stageEnds, pinThreads);
+    pipelineMicroBatchSize = microBatchSize;
+}
+
+const LayerPipeline* CNN::getPipeline() const {
+    return pipeline.get();
+}
+
+std::vector<std::vector<std::vector<std::vector<double>>>> CNN::forwardPipelined(const std::vector<std::vector<std::vector<std::vector<double>>>>& inputs) {
+    if (pipeline) {
+        return pipeline->forward(inputs, pipelineMicroBatchSize);
+    }
+    std::vector<std::vector<std::vector<std::vector<double>>>> outputs;
+    outputs.reserve(inputs.size());
+    for (const auto& input : inputs) {
+        outputs.push_back(forward(input));
+    }
+    return outputs;
+}
+
+void CNN::SGDHogwild(const std::vector<ImageData>& trainingData, int epochs, int numThreads, const std::vector<ImageData>& testData) {
+    if (numThreads < 1) {
+        throw std::invalid_argument("Hogwild training needs at least one thread.");
+    }
+    int nTest = static_cast<int>(testData.size());
+
+    std::vector<size_t> order(trainingData.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::random_device rd;
+    std::mt19937 g(rd());
+
+    for (int epoch = 0; epoch < epochs; ++epoch) {
+        std::shuffle(order.begin(), order.end(), g);
+
+        // The workers update the parameters in place; derived copies are rebuilt once afterwards
+        for (auto* layer : parameterizedLayers) {
+            if (layer) {
+                layer->parametersChanging();
+            }
+        }
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < numThreads; ++t) {
+            workers.emplace_back(&CNN::hogwildWorker, this, std::cref(trainingData), std::cref(order), std::ref(next));
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (auto* layer : parameterizedLayers) {
+            if (layer) {
+                layer->parametersChanged();
+            }
+        }
+
         if (nTest > 0) {
             int correct = evaluate(testData);
             double accuracy = static_cast<double>(correct) / nTest;
             std::cout << "Epoch " << (epoch + 1) << ": " << correct << " / " << nTest << " (" << accuracy * 100 << "%)\n";
-
-            if (accuracy > bestAccuracy) {
-                bestAccuracy = accuracy;
-                saveNetwork(saveFilePath);
-                std::cout << "New best model saved with accuracy: " << bestAccuracy * 100 << "%\n";
-            }
         }
     }
 }
 
-void CNN::SGD(const std::vector<ImageData>& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData) {
-    int nTest = static_cast<int>(testData.size());
+void CNN::SGD(const std::vector<ImageData>& trainingData, int epochs, int miniBatchSize, const std::vector<ImageData>& testData, GradientSynchronizer& synchronizer) {
+    int rank = synchronizer.getRank();
+    int worldSize = synchronizer.getWorldSize();
+    if (trainingData.size() < static_cast<size_t>(worldSize)) {
+        throw std::invalid_argument("Data-parallel training needs at least one training sample per rank.");
+    }
+    if (pipeline) {
+        throw std::invalid_argument("Data-parallel training does not support pipeline stages.");
+    }
+    int nTest = rank == 0 ? static_cast<int>(testData.size()) : 0;
+
+    // synchronizedIndex maps a layer to its position in the synchronizer, or -1
+    std::vector<ParameterizedLayer*> synchronizedLayers;
+    std::vector<int> synchronizedIndex;
+    for (auto* paramLayer : parameterizedLayers) {
+        synchronizedIndex.push_back(paramLayer ? static_cast<int>(synchronizedLayers.size()) : -1);
+        if (paramLayer) {
+            synchronizedLayers.push_back(paramLayer);
+        }
+    }
+    synchronizer.setLayers(synchronizedLayers);
+    synchronizer.broadcastParameters();
+
+    // Equal-sized strided shards keep every rank at the same number of mini-batches, so each epoch
+    // leaves out trainingData.size() % worldSize samples. The shards start further along every
+    // epoch, which moves the left-out window over the whole data set.
+    size_t shardSize = trainingData.size() / worldSize;
+    size_t remainder = trainingData.size() % worldSize;
+    std::vector<ImageData> shard;
+    shard.reserve(shardSize);
+
+    std::random_device rd;
+    std::mt19937 g(rd());
 
     for (int epoch = 0; epoch < epochs; ++epoch) {
-        auto shuffledData = trainingData;
-        
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(shuffledData.begin(), shuffledData.end(), g);
-        
-        auto miniBatches = createMiniBatches(shuffledData, miniBatchSize);
+        size_t start = epoch * remainder % trainingData.size();
+        shard.clear();
+        for (size_t i = 0; i < shardSize; ++i) {
+            shard.push_back(trainingData[(start + i * worldSize + rank) % trainingData.size()]);
+        }
+        std::shuffle(shard.begin(), shard.end(), g);
+        auto miniBatches = createMiniBatches(shard, miniBatchSize);
 
         for (const auto& miniBatch : miniBatches) {
-            updateMiniBatch(miniBatch, miniBatchSize);
+            updateMiniBatch(miniBatch, miniBatchSize, synchronizer, synchronizedIndex);
         }
 
         if (nTest > 0) {
@@ -104,6 +599,28 @@ void CNN::SGD(const std::vector<ImageData>& trainingData, int epochs, int miniBa
     }
 }
 
+void CNN::hogwildWorker(const std::vector<ImageData>& trainingData, const std::vector<size_t>& order, std::atomic<size_t>& next) {
+    std::vector<LayerCache> caches(layers.size());
+
+    for (size_t k = next.fetch_add(1, std::memory_order_relaxed); k < order.size(); k = next.fetch_add(1, std::memory_order_relaxed)) {
+        const ImageData& data = trainingData[order[k]];
+
+        auto output = data.getImageData();
+        for (size_t l = 0; l < layers.size(); ++l) {
+            output = layers[l]->forward(output, caches[l]);
+        }
+
+        auto grad = computeLossGradient(output[0][0], data.getLabel());
+        for (size_t l = layers.size(); l-- > 0;) {
+            if (parameterizedLayers[l]) {
+                grad = parameterizedLayers[l]->backwardAndUpdate(std::move(grad), caches[l], learningRate);
+            } else {
+                grad = layers[l]->backward(std::move(grad), caches[l]);
+            }
+        }
+    }
+}
+
 std::vector<std::vector<ImageData>> CNN::createMiniBatches(const std::vector<ImageData>& trainingData, int miniBatchSize) {
     std::vector<std::vector<ImageData>> miniBatches;
     for (size_t i = 0; i < trainingData.size(); i += miniBatchSize) {
@@ -113,6 +630,17 @@ std::vector<std::vector<ImageData>> CNN::createMiniBatches(const std::vector<Ima
 }
 
 void CNN::updateMiniBatch(const std::vector<ImageData>& miniBatch, int miniBatchSize) {
+    if (pipeline) {
+        updateMiniBatchPipelined(miniBatch, miniBatchSize);
+        return;
+    }
+    for (const auto& layer : layers) {
+        if (dynamic_cast<BatchLayer*>(layer.get())) {
+            updateMiniBatchLayerwise(miniBatch, miniBatchSize);
+            return;
+        }
+    }
+
     resetGradients();
     for (const auto& data : miniBatch) {
         auto output = forward(data.getImageData());
@@ -122,6 +650,98 @@ void CNN::updateMiniBatch(const std::vector<ImageData>& miniBatch, int miniBatch
     updateParameters(miniBatchSize);
 }
 
+void CNN::updateMiniBatchLayerwise(const std::vector<ImageData>& miniBatch, int miniBatchSize) {
+    resetGradients();
+    accumulateLayerwise(miniBatch, [](size_t) {});
+    updateParameters(miniBatchSize);
+}
+
+void CNN::accumulateLayerwise(const std::vector<ImageData>& miniBatch, const std::function<void(size_t)>& layerDone) {
+    // A BatchLayer needs every sample's input before it can produce any output, so the whole
+    // mini-batch moves through the network one layer at a time, with a cache per layer and sample.
+    std::vector<std::vector<LayerCache>> caches(layers.size(), std::vector<LayerCache>(miniBatch.size()));
+    std::vector<std::vector<std::vector<std::vector<double>>>> batch;
+    batch.reserve(miniBatch.size());
+    for (const auto& data : miniBatch) {
+        batch.push_back(data.getImageData());
+    }
+
+    for (size_t l = 0; l < layers.size(); ++l) {
+        if (auto* batchLayer = dynamic_cast<BatchLayer*>(layers[l].get())) {
+            batchLayer->forwardMiniBatch(batch, caches[l]);
+            continue;
+        }
+        for (size_t k = 0; k < batch.size(); ++k) {
+            batch[k] = layers[l]->forward(batch[k], caches[l][k]);
+        }
+    }
+
+    for (size_t k = 0; k < batch.size(); ++k) {
+        batch[k] = computeLossGradient(batch[k][0][0], miniBatch[k].getLabel());
+    }
+    for (size_t l = layers.size(); l-- > 0;) {
+        if (auto* batchLayer = dynamic_cast<BatchLayer*>(layers[l].get())) {
+            batchLayer->backwardMiniBatch(batch, caches[l]);
+        } else {
+            for (size_t k = 0; k < batch.size(); ++k) {
+                batch[k] = layers[l]->backward(std::move(batch[k]), caches[l][k]);
+            }
+        }
+        layerDone(l);
+    }
+}
+
+void CNN::updateMiniBatchPipelined(const std::vector<ImageData>& miniBatch, int miniBatchSize) {
+    std::vector<std::vector<std::vector<std::vector<double>>>> inputs;
+    inputs.reserve(miniBatch.size());
+    for (const auto& data : miniBatch) {
+        inputs.push_back(data.getImageData());
+    }
+
+    resetGradients();
+    pipeline->train(std::move(inputs), pipelineMicroBatchSize, [&](size_t k, const std::vector<std::vector<std::vector<double>>>& output) {
+        return computeLossGradient(output[0][0], miniBatch[k].getLabel());
+    });
+    updateParameters(miniBatchSize);
+}
+
+void CNN::updateMiniBatch(const std::vector<ImageData>& miniBatch, int miniBatchSize, GradientSynchronizer& synchronizer, const std::vector<int>& synchronizedIndex) {
+    resetGradients();
+    bool hasBatchLayer = std::any_of(layers.begin(), layers.end(), [](const std::shared_ptr<Layer>& layer) {
+        return dynamic_cast<BatchLayer*>(layer.get()) != nullptr;
+    });
+    if (hasBatchLayer) {
+        accumulateLayerwise(miniBatch, [&](size_t l) {
+            if (synchronizedIndex[l] >= 0) {
+                synchronizer.markReady(synchronizedIndex[l]);
+            }
+        });
+        synchronizer.synchronize();
+        updateParameters(miniBatchSize);
+        return;
+    }
+
+    for (size_t k = 0; k + 1 < miniBatch.size(); ++k) {
+        auto output = forward(miniBatch[k].getImageData());
+        backward(computeLossGradient(output[0][0], miniBatch[k].getLabel()));
+    }
+
+    // A layer's gradients are final once the last sample has been backpropagated through it,
+    // so its bucket can be reduced while backward continues through the earlier layers
+    const ImageData& last = miniBatch.back();
+    auto output = forward(last.getImageData());
+    auto grad = computeLossGradient(output[0][0], last.getLabel());
+    for (size_t l = layers.size(); l-- > 0;) {
+        grad = layers[l]->backward(std::move(grad));
+        if (synchronizedIndex[l] >= 0) {
+            synchronizer.markReady(synchronizedIndex[l]);
+        }
+    }
+
+    synchronizer.synchronize();
+    updateParameters(miniBatchSize);
+}
+
 std::vector<std::vector<std::vector<double>>> CNN::computeLossGradient(const std::vector<double>& output, const std::vector<double>& target) {
     std::vector<std::vector<std::vector<double>>> gradient(1, std::vector<std::vector<double>>(1, std::vector<double>(output.size())));
     for (size_t i = 0; i < output.size(); ++i) {
@@ -130,13 +750,12 @@ std::vector<std::vector<std::vector<double>>> CNN::computeLossGradient(const std
     return gradient;
 }
 
-int CNN::evaluate(const std::vector<ImageData>& testData) {
+int CNN::evaluate(const std::vector<ImageData>& testData) const {
     int correct = 0;
+    InferenceWorkspace workspace;
     for (const auto& data : testData) {
-        auto output = forward(data.getImageData());
-        int predictedLabel = argMax(output[0][0]);
-        int actualLabel = argMax(data.getLabel());
-        if (predictedLabel == actualLabel) {
+        auto output = predict(data.getImageData(), workspace);
+        if (argMax(output[0][0]) == data.getLabelIndex()) {
             ++correct;
         }
     }
@@ -161,24 +780,158 @@ void CNN::printNetworkSummary() const {
     }
 }
 
+namespace {
+
+const char* const fileMagic = "CNNcpp";
+const int32_t fileVersion = 3;
+
+std::shared_ptr<Layer> loadLayer(std::istream& stream) {
+    std::string type = Serialization::readString(stream);
+    if (type == "BatchNormLayer") return BatchNormLayer::load(stream);
+    if (type == "ConvolutionalLayer") return ConvolutionalLayer::load(stream);
+    if (type == "DepthwiseConvolutionalLayer") return DepthwiseConvolutionalLayer::load(stream);
+    if (type == "FullyConnectedLayer") return FullyConnectedLayer::load(stream);
+    if (type == "FlattenLayer") return FlattenLayer::load(stream);
+    if (type == "MaxPoolingLayer") return MaxPoolingLayer::load(stream);
+    if (type == "SoftmaxLayer") return SoftmaxLayer::load(stream);
+    throw std::runtime_error("Unknown layer type in network file: " + type);
+}
+
+} // namespace
+
 void CNN::saveNetwork(const std::string& filePath) const {
     std::ofstream file(filePath, std::ios::binary);
-    if (file.is_open()) {
-        // Serialize the CNN object here (you would need to implement the actual serialization)
-        file.close();
-    } else {
+    if (!file.is_open()) {
         std::cerr << "Failed to open file for saving the network.\n";
+        return;
+    }
+
+    Serialization::writeString(file, fileMagic);
+    Serialization::writeInt(file, fileVersion);
+    Serialization::writeDouble(file, learningRate);
+
+    const auto& networkInputShape = getInputShape();
+    Serialization::writeInt(file, static_cast<int32_t>(networkInputShape.size()));
+    for (int dim : networkInputShape) {
+        Serialization::writeInt(file, dim);
+    }
+
+    Serialization::writeInt(file, static_cast<int32_t>(layers.size()));
+    for (const auto& layer : layers) {
+        layer->save(file);
+        if (auto paramLayer = std::dynamic_pointer_cast<ParameterizedLayer>(layer)) {
+            std::vector<double> parameters(paramLayer->getParameterCount());
+            paramLayer->readParameters(parameters.data());
+            Serialization::writeInt(file, static_cast<int32_t>(parameters.size()));
+            Serialization::writeDoubles(file, parameters.data(), parameters.size());
+        }
+    }
+
+    if (!file) {
+        std::cerr << "Failed to write the network to " << filePath << "\n";
     }
 }
 
 CNN CNN::loadNetwork(const std::string& filePath) {
     CNN loadedCNN(0.0, {});
     std::ifstream file(filePath, std::ios::binary);
-    if (file.is_open()) {
-        // Deserialize the CNN object here (you would need to implement the actual deserialization)
-        file.close();
-    } else {
+    if (!file.is_open()) {
         std::cerr << "Failed to open file for loading the network.\n";
+        return loadedCNN;
+    }
+
+    if (Serialization::readString(file) != fileMagic || Serialization::readInt(file) != fileVersion) {
+        throw std::runtime_error("Not a supported network file: " + filePath);
+    }
+    loadedCNN.learningRate = Serialization::readDouble(file);
+
+    int32_t dims = Serialization::readInt(file);
+    loadedCNN.inputShape.clear();
+    for (int32_t i = 0; i < dims; ++i) {
+        loadedCNN.inputShape.push_back(Serialization::readInt(file));
+    }
+
+    int32_t layerCount = Serialization::readInt(file);
+    for (int32_t i = 0; i < layerCount; ++i) {
+        auto layer = loadLayer(file);
+        loadedCNN.addLayer(layer);
+        if (auto paramLayer = std::dynamic_pointer_cast<ParameterizedLayer>(layer)) {
+            std::vector<double> parameters(paramLayer->getParameterCount());
+            if (Serialization::readInt(file) != static_cast<int32_t>(parameters.size())) {
+                throw std::runtime_error("Parameter count mismatch in network file: " + filePath);
+            }
+            Serialization::readDoubles(file, parameters.data(), parameters.size());
+            paramLayer->writeParameters(parameters.data());
+        }
     }
     return loadedCNN;
 }
+
+size_t CNN::foldBatchNormalization() {
+    size_t folded = 0;
+    for (size_t i = 1; i < layers.size(); ++i) {
+        auto batchNorm = std::dynamic_pointer_cast<BatchNormLayer>(layers[i]);
+        if (!batchNorm) {
+            continue;
+        }
+        std::vector<double> scale;
+        std::vector<double> shift;
+        batchNorm->getInferenceAffine(scale, shift);
+
+        if (auto convolutional = std::dynamic_pointer_cast<ConvolutionalLayer>(layers[i - 1])) {
+            if (!std::dynamic_pointer_cast<Identity>(convolutional->getActivationFunction())) {
+                continue;
+            }
+            convolutional->foldAffine(scale, shift, batchNorm->getActivationFunction());
+        } else if (auto fullyConnected = std::dynamic_pointer_cast<FullyConnectedLayer>(layers[i - 1])) {
+            if (!std::dynamic_pointer_cast<Identity>(fullyConnected->getActivationFunction())) {
+                continue;
+            }
+            fullyConnected->foldAffine(scale, shift, batchNorm->getActivationFunction());
+        } else {
+            continue;
+        }
+
+        // The normalization keeps its input's shape, so only its own shape entries go
+        layers.erase(layers.begin() + i);
+        layerShapes.erase(layerShapes.begin() + 2 * i, layerShapes.begin() + 2 * i + 2);
+        --i;
+        ++folded;
+    }
+    if (folded > 0) {
+        rebuildParameterStore();
+        pipeline.reset();
+    }
+    return folded;
+}
+
+CNN CNN::clone() const {
+    CNN copy(*this);
+    for (auto& layer : copy.layers) {
+        layer = layer->clone();
+    }
+    copy.rebuildParameterStore();
+    // The pipeline's threads run this network's layers, not the copy's
+    copy.pipeline.reset();
+    return copy;
+}
+
+const std::vector<int>& CNN::getInputShape() const {
+    return layerShapes.empty() ? inputShape : layerShapes.front();
+}
+
+size_t CNN::getLayerCount() const {
+    return layers.size();
+}
+
+std::shared_ptr<Layer> CNN::getLayer(size_t index) const {
+    return layers.at(index);
+}
+
+const std::vector<int>& CNN::getLayerInputShape(size_t index) const {
+    return layerShapes.at(2 * index);
+}
+
+const std::vector<int>& CNN::getLayerOutputShape(size_t index) const {
+    return layerShapes.at(2 * index + 1);
+}
@@ -0,0 +1,214 @@
+#include "cnn/HyperparameterSweep.h"
+#include "data/InMemoryDataSource.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// What a trial needs while it is still training; released as soon as it finishes or is stopped.
+struct Trial {
+    std::unique_ptr<CNN> network;
+    std::unique_ptr<InMemoryDataSource> source;
+};
+
+std::string describe(const HyperparameterConfig& config) {
+    std::ostringstream stream;
+    stream << "learning rate " << config.learningRate << ", mini-batch " << config.miniBatchSize << ", widths [";
+    for (size_t i = 0; i < config.layerWidths.size(); ++i) {
+        stream << (i > 0 ? " " : "") << config.layerWidths[i];
+    }
+    stream << "]";
+    return stream.str();
+}
+
+double median(std::vector<double> values) {
+    size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    if (values.size() % 2 == 1) {
+        return values[middle];
+    }
+    return 0.5 * (values[middle] + *std::max_element(values.begin(), values.begin() + middle));
+}
+
+// What the other trials reached after the latest epoch, up to the given one, that at least
+// minPeers of them have finished. Trials that started first report each epoch before the rest,
+// so an earlier epoch stands in for them; that only makes the bar lower, i.e. more lenient, for
+// the trial compared.
+std::vector<double> peerAccuracies(const std::vector<TrialResult>& trials, size_t self, int epoch, int minPeers) {
+    for (; epoch > 0; --epoch) {
+        std::vector<double> peers;
+        for (size_t t = 0; t < trials.size(); ++t) {
+            if (t != self && trials[t].accuracies.size() >= static_cast<size_t>(epoch)) {
+                peers.push_back(trials[t].accuracies[epoch - 1]);
+            }
+        }
+        if (peers.size() >= static_cast<size_t>(minPeers)) {
+            return peers;
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+double TrialResult::bestAccuracy() const {
+    return accuracies.empty() ? 0.0 : *std::max_element(accuracies.begin(), accuracies.end());
+}
+
+HyperparameterSweep::HyperparameterSweep(const std::vector<ImageData>& trainingData, const std::vector<ImageData>& validationData,
+                                         NetworkBuilder buildNetwork)
+    : trainingData(trainingData), validationData(validationData), buildNetwork(std::move(buildNetwork)) {}
+
+SweepResult HyperparameterSweep::run(const std::vector<HyperparameterConfig>& configs, const SweepOptions& options) {
+    if (configs.empty()) {
+        throw std::invalid_argument("A sweep needs at least one configuration.");
+    }
+    if (validationData.empty()) {
+        throw std::invalid_argument("A sweep needs validation data to compare its trials.");
+    }
+    if (options.epochs < 1) {
+        throw std::invalid_argument("A sweep needs at least one epoch.");
+    }
+    for (const auto& config : configs) {
+        if (config.miniBatchSize < 1) {
+            throw std::invalid_argument("Mini-batch size must be positive.");
+        }
+    }
+
+    SweepResult result;
+    result.trials.resize(configs.size());
+    std::vector<Trial> trials(configs.size());
+    for (size_t t = 0; t < configs.size(); ++t) {
+        result.trials[t].config = configs[t];
+        trials[t].network = std::make_unique<CNN>(buildNetwork(configs[t]));
+        trials[t].source = std::make_unique<InMemoryDataSource>(trainingData);
+    }
+
+    // Everything below is guarded by mutex, including the trials' results. Trials wait in ready
+    // between epochs.
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<size_t> ready;
+    for (size_t t = 0; t < configs.size(); ++t) {
+        ready.push_back(t);
+    }
+    size_t running = 0;
+    double bestAccuracy = -1.0;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [&] { return !ready.empty() || running == 0; });
+            if (ready.empty() || error) {
+                changed.notify_all();
+                return;
+            }
+            size_t t = ready.front();
+            ready.pop_front();
+            ++running;
+            // The best accuracy only grows, so an epoch that does not beat it now cannot become best
+            double bestBefore = bestAccuracy;
+            lock.unlock();
+
+            // Only this worker touches the trial until it is back in ready
+            Trial& trial = trials[t];
+            double accuracy = 0.0;
+            double seconds = 0.0;
+            std::shared_ptr<CNN> candidate;
+            std::exception_ptr trialError;
+            try {
+                auto start = std::chrono::steady_clock::now();
+                trial.network->SGD(*trial.source, 1, configs[t].miniBatchSize, {});
+                accuracy = static_cast<double>(trial.network->evaluate(validationData)) / validationData.size();
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                // Cloned before taking the lock, so other workers do not wait on the copy
+                if (accuracy > bestBefore) {
+                    candidate = std::make_shared<CNN>(trial.network->clone());
+                }
+            } catch (...) {
+                trialError = std::current_exception();
+            }
+
+            lock.lock();
+            --running;
+            if (trialError) {
+                // The first failure ends the sweep; running trials finish their epoch first
+                if (!error) {
+                    error = trialError;
+                }
+                ready.clear();
+                changed.notify_all();
+                continue;
+            }
+
+            TrialResult& trialResult = result.trials[t];
+            trialResult.seconds += seconds;
+            trialResult.accuracies.push_back(accuracy);
+            int epoch = static_cast<int>(trialResult.accuracies.size());
+            bool hopeless = false;
+            if (epoch > options.gracePeriod && epoch < options.epochs && options.minPeers > 0) {
+                std::vector<double> peers = peerAccuracies(result.trials, t, epoch, options.minPeers);
+                hopeless = !peers.empty() && trialResult.bestAccuracy() < median(peers);
+            }
+
+            if (candidate && accuracy > bestAccuracy) {
+                bestAccuracy = accuracy;
+                result.bestTrial = t;
+                result.bestModel = std::move(candidate);
+            }
+
+            std::cout << "Trial " << t + 1 << " (" << describe(configs[t]) << ") epoch " << epoch << ": " << accuracy * 100 << "%"
+                      << (hopeless ? ", stopped early" : "") << "\n";
+            if (hopeless || epoch == options.epochs) {
+                trialResult.stoppedEarly = hopeless;
+                trial.network.reset();
+                trial.source.reset();
+            } else {
+                ready.push_back(t);
+            }
+            changed.notify_all();
+        }
+    };
+
+    int numWorkers = options.numWorkers > 0 ? options.numWorkers : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    numWorkers = std::min(numWorkers, static_cast<int>(configs.size()));
+    std::vector<std::thread> workers;
+    for (int w = 0; w < numWorkers; ++w) {
+        workers.emplace_back(worker);
+    }
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    const TrialResult& best = result.trials[result.bestTrial];
+    std::cout << "Best trial: " << result.bestTrial + 1 << " (" << describe(best.config) << ") with " << best.bestAccuracy() * 100 << "%\n";
+    if (!options.saveFilePath.empty()) {
+        result.bestModel->saveNetwork(options.saveFilePath);
+    }
+    return result;
+}
+
+std::vector<HyperparameterConfig> HyperparameterSweep::grid(const std::vector<double>& learningRates, const std::vector<int>& miniBatchSizes,
+                                                            const std::vector<std::vector<int>>& layerWidths) {
+    std::vector<HyperparameterConfig> configs;
+    for (double learningRate : learningRates) {
+        for (int miniBatchSize : miniBatchSizes) {
+            for (const auto& widths : layerWidths) {
+                configs.push_back(HyperparameterConfig{learningRate, miniBatchSize, widths});
+            }
+        }
+    }
+    return configs;
+}
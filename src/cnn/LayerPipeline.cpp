@@ -0,0 +1,316 @@
+#include "cnn/LayerPipeline.h"
+#include "interfaces/BatchLayer.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Room for a few micro-batches between neighbouring stages
+const size_t queueCapacity = 4;
+
+} // namespace
+
+double LayerPipeline::Stats::bubbleFraction() const {
+    if (stageBusySeconds.empty() || seconds <= 0.0) {
+        return 0.0;
+    }
+    double busy = 0.0;
+    for (double stageSeconds : stageBusySeconds) {
+        busy += stageSeconds;
+    }
+    return std::max(0.0, 1.0 - busy / (stageBusySeconds.size() * seconds));
+}
+
+LayerPipeline::LayerPipeline(std::vector<std::shared_ptr<Layer>> layers, const std::vector<size_t>& stageEnds, bool pinThreads)
+    : layers(std::move(layers)), forwardOutput(queueCapacity), backwardOutput(queueCapacity) {
+    if (stageEnds.empty() || stageEnds.back() != this->layers.size()) {
+        throw std::invalid_argument("The last stage must end at the last layer.");
+    }
+    size_t first = 0;
+    for (size_t end : stageEnds) {
+        if (end <= first) {
+            throw std::invalid_argument("Every pipeline stage needs at least one layer.");
+        }
+        auto stage = std::make_unique<Stage>();
+        stage->firstLayer = first;
+        stage->endLayer = end;
+        stage->forwardInput = std::make_unique<SpscQueue<MicroBatch>>(queueCapacity);
+        stage->backwardInput = std::make_unique<SpscQueue<MicroBatch>>(queueCapacity);
+        stage->inferenceCaches.resize(end - first);
+        stages.push_back(std::move(stage));
+        first = end;
+    }
+    for (size_t s = 0; s < stages.size(); ++s) {
+        stages[s]->thread = std::thread(&LayerPipeline::stageLoop, this, s, pinThreads);
+    }
+}
+
+LayerPipeline::~LayerPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        stopping = true;
+    }
+    runChanged.notify_all();
+    for (auto& stage : stages) {
+        stage->thread.join();
+    }
+}
+
+size_t LayerPipeline::getStageCount() const {
+    return stages.size();
+}
+
+const LayerPipeline::Stats& LayerPipeline::getLastStats() const {
+    return lastStats;
+}
+
+void LayerPipeline::stageLoop(size_t s, bool pinThread) {
+#ifdef __linux__
+    if (pinThread) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(s % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+#else
+    (void)pinThread;
+#endif
+
+    Stage& stage = *stages[s];
+    SpscQueue<MicroBatch>::Backoff backoff;
+    while (true) {
+        MicroBatch batch;
+        if (stage.forwardInput->tryPop(batch)) {
+            auto start = std::chrono::steady_clock::now();
+            runStage(stage, batch, &LayerPipeline::runForward);
+            // Recorded before the push, which publishes it to the caller along with the result
+            stage.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (s + 1 < stages.size()) {
+                stages[s + 1]->forwardInput->push(std::move(batch));
+            } else {
+                forwardOutput.push(std::move(batch));
+            }
+        } else if (stage.backwardInput->tryPop(batch)) {
+            auto start = std::chrono::steady_clock::now();
+            runStage(stage, batch, &LayerPipeline::runBackward);
+            stage.busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (s > 0) {
+                stages[s - 1]->backwardInput->push(std::move(batch));
+            } else {
+                // Nobody needs the gradient of the network's input
+                batch.tensors.clear();
+                backwardOutput.push(std::move(batch));
+            }
+        } else {
+            // Poll while a run is in progress, otherwise sleep until the next one
+            if (running.load(std::memory_order_acquire)) {
+                backoff.wait();
+            } else if (!waitForRun()) {
+                return;
+            }
+            continue;
+        }
+        backoff = SpscQueue<MicroBatch>::Backoff();
+    }
+}
+
+bool LayerPipeline::waitForRun() {
+    std::unique_lock<std::mutex> lock(runMutex);
+    runChanged.wait(lock, [this] { return running.load() || stopping.load(); });
+    return !stopping.load();
+}
+
+void LayerPipeline::runStage(Stage& stage, MicroBatch& batch, void (LayerPipeline::*direction)(Stage&, MicroBatch&)) {
+    if (batch.failed) {
+        return;
+    }
+    try {
+        (this->*direction)(stage, batch);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(runMutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+        batch.failed = true;
+        batch.tensors.clear();
+    }
+}
+
+void LayerPipeline::runForward(Stage& stage, MicroBatch& batch) {
+    auto& samples = batch.tensors;
+    if (batch.kind == Kind::Inference) {
+        for (size_t l = stage.firstLayer; l < stage.endLayer; ++l) {
+            for (auto& sample : samples) {
+                sample = layers[l]->infer(sample, stage.inferenceCaches[l - stage.firstLayer]);
+            }
+        }
+        return;
+    }
+
+    if (stage.trainingCaches.size() <= batch.index) {
+        stage.trainingCaches.resize(batch.index + 1);
+    }
+    auto& caches = stage.trainingCaches[batch.index];
+    caches.assign(stage.endLayer - stage.firstLayer, std::vector<LayerCache>(samples.size()));
+    for (size_t l = stage.firstLayer; l < stage.endLayer; ++l) {
+        auto& layerCaches = caches[l - stage.firstLayer];
+        if (auto* batchLayer = dynamic_cast<BatchLayer*>(layers[l].get())) {
+            batchLayer->forwardMiniBatch(samples, layerCaches);
+            continue;
+        }
+        for (size_t k = 0; k < samples.size(); ++k) {
+            samples[k] = layers[l]->forward(samples[k], layerCaches[k]);
+        }
+    }
+}
+
+void LayerPipeline::runBackward(Stage& stage, MicroBatch& batch) {
+    auto& gradients = batch.tensors;
+    auto& caches = stage.trainingCaches[batch.index];
+    for (size_t l = stage.endLayer; l-- > stage.firstLayer;) {
+        auto& layerCaches = caches[l - stage.firstLayer];
+        if (auto* batchLayer = dynamic_cast<BatchLayer*>(layers[l].get())) {
+            batchLayer->backwardMiniBatch(gradients, layerCaches);
+            continue;
+        }
+        for (size_t k = 0; k < gradients.size(); ++k) {
+            gradients[k] = layers[l]->backward(std::move(gradients[k]), layerCaches[k]);
+        }
+    }
+    // The activations of a micro-batch are only needed until its backward pass
+    caches.clear();
+}
+
+void LayerPipeline::stream(std::vector<MicroBatch>& batches, SpscQueue<MicroBatch>& input, SpscQueue<MicroBatch>& output,
+                           std::vector<MicroBatch>& results) {
+    // The queues are bounded, so results are drained while inputs are still being fed.
+    size_t sent = 0;
+    size_t received = 0;
+    SpscQueue<MicroBatch>::Backoff backoff;
+    while (received < batches.size()) {
+        bool progress = false;
+        if (sent < batches.size() && input.tryPush(batches[sent])) {
+            ++sent;
+            progress = true;
+        }
+        MicroBatch result;
+        if (output.tryPop(result)) {
+            size_t index = result.index;
+            results[index] = std::move(result);
+            ++received;
+            progress = true;
+        }
+        if (progress) {
+            backoff = SpscQueue<MicroBatch>::Backoff();
+        } else {
+            backoff.wait();
+        }
+    }
+}
+
+void LayerPipeline::startRun() {
+    // The stages are asleep between runs; waking them publishes these writes
+    for (auto& stage : stages) {
+        stage->busySeconds = 0.0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        running = true;
+    }
+    runChanged.notify_all();
+}
+
+void LayerPipeline::finishRun(double seconds) {
+    lastStats.seconds = seconds;
+    lastStats.stageBusySeconds.clear();
+    for (const auto& stage : stages) {
+        lastStats.stageBusySeconds.push_back(stage->busySeconds);
+    }
+
+    std::exception_ptr stageError;
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        running = false;
+        std::swap(stageError, error);
+    }
+    if (stageError) {
+        for (auto& stage : stages) {
+            stage->trainingCaches.clear();
+        }
+        std::rethrow_exception(stageError);
+    }
+}
+
+std::vector<LayerPipeline::Tensor> LayerPipeline::forward(const std::vector<Tensor>& inputs, size_t microBatchSize) {
+    if (microBatchSize == 0) {
+        throw std::invalid_argument("Micro-batch size must be positive.");
+    }
+    startRun();
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<MicroBatch> batches;
+    for (size_t first = 0; first < inputs.size(); first += microBatchSize) {
+        size_t end = std::min(inputs.size(), first + microBatchSize);
+        batches.push_back(MicroBatch{Kind::Inference, batches.size(), std::vector<Tensor>(inputs.begin() + first, inputs.begin() + end)});
+    }
+    std::vector<MicroBatch> results(batches.size());
+    stream(batches, *stages.front()->forwardInput, forwardOutput, results);
+
+    std::vector<Tensor> outputs;
+    outputs.reserve(inputs.size());
+    for (auto& result : results) {
+        for (auto& tensor : result.tensors) {
+            outputs.push_back(std::move(tensor));
+        }
+    }
+    finishRun(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return outputs;
+}
+
+void LayerPipeline::train(std::vector<Tensor> inputs, size_t microBatchSize, const LossGradient& lossGradient) {
+    if (microBatchSize == 0) {
+        throw std::invalid_argument("Micro-batch size must be positive.");
+    }
+    startRun();
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<MicroBatch> batches;
+    for (size_t first = 0; first < inputs.size(); first += microBatchSize) {
+        size_t end = std::min(inputs.size(), first + microBatchSize);
+        batches.push_back(MicroBatch{Kind::Training, batches.size(), std::vector<Tensor>(std::make_move_iterator(inputs.begin() + first),
+                                                                                          std::make_move_iterator(inputs.begin() + end))});
+    }
+
+    // GPipe: all forward passes first...
+    std::vector<MicroBatch> outputs(batches.size());
+    stream(batches, *stages.front()->forwardInput, forwardOutput, outputs);
+
+    // ...then the backward passes, last micro-batch first. Nothing goes backward after a failure,
+    // whose exception finishRun rethrows.
+    bool failed = std::any_of(outputs.begin(), outputs.end(), [](const MicroBatch& batch) { return batch.failed; });
+    std::vector<MicroBatch> gradients;
+    try {
+        for (size_t m = outputs.size(); m-- > 0 && !failed;) {
+            MicroBatch batch{Kind::Backward, m, {}};
+            for (size_t k = 0; k < outputs[m].tensors.size(); ++k) {
+                batch.tensors.push_back(lossGradient(m * microBatchSize + k, outputs[m].tensors[k]));
+            }
+            gradients.push_back(std::move(batch));
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(runMutex);
+        error = std::current_exception();
+        failed = true;
+    }
+    if (!failed) {
+        std::vector<MicroBatch> finished(gradients.size());
+        stream(gradients, *stages.back()->backwardInput, backwardOutput, finished);
+    }
+
+    finishRun(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
@@ -26,25 +26,19 @@ std::vector<ImageData> MNISTReader::readMNISTData(const std::string& imagesFile,
 
     std::vector<ImageData> dataset;
 
+    dataset.reserve(numberOfImages);
     for (int i = 0; i < numberOfImages; ++i) {
-        // Read and normalize image data
-        std::vector<std::vector<std::vector<double>>> imageData(1, std::vector<std::vector<double>>(rows, std::vector<double>(cols)));
-        for (int r = 0; r < rows; ++r) {
-            for (int c = 0; c < cols; ++c) {
-                uint8_t pixel = 0;
-                images.read(reinterpret_cast<char*>(&pixel), sizeof(pixel));
-                imageData[0][r][c] = pixel / 255.0;
-            }
-        }
+        // Pixels stay as bytes; ImageData scales them to [0, 1] when the sample is used
+        std::vector<uint8_t> pixels(static_cast<size_t>(rows) * cols);
+        images.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
 
-        // Read label
         uint8_t label = 0;
         labels.read(reinterpret_cast<char*>(&label), sizeof(label));
-        std::vector<double> arrayLabel(10, 0.0);
-        arrayLabel[label] = 1.0;
+        if (!images || !labels) {
+            throw std::runtime_error("MNIST files are shorter than their headers claim.");
+        }
 
-        // Store the image data and label in the dataset
-        dataset.emplace_back(imageData, arrayLabel);
+        dataset.emplace_back(1, rows, cols, std::move(pixels), 1.0 / 255.0, label, 10);
     }
 
     return dataset;
@@ -0,0 +1,130 @@
+#include "data/AugmentationPipeline.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Samples a worker takes from upstream at once, so the lock is not taken per sample.
+const size_t chunkSize = 16;
+
+} // namespace
+
+AugmentationPipeline::AugmentationPipeline(DataSource& upstream, const AugmentationConfig& config, int numWorkers, unsigned int seed, size_t capacity)
+    : upstream(upstream), capacity(capacity) {
+    if (numWorkers < 1) {
+        throw std::invalid_argument("Augmentation needs at least one worker.");
+    }
+    if (capacity < 1) {
+        throw std::invalid_argument("Augmentation needs room for at least one buffered sample.");
+    }
+    // The workers build their own Augmenters; this one only checks the configuration up front
+    Augmenter check(config);
+    for (int w = 0; w < numWorkers; ++w) {
+        workers.emplace_back(&AugmentationPipeline::worker, this, config, seed + w);
+    }
+}
+
+AugmentationPipeline::~AugmentationPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void AugmentationPipeline::startEpoch() {
+    std::unique_lock<std::mutex> lock(mutex);
+    // Drop whatever is left of an epoch the caller stopped reading early.
+    upstreamExhausted = true;
+    changed.wait(lock, [this] { return inFlight == 0; });
+    ready.clear();
+    error = nullptr;
+
+    upstream.startEpoch();
+    upstreamExhausted = false;
+    changed.notify_all();
+}
+
+bool AugmentationPipeline::nextBatch(std::vector<ImageData>& batch, size_t maxSamples) {
+    batch.clear();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (batch.size() < maxSamples) {
+        changed.wait(lock, [this] { return !ready.empty() || error || (upstreamExhausted && inFlight == 0); });
+        if (error) {
+            std::exception_ptr workerError;
+            std::swap(workerError, error);
+            std::rethrow_exception(workerError);
+        }
+        if (ready.empty()) {
+            break;
+        }
+        while (!ready.empty() && batch.size() < maxSamples) {
+            batch.push_back(std::move(ready.front()));
+            ready.pop_front();
+        }
+        changed.notify_all();
+    }
+    return !batch.empty();
+}
+
+void AugmentationPipeline::worker(const AugmentationConfig& config, unsigned int seed) {
+    Augmenter augmenter(config);
+    std::mt19937 gen(seed);
+    std::vector<ImageData> chunk;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this] { return stopping || (!upstreamExhausted && ready.size() + inFlight < capacity); });
+        if (stopping) {
+            return;
+        }
+
+        // The upstream source is not thread-safe, so it is only read under the lock.
+        bool more = false;
+        try {
+            more = upstream.nextBatch(chunk, std::min(chunkSize, capacity - ready.size() - inFlight));
+        } catch (...) {
+            fail(std::current_exception());
+            continue;
+        }
+        if (!more) {
+            upstreamExhausted = true;
+            changed.notify_all();
+            continue;
+        }
+        inFlight += chunk.size();
+        lock.unlock();
+
+        std::exception_ptr augmentError;
+        try {
+            for (auto& sample : chunk) {
+                sample = ImageData(augmenter.apply(sample.getImageData(), gen), sample.getLabel());
+            }
+        } catch (...) {
+            augmentError = std::current_exception();
+        }
+
+        lock.lock();
+        inFlight -= chunk.size();
+        if (augmentError) {
+            fail(augmentError);
+            continue;
+        }
+        for (auto& sample : chunk) {
+            ready.push_back(std::move(sample));
+        }
+        changed.notify_all();
+    }
+}
+
+void AugmentationPipeline::fail(std::exception_ptr workerError) {
+    // The rest of the epoch is dropped; the first error is the one reported
+    if (!error) {
+        error = workerError;
+    }
+    upstreamExhausted = true;
+    changed.notify_all();
+}
@@ -0,0 +1,126 @@
+#include "data/Augmenter.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+const double pi = std::acos(-1.0);
+
+} // namespace
+
+Augmenter::Augmenter(const AugmentationConfig& config) : config(config) {
+    if (config.elasticAlpha > 0.0 && !(config.elasticSigma > 0.0)) {
+        throw std::invalid_argument("Elastic distortion needs a positive elasticSigma.");
+    }
+    if (config.elasticAlpha > 0.0) {
+        int radius = static_cast<int>(std::ceil(3.0 * config.elasticSigma));
+        gaussianKernel.resize(2 * radius + 1);
+        double sum = 0.0;
+        for (int k = -radius; k <= radius; ++k) {
+            gaussianKernel[k + radius] = std::exp(-k * k / (2.0 * config.elasticSigma * config.elasticSigma));
+            sum += gaussianKernel[k + radius];
+        }
+        for (auto& weight : gaussianKernel) {
+            weight /= sum;
+        }
+    }
+}
+
+void Augmenter::randomDisplacement(std::vector<double>& field, int height, int width, std::mt19937& gen) {
+    std::uniform_real_distribution<> uniform(-1.0, 1.0);
+    field.resize(static_cast<size_t>(height) * width);
+    blurScratch.resize(field.size());
+    for (auto& value : field) {
+        value = uniform(gen);
+    }
+
+    // Separable Gaussian blur, rows into the scratch buffer then columns back into field.
+    int radius = static_cast<int>(gaussianKernel.size()) / 2;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double sum = 0.0;
+            for (int k = -radius; k <= radius; ++k) {
+                int source = x + k;
+                if (source >= 0 && source < width) {
+                    sum += gaussianKernel[k + radius] * field[y * width + source];
+                }
+            }
+            blurScratch[y * width + x] = sum;
+        }
+    }
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double sum = 0.0;
+            for (int k = -radius; k <= radius; ++k) {
+                int source = y + k;
+                if (source >= 0 && source < height) {
+                    sum += gaussianKernel[k + radius] * blurScratch[source * width + x];
+                }
+            }
+            field[y * width + x] = config.elasticAlpha * sum;
+        }
+    }
+}
+
+std::vector<std::vector<std::vector<double>>> Augmenter::apply(const std::vector<std::vector<std::vector<double>>>& image, std::mt19937& gen) {
+    int depth = image.size();
+    int height = image[0].size();
+    int width = image[0][0].size();
+
+    std::uniform_real_distribution<> shift(-config.maxShift, config.maxShift);
+    std::uniform_real_distribution<> rotation(-config.maxRotationDegrees, config.maxRotationDegrees);
+    double shiftX = config.maxShift > 0.0 ? shift(gen) : 0.0;
+    double shiftY = config.maxShift > 0.0 ? shift(gen) : 0.0;
+    double angle = config.maxRotationDegrees > 0.0 ? rotation(gen) * pi / 180.0 : 0.0;
+    bool elastic = config.elasticAlpha > 0.0;
+    if (elastic) {
+        randomDisplacement(displacementX, height, width, gen);
+        randomDisplacement(displacementY, height, width, gen);
+    }
+
+    // Each output pixel samples the input at the inverse-transformed position.
+    double cosAngle = std::cos(angle);
+    double sinAngle = std::sin(angle);
+    double centreX = (width - 1) / 2.0;
+    double centreY = (height - 1) / 2.0;
+    std::vector<std::vector<std::vector<double>>> output(depth, std::vector<std::vector<double>>(height, std::vector<double>(width, 0.0)));
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double dx = x - centreX - shiftX;
+            double dy = y - centreY - shiftY;
+            double sourceX = cosAngle * dx + sinAngle * dy + centreX;
+            double sourceY = -sinAngle * dx + cosAngle * dy + centreY;
+            if (elastic) {
+                sourceX += displacementX[y * width + x];
+                sourceY += displacementY[y * width + x];
+            }
+
+            int x0 = static_cast<int>(std::floor(sourceX));
+            int y0 = static_cast<int>(std::floor(sourceY));
+            double fx = sourceX - x0;
+            double fy = sourceY - y0;
+            if (x0 < -1 || x0 >= width || y0 < -1 || y0 >= height) {
+                continue;
+            }
+            for (int d = 0; d < depth; ++d) {
+                auto sample = [&](int sy, int sx) {
+                    return sy >= 0 && sy < height && sx >= 0 && sx < width ? image[d][sy][sx] : 0.0;
+                };
+                output[d][y][x] = (1 - fy) * ((1 - fx) * sample(y0, x0) + fx * sample(y0, x0 + 1)) +
+                                  fy * ((1 - fx) * sample(y0 + 1, x0) + fx * sample(y0 + 1, x0 + 1));
+            }
+        }
+    }
+
+    if (config.noiseStddev > 0.0) {
+        std::normal_distribution<> noise(0.0, config.noiseStddev);
+        for (auto& channel : output) {
+            for (auto& row : channel) {
+                for (auto& value : row) {
+                    value += noise(gen);
+                }
+            }
+        }
+    }
+    return output;
+}
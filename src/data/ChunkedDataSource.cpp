@@ -0,0 +1,138 @@
+#include "data/ChunkedDataSource.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+ChunkedDataSource::ChunkedDataSource(const std::string& filePath, const ChunkedDataSourceConfig& config)
+    : filePath(filePath), config(config), gen(config.seed) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + filePath);
+    }
+    header = ChunkedDatasetHeader::read(file);
+    if (config.shuffleBufferSize < 1 || config.readAheadChunks < 1) {
+        throw std::invalid_argument("Shuffle buffer and read-ahead must hold at least one element.");
+    }
+    chunkOrder.resize(header.chunkCount());
+    std::iota(chunkOrder.begin(), chunkOrder.end(), 0);
+    shuffleBuffer.resize(config.shuffleBufferSize * header.recordSize());
+}
+
+ChunkedDataSource::ChunkedDataSource(const std::string& filePath)
+    : ChunkedDataSource(filePath, ChunkedDataSourceConfig()) {}
+
+ChunkedDataSource::~ChunkedDataSource() {
+    stopReading();
+}
+
+const ChunkedDatasetHeader& ChunkedDataSource::getHeader() const {
+    return header;
+}
+
+void ChunkedDataSource::stopReading() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopReader = true;
+    }
+    changed.notify_all();
+    if (reader.joinable()) {
+        reader.join();
+    }
+}
+
+void ChunkedDataSource::startEpoch() {
+    stopReading();
+    readChunks.clear();
+    currentChunk.clear();
+    currentPosition = 0;
+    buffered = 0;
+    readerDone = false;
+    stopReader = false;
+    readerError.clear();
+
+    std::shuffle(chunkOrder.begin(), chunkOrder.end(), gen);
+    reader = std::thread(&ChunkedDataSource::readChunksInOrder, this, chunkOrder);
+}
+
+void ChunkedDataSource::readChunksInOrder(std::vector<int> order) {
+    std::ifstream file(filePath, std::ios::binary);
+    size_t recordSize = header.recordSize();
+
+    for (int chunk : order) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return stopReader || readChunks.size() < config.readAheadChunks; });
+            if (stopReader) {
+                break;
+            }
+        }
+
+        size_t first = static_cast<size_t>(chunk) * header.samplesPerChunk;
+        size_t count = std::min<size_t>(header.samplesPerChunk, header.sampleCount - first);
+        std::vector<uint8_t> data(count * recordSize);
+        file.seekg(ChunkedDatasetHeader::dataOffset() + static_cast<std::streamoff>(first * recordSize));
+        file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!file) {
+            readerError = "Failed to read chunk " + std::to_string(chunk) + " of " + filePath;
+            break;
+        }
+        readChunks.push_back(std::move(data));
+        changed.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    readerDone = true;
+    changed.notify_all();
+}
+
+bool ChunkedDataSource::refillShuffleBuffer() {
+    size_t recordSize = header.recordSize();
+    while (buffered < config.shuffleBufferSize) {
+        if (currentPosition == currentChunk.size()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return !readChunks.empty() || readerDone; });
+            if (!readerError.empty()) {
+                throw std::runtime_error(readerError);
+            }
+            if (readChunks.empty()) {
+                break;
+            }
+            currentChunk = std::move(readChunks.front());
+            readChunks.pop_front();
+            currentPosition = 0;
+            changed.notify_all();
+        }
+
+        size_t records = std::min(config.shuffleBufferSize - buffered, (currentChunk.size() - currentPosition) / recordSize);
+        std::memcpy(&shuffleBuffer[buffered * recordSize], &currentChunk[currentPosition], records * recordSize);
+        buffered += records;
+        currentPosition += records * recordSize;
+    }
+    return buffered > 0;
+}
+
+ImageData ChunkedDataSource::decode(const uint8_t* record) const {
+    size_t pixelCount = header.pixelCount();
+    uint16_t label = 0;
+    std::memcpy(&label, record + pixelCount, sizeof(label));
+    return ImageData(header.depth, header.height, header.width, std::vector<uint8_t>(record, record + pixelCount),
+                     header.pixelScale, label, static_cast<uint16_t>(header.numClasses));
+}
+
+bool ChunkedDataSource::nextBatch(std::vector<ImageData>& batch, size_t maxSamples) {
+    batch.clear();
+    size_t recordSize = header.recordSize();
+    while (batch.size() < maxSamples && refillShuffleBuffer()) {
+        // Take a random buffered record and fill its slot with the last one.
+        size_t slot = std::uniform_int_distribution<size_t>(0, buffered - 1)(gen);
+        batch.push_back(decode(&shuffleBuffer[slot * recordSize]));
+        --buffered;
+        if (slot != buffered) {
+            std::memcpy(&shuffleBuffer[slot * recordSize], &shuffleBuffer[buffered * recordSize], recordSize);
+        }
+    }
+    return !batch.empty();
+}
@@ -0,0 +1,92 @@
+#include "data/ChunkedDataset.h"
+#include "utils/Serialization.h"
+#include <stdexcept>
+
+namespace {
+
+const char* const fileMagic = "CNNdata";
+const int32_t fileVersion = 1;
+
+} // namespace
+
+std::streamoff ChunkedDatasetHeader::dataOffset() {
+    // Magic string (length prefix + characters), version, six ints and the scale.
+    return sizeof(int32_t) + std::char_traits<char>::length(fileMagic) + 7 * sizeof(int32_t) + sizeof(double);
+}
+
+void ChunkedDatasetHeader::write(std::ostream& stream) const {
+    Serialization::writeString(stream, fileMagic);
+    Serialization::writeInt(stream, fileVersion);
+    Serialization::writeInt(stream, depth);
+    Serialization::writeInt(stream, height);
+    Serialization::writeInt(stream, width);
+    Serialization::writeInt(stream, numClasses);
+    Serialization::writeInt(stream, samplesPerChunk);
+    Serialization::writeInt(stream, sampleCount);
+    Serialization::writeDouble(stream, pixelScale);
+}
+
+ChunkedDatasetHeader ChunkedDatasetHeader::read(std::istream& stream) {
+    if (Serialization::readString(stream) != fileMagic || Serialization::readInt(stream) != fileVersion) {
+        throw std::runtime_error("Not a chunked dataset file or unsupported version.");
+    }
+    ChunkedDatasetHeader header;
+    header.depth = Serialization::readInt(stream);
+    header.height = Serialization::readInt(stream);
+    header.width = Serialization::readInt(stream);
+    header.numClasses = Serialization::readInt(stream);
+    header.samplesPerChunk = Serialization::readInt(stream);
+    header.sampleCount = Serialization::readInt(stream);
+    header.pixelScale = Serialization::readDouble(stream);
+    if (header.samplesPerChunk < 1 || header.numClasses < 1 || header.sampleCount < 0 || header.depth < 1 || header.height < 1 ||
+        header.width < 1) {
+        throw std::runtime_error("Corrupt chunked dataset header.");
+    }
+    return header;
+}
+
+ChunkedDatasetWriter::ChunkedDatasetWriter(const std::string& filePath, int depth, int height, int width, int numClasses, int samplesPerChunk, double pixelScale)
+    : file(filePath, std::ios::binary) {
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + filePath + " for writing.");
+    }
+    if (samplesPerChunk < 1 || numClasses < 1 || numClasses > 65536) {
+        throw std::invalid_argument("Invalid chunk size or number of classes.");
+    }
+    header.depth = depth;
+    header.height = height;
+    header.width = width;
+    header.numClasses = numClasses;
+    header.samplesPerChunk = samplesPerChunk;
+    header.pixelScale = pixelScale;
+    header.write(file);
+}
+
+ChunkedDatasetWriter::~ChunkedDatasetWriter() {
+    if (file.is_open()) {
+        try {
+            close();
+        } catch (...) {
+            // A destructor must not throw; callers that need the error call close themselves
+        }
+    }
+}
+
+void ChunkedDatasetWriter::addSample(const uint8_t* pixels, int label) {
+    if (label < 0 || label >= header.numClasses) {
+        throw std::invalid_argument("Label out of range.");
+    }
+    uint16_t storedLabel = static_cast<uint16_t>(label);
+    file.write(reinterpret_cast<const char*>(pixels), header.pixelCount());
+    file.write(reinterpret_cast<const char*>(&storedLabel), sizeof(storedLabel));
+    ++header.sampleCount;
+}
+
+void ChunkedDatasetWriter::close() {
+    file.seekp(0);
+    header.write(file);
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error("Failed to write chunked dataset.");
+    }
+}
@@ -0,0 +1,22 @@
+#include "data/InMemoryDataSource.h"
+#include <algorithm>
+#include <numeric>
+
+InMemoryDataSource::InMemoryDataSource(const std::vector<ImageData>& data)
+    : data(data), order(data.size()), position(data.size()), gen(std::random_device{}()) {
+    std::iota(order.begin(), order.end(), 0);
+}
+
+void InMemoryDataSource::startEpoch() {
+    std::shuffle(order.begin(), order.end(), gen);
+    position = 0;
+}
+
+bool InMemoryDataSource::nextBatch(std::vector<ImageData>& batch, size_t maxSamples) {
+    batch.clear();
+    size_t end = std::min(order.size(), position + maxSamples);
+    for (; position < end; ++position) {
+        batch.push_back(data[order[position]]);
+    }
+    return !batch.empty();
+}
@@ -0,0 +1,257 @@
+#include "data/RecordDataset.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Records read per file access by a decoding thread.
+const size_t recordsPerRead = 256;
+
+struct FileRange {
+    std::string path;
+    size_t firstRecord;
+    size_t recordCount;
+};
+
+} // namespace
+
+size_t RecordFormat::recordSize() const {
+    return std::max(static_cast<size_t>(labelOffset) + 1, pixelOffset + pixelCount());
+}
+
+RecordFormat RecordFormat::cifar10() {
+    RecordFormat format;
+    format.labelOffset = 0;
+    format.pixelOffset = 1;
+    format.depth = 3;
+    format.height = 32;
+    format.width = 32;
+    format.numClasses = 10;
+    return format;
+}
+
+RecordFormat RecordFormat::cifar100(bool fineLabels) {
+    RecordFormat format;
+    format.labelOffset = fineLabels ? 1 : 0;
+    format.pixelOffset = 2;
+    format.depth = 3;
+    format.height = 32;
+    format.width = 32;
+    format.numClasses = fineLabels ? 100 : 20;
+    return format;
+}
+
+RecordDataset RecordDataset::read(const std::vector<std::string>& files, const RecordFormat& format, int numThreads, bool normalize) {
+    RecordDataset dataset = decode(files, format, numThreads, nullptr);
+    if (normalize) {
+        size_t planeSize = static_cast<size_t>(format.height) * format.width;
+        for (size_t i = 0; i < dataset.size(); ++i) {
+            float* sample = &dataset.pixels[i * format.pixelCount()];
+            for (int c = 0; c < format.depth; ++c) {
+                float mean = static_cast<float>(dataset.statistics.mean[c]);
+                float scale = static_cast<float>(1.0 / dataset.statistics.stddev[c]);
+                for (size_t p = c * planeSize; p < (c + 1) * planeSize; ++p) {
+                    sample[p] = (sample[p] - mean) * scale;
+                }
+            }
+        }
+    }
+    return dataset;
+}
+
+RecordDataset RecordDataset::read(const std::vector<std::string>& files, const RecordFormat& format, int numThreads, const ChannelStatistics& normalization) {
+    if (static_cast<int>(normalization.mean.size()) != format.depth || static_cast<int>(normalization.stddev.size()) != format.depth) {
+        throw std::invalid_argument("Normalization statistics do not match the number of channels.");
+    }
+    for (double stddev : normalization.stddev) {
+        if (!(stddev > 0.0) || !std::isfinite(stddev)) {
+            throw std::invalid_argument("Normalization standard deviations must be positive.");
+        }
+    }
+    return decode(files, format, numThreads, &normalization);
+}
+
+RecordDataset RecordDataset::decode(const std::vector<std::string>& files, const RecordFormat& format, int numThreads, const ChannelStatistics* normalization) {
+    if (numThreads < 1) {
+        throw std::invalid_argument("Decoding needs at least one thread.");
+    }
+    if (format.depth < 1 || format.height < 1 || format.width < 1 || format.numClasses < 1 || format.numClasses > 256) {
+        throw std::invalid_argument("Invalid record format.");
+    }
+    if (format.fileHeaderBytes < 0 || format.labelOffset < 0 || format.pixelOffset < 0) {
+        throw std::invalid_argument("Record format offsets must not be negative.");
+    }
+    // The label byte may come before or after the pixels, but not inside them
+    if (static_cast<size_t>(format.labelOffset) >= static_cast<size_t>(format.pixelOffset) &&
+        static_cast<size_t>(format.labelOffset) < format.pixelOffset + format.pixelCount()) {
+        throw std::invalid_argument("Record format places the label inside the pixels.");
+    }
+
+    // Record counts follow from the file sizes.
+    size_t recordSize = format.recordSize();
+    std::vector<FileRange> ranges;
+    size_t total = 0;
+    for (const auto& path : files) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+        std::streamoff bytes = static_cast<std::streamoff>(file.tellg()) - format.fileHeaderBytes;
+        if (bytes < 0 || bytes % recordSize != 0) {
+            throw std::runtime_error(path + " is not a whole number of records.");
+        }
+        ranges.push_back(FileRange{ path, total, static_cast<size_t>(bytes) / recordSize });
+        total += ranges.back().recordCount;
+    }
+
+    RecordDataset dataset;
+    dataset.format = format;
+    dataset.pixels.resize(total * format.pixelCount());
+    dataset.labels.resize(total);
+
+    size_t planeSize = static_cast<size_t>(format.height) * format.width;
+    std::vector<float> shift(format.depth, 0.0f);
+    std::vector<float> scale(format.depth, 1.0f / 255.0f);
+    if (normalization) {
+        for (int c = 0; c < format.depth; ++c) {
+            shift[c] = static_cast<float>(normalization->mean[c]);
+            scale[c] = static_cast<float>(1.0 / (255.0 * normalization->stddev[c]));
+        }
+    }
+
+    // Thread t decodes records [t * total / numThreads, (t + 1) * total / numThreads), which may
+    // span several files, and keeps its own per-channel sums of the [0, 1] pixel values.
+    std::vector<std::vector<double>> sums(numThreads, std::vector<double>(format.depth, 0.0));
+    std::vector<std::vector<double>> squareSums(numThreads, std::vector<double>(format.depth, 0.0));
+    std::vector<std::string> errors(numThreads);
+    auto decodeRange = [&](int t) {
+        size_t begin = total * t / numThreads;
+        size_t end = total * (t + 1) / numThreads;
+        std::vector<uint8_t> buffer(recordsPerRead * recordSize);
+        try {
+            for (const auto& range : ranges) {
+                size_t first = std::max(begin, range.firstRecord);
+                size_t last = std::min(end, range.firstRecord + range.recordCount);
+                if (first >= last) {
+                    continue;
+                }
+                std::ifstream file(range.path, std::ios::binary);
+                file.seekg(format.fileHeaderBytes + static_cast<std::streamoff>((first - range.firstRecord) * recordSize));
+                for (size_t index = first; index < last;) {
+                    size_t count = std::min(recordsPerRead, last - index);
+                    file.read(reinterpret_cast<char*>(buffer.data()), count * recordSize);
+                    if (!file) {
+                        throw std::runtime_error("Failed to read " + range.path);
+                    }
+                    for (size_t r = 0; r < count; ++r, ++index) {
+                        const uint8_t* record = &buffer[r * recordSize];
+                        if (record[format.labelOffset] >= format.numClasses) {
+                            throw std::runtime_error("Label out of range in " + range.path);
+                        }
+                        dataset.labels[index] = record[format.labelOffset];
+
+                        const uint8_t* source = record + format.pixelOffset;
+                        float* target = &dataset.pixels[index * format.pixelCount()];
+                        for (int c = 0; c < format.depth; ++c) {
+                            double sum = 0.0;
+                            double squareSum = 0.0;
+                            for (size_t p = c * planeSize; p < (c + 1) * planeSize; ++p) {
+                                double value = source[p] / 255.0;
+                                sum += value;
+                                squareSum += value * value;
+                                target[p] = (source[p] - 255.0f * shift[c]) * scale[c];
+                            }
+                            sums[t][c] += sum;
+                            squareSums[t][c] += squareSum;
+                        }
+                    }
+                }
+            }
+        } catch (const std::exception& e) {
+            errors[t] = e.what();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; ++t) {
+        threads.emplace_back(decodeRange, t);
+    }
+    decodeRange(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+
+    dataset.statistics.mean.assign(format.depth, 0.0);
+    dataset.statistics.stddev.assign(format.depth, 0.0);
+    double valuesPerChannel = static_cast<double>(total) * planeSize;
+    for (int c = 0; c < format.depth; ++c) {
+        double sum = 0.0;
+        double squareSum = 0.0;
+        for (int t = 0; t < numThreads; ++t) {
+            sum += sums[t][c];
+            squareSum += squareSums[t][c];
+        }
+        double mean = total ? sum / valuesPerChannel : 0.0;
+        double variance = total ? squareSum / valuesPerChannel - mean * mean : 0.0;
+        dataset.statistics.mean[c] = mean;
+        // Constant channels keep unit scale rather than dividing by zero.
+        dataset.statistics.stddev[c] = variance > 1e-12 ? std::sqrt(variance) : 1.0;
+    }
+    return dataset;
+}
+
+size_t RecordDataset::size() const {
+    return labels.size();
+}
+
+std::vector<int> RecordDataset::getShape() const {
+    return {format.depth, format.height, format.width};
+}
+
+int RecordDataset::getNumClasses() const {
+    return format.numClasses;
+}
+
+int RecordDataset::getLabel(size_t index) const {
+    return labels[index];
+}
+
+const float* RecordDataset::getPixels(size_t index) const {
+    return &pixels[index * format.pixelCount()];
+}
+
+const ChannelStatistics& RecordDataset::getStatistics() const {
+    return statistics;
+}
+
+ImageData RecordDataset::getSample(size_t index) const {
+    const float* source = getPixels(index);
+    std::vector<std::vector<std::vector<double>>> image(format.depth, std::vector<std::vector<double>>(format.height, std::vector<double>(format.width)));
+    for (auto& channel : image) {
+        for (auto& row : channel) {
+            for (auto& value : row) {
+                value = *source++;
+            }
+        }
+    }
+    std::vector<double> oneHot(format.numClasses, 0.0);
+    oneHot[labels[index]] = 1.0;
+    return ImageData(image, oneHot);
+}
+
+std::vector<ImageData> RecordDataset::toImageData() const {
+    std::vector<ImageData> samples;
+    samples.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        samples.push_back(getSample(i));
+    }
+    return samples;
+}
@@ -0,0 +1,149 @@
+#include "distributed/GradientSynchronizer.h"
+#include <algorithm>
+
+GradientSynchronizer::GradientSynchronizer(std::shared_ptr<Transport> transport, size_t bucketBytes)
+    : allReduce(std::move(transport)), bucketBytes(bucketBytes), completedBuckets(0), stopping(false) {
+    worker = std::thread(&GradientSynchronizer::communicate, this);
+}
+
+GradientSynchronizer::~GradientSynchronizer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    worker.join();
+}
+
+void GradientSynchronizer::setLayers(const std::vector<ParameterizedLayer*>& layers) {
+    this->layers = layers;
+    buckets.clear();
+    bucketOfLayer.assign(layers.size(), 0);
+
+    // Backward finishes the last layer first, so buckets are filled from the back
+    size_t bucketValues = std::max<size_t>(1, bucketBytes / sizeof(double));
+    for (size_t i = layers.size(); i-- > 0;) {
+        if (buckets.empty() || buckets.back().buffer.size() >= bucketValues) {
+            buckets.push_back(Bucket{});
+        }
+        Bucket& bucket = buckets.back();
+        bucket.layerIndices.push_back(i);
+        bucket.buffer.resize(bucket.buffer.size() + layers[i]->getParameterCount());
+        bucketOfLayer[i] = buckets.size() - 1;
+    }
+    for (auto& bucket : buckets) {
+        bucket.pending = bucket.layerIndices.size();
+    }
+}
+
+void GradientSynchronizer::broadcastParameters() {
+    size_t total = 0;
+    for (auto* layer : layers) {
+        total += layer->getParameterCount();
+    }
+
+    // A sum all-reduce in which only rank 0 contributes is a broadcast from rank 0
+    std::vector<double> parameters(total, 0.0);
+    if (allReduce.getRank() == 0) {
+        size_t offset = 0;
+        for (auto* layer : layers) {
+            layer->readParameters(parameters.data() + offset);
+            offset += layer->getParameterCount();
+        }
+    }
+    allReduce.allReduce(parameters.data(), parameters.size());
+
+    size_t offset = 0;
+    for (auto* layer : layers) {
+        layer->writeParameters(parameters.data() + offset);
+        offset += layer->getParameterCount();
+    }
+}
+
+void GradientSynchronizer::markReady(size_t layerIndex) {
+    Bucket& bucket = buckets[bucketOfLayer[layerIndex]];
+    if (--bucket.pending > 0) {
+        return;
+    }
+
+    size_t offset = 0;
+    for (size_t i : bucket.layerIndices) {
+        layers[i]->readGradients(bucket.buffer.data() + offset);
+        offset += layers[i]->getParameterCount();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        queue.push_back(&bucket);
+    }
+    condition.notify_all();
+}
+
+void GradientSynchronizer::synchronize() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return error || completedBuckets == buckets.size(); });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        completedBuckets = 0;
+    }
+
+    double scale = 1.0 / allReduce.getWorldSize();
+    for (auto& bucket : buckets) {
+        for (double& value : bucket.buffer) {
+            value *= scale;
+        }
+        size_t offset = 0;
+        for (size_t i : bucket.layerIndices) {
+            layers[i]->writeGradients(bucket.buffer.data() + offset);
+            offset += layers[i]->getParameterCount();
+        }
+        bucket.pending = bucket.layerIndices.size();
+    }
+}
+
+int GradientSynchronizer::getRank() const {
+    return allReduce.getRank();
+}
+
+int GradientSynchronizer::getWorldSize() const {
+    return allReduce.getWorldSize();
+}
+
+void GradientSynchronizer::communicate() {
+    while (true) {
+        Bucket* bucket = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            bucket = queue.front();
+            queue.pop_front();
+        }
+
+        // Every rank queues the buckets in the same order, so the collectives line up
+        try {
+            allReduce.allReduce(bucket->buffer.data(), bucket->buffer.size());
+        } catch (...) {
+            // The ring is out of step after a failure, so nothing more is reduced
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+                queue.clear();
+            }
+            condition.notify_all();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++completedBuckets;
+        }
+        condition.notify_all();
+    }
+}
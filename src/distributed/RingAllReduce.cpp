@@ -0,0 +1,45 @@
+#include "distributed/RingAllReduce.h"
+#include <algorithm>
+
+RingAllReduce::RingAllReduce(std::shared_ptr<Transport> transport)
+    : transport(std::move(transport)) {}
+
+void RingAllReduce::allReduce(double* data, size_t count) {
+    int worldSize = transport->getWorldSize();
+    int rank = transport->getRank();
+    if (worldSize == 1 || count == 0) {
+        return;
+    }
+
+    auto chunkBegin = [count, worldSize](int chunk) { return count * chunk / worldSize; };
+    auto chunkSize = [&chunkBegin](int chunk) { return chunkBegin(chunk + 1) - chunkBegin(chunk); };
+    receiveBuffer.resize(chunkSize(0) + 1);
+
+    // Reduce-scatter: after step s, chunk (rank - s - 1) holds the sum of s + 2 ranks.
+    for (int step = 0; step < worldSize - 1; ++step) {
+        int sendChunk = (rank - step + worldSize) % worldSize;
+        int recvChunk = (rank - step - 1 + worldSize) % worldSize;
+        transport->exchange(data + chunkBegin(sendChunk), chunkSize(sendChunk) * sizeof(double),
+                            receiveBuffer.data(), chunkSize(recvChunk) * sizeof(double));
+        double* target = data + chunkBegin(recvChunk);
+        for (size_t i = 0; i < chunkSize(recvChunk); ++i) {
+            target[i] += receiveBuffer[i];
+        }
+    }
+
+    // All-gather: circulate the fully reduced chunks, starting with chunk (rank + 1).
+    for (int step = 0; step < worldSize - 1; ++step) {
+        int sendChunk = (rank + 1 - step + worldSize) % worldSize;
+        int recvChunk = (rank - step + worldSize) % worldSize;
+        transport->exchange(data + chunkBegin(sendChunk), chunkSize(sendChunk) * sizeof(double),
+                            data + chunkBegin(recvChunk), chunkSize(recvChunk) * sizeof(double));
+    }
+}
+
+int RingAllReduce::getRank() const {
+    return transport->getRank();
+}
+
+int RingAllReduce::getWorldSize() const {
+    return transport->getWorldSize();
+}
@@ -0,0 +1,147 @@
+#include "distributed/SharedMemoryTransport.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t readyMagic = 0x434e4e72; // "CNNr"
+const std::chrono::seconds connectTimeout(30);
+
+} // namespace
+
+// Header of a shared memory segment; the ring data follows it. head and tail count bytes
+// ever written and read, and sit on separate cache lines so the two processes don't false-share.
+struct SharedMemoryTransport::Channel {
+    std::atomic<uint32_t> ready;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+SharedMemoryTransport::SharedMemoryTransport(int rank, int worldSize, const std::string& jobName, size_t capacity)
+    : rank(rank), worldSize(worldSize), capacity(capacity), inboxName(segmentName(jobName, rank)), inbox(nullptr), outbox(nullptr) {
+    if (worldSize < 1 || rank < 0 || rank >= worldSize) {
+        throw std::invalid_argument("Rank must be in [0, worldSize).");
+    }
+
+    // Create our own inbox
+    shm_unlink(inboxName.c_str());
+    int fd = shm_open(inboxName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, segmentSize()) != 0) {
+        if (fd >= 0) close(fd);
+        throw std::runtime_error("Failed to create shared memory segment " + inboxName);
+    }
+    void* inboxMemory = mmap(nullptr, segmentSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (inboxMemory == MAP_FAILED) {
+        throw std::runtime_error("Failed to map shared memory segment " + inboxName);
+    }
+    inbox = new (inboxMemory) Channel;
+    inbox->head.store(0, std::memory_order_relaxed);
+    inbox->tail.store(0, std::memory_order_relaxed);
+    inbox->ready.store(readyMagic, std::memory_order_release);
+
+    // Attach to the next rank's inbox once it has been created and initialized
+    std::string outboxName = segmentName(jobName, (rank + 1) % worldSize);
+    auto deadline = std::chrono::steady_clock::now() + connectTimeout;
+    void* outboxMemory = MAP_FAILED;
+    while (outboxMemory == MAP_FAILED) {
+        fd = shm_open(outboxName.c_str(), O_RDWR, 0600);
+        struct stat info;
+        if (fd >= 0 && fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) == segmentSize()) {
+            outboxMemory = mmap(nullptr, segmentSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (fd >= 0) close(fd);
+        if (outboxMemory == MAP_FAILED) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("Timed out waiting for shared memory segment " + outboxName);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    outbox = static_cast<Channel*>(outboxMemory);
+    while (outbox->ready.load(std::memory_order_acquire) != readyMagic) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error("Timed out waiting for shared memory segment " + outboxName);
+        }
+        std::this_thread::yield();
+    }
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+    if (outbox) munmap(outbox, segmentSize());
+    if (inbox) munmap(inbox, segmentSize());
+    shm_unlink(inboxName.c_str());
+}
+
+int SharedMemoryTransport::getRank() const {
+    return rank;
+}
+
+int SharedMemoryTransport::getWorldSize() const {
+    return worldSize;
+}
+
+void SharedMemoryTransport::exchange(const void* sendData, size_t sendSize, void* recvData, size_t recvSize) {
+    const char* source = static_cast<const char*>(sendData);
+    char* destination = static_cast<char*>(recvData);
+    size_t sent = 0;
+    size_t received = 0;
+
+    while (sent < sendSize || received < recvSize) {
+        bool progress = false;
+
+        if (sent < sendSize) {
+            uint64_t head = outbox->head.load(std::memory_order_relaxed);
+            uint64_t tail = outbox->tail.load(std::memory_order_acquire);
+            size_t count = std::min<size_t>(capacity - (head - tail), sendSize - sent);
+            if (count > 0) {
+                size_t offset = head % capacity;
+                size_t first = std::min(count, capacity - offset);
+                std::memcpy(outbox->data() + offset, source + sent, first);
+                std::memcpy(outbox->data(), source + sent + first, count - first);
+                outbox->head.store(head + count, std::memory_order_release);
+                sent += count;
+                progress = true;
+            }
+        }
+
+        if (received < recvSize) {
+            uint64_t tail = inbox->tail.load(std::memory_order_relaxed);
+            uint64_t head = inbox->head.load(std::memory_order_acquire);
+            size_t count = std::min<size_t>(head - tail, recvSize - received);
+            if (count > 0) {
+                size_t offset = tail % capacity;
+                size_t first = std::min(count, capacity - offset);
+                std::memcpy(destination + received, inbox->data() + offset, first);
+                std::memcpy(destination + received + first, inbox->data(), count - first);
+                inbox->tail.store(tail + count, std::memory_order_release);
+                received += count;
+                progress = true;
+            }
+        }
+
+        if (!progress) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+size_t SharedMemoryTransport::segmentSize() const {
+    return sizeof(Channel) + capacity;
+}
+
+std::string SharedMemoryTransport::segmentName(const std::string& jobName, int rank) {
+    return "/" + jobName + "." + std::to_string(rank);
+}
@@ -0,0 +1,128 @@
+#include "distributed/SocketTransport.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const std::chrono::seconds connectTimeout(30);
+
+sockaddr_un makeAddress(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path is too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+} // namespace
+
+SocketTransport::SocketTransport(int rank, int worldSize, const std::string& directory, const std::string& jobName)
+    : rank(rank), worldSize(worldSize), socketPath(socketName(directory, jobName, rank)), listenSocket(-1), nextSocket(-1), previousSocket(-1) {
+    if (worldSize < 1 || rank < 0 || rank >= worldSize) {
+        throw std::invalid_argument("Rank must be in [0, worldSize).");
+    }
+
+    sockaddr_un listenAddress = makeAddress(socketPath);
+    unlink(socketPath.c_str());
+    listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0 || bind(listenSocket, reinterpret_cast<sockaddr*>(&listenAddress), sizeof(listenAddress)) != 0 || listen(listenSocket, 1) != 0) {
+        if (listenSocket >= 0) close(listenSocket);
+        throw std::runtime_error("Failed to listen on " + socketPath);
+    }
+
+    // Connect to the next rank, retrying until it is listening
+    sockaddr_un nextAddress = makeAddress(socketName(directory, jobName, (rank + 1) % worldSize));
+    auto deadline = std::chrono::steady_clock::now() + connectTimeout;
+    while (true) {
+        nextSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (nextSocket >= 0 && connect(nextSocket, reinterpret_cast<sockaddr*>(&nextAddress), sizeof(nextAddress)) == 0) {
+            break;
+        }
+        if (nextSocket >= 0) close(nextSocket);
+        nextSocket = -1;
+        if (std::chrono::steady_clock::now() > deadline) {
+            close(listenSocket);
+            unlink(socketPath.c_str());
+            throw std::runtime_error(std::string("Timed out connecting to ") + nextAddress.sun_path);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    previousSocket = accept(listenSocket, nullptr, nullptr);
+    if (previousSocket < 0) {
+        close(nextSocket);
+        close(listenSocket);
+        unlink(socketPath.c_str());
+        throw std::runtime_error("Failed to accept the previous rank on " + socketPath);
+    }
+
+    fcntl(nextSocket, F_SETFL, fcntl(nextSocket, F_GETFL) | O_NONBLOCK);
+    fcntl(previousSocket, F_SETFL, fcntl(previousSocket, F_GETFL) | O_NONBLOCK);
+}
+
+SocketTransport::~SocketTransport() {
+    if (previousSocket >= 0) close(previousSocket);
+    if (nextSocket >= 0) close(nextSocket);
+    if (listenSocket >= 0) close(listenSocket);
+    unlink(socketPath.c_str());
+}
+
+int SocketTransport::getRank() const {
+    return rank;
+}
+
+int SocketTransport::getWorldSize() const {
+    return worldSize;
+}
+
+void SocketTransport::exchange(const void* sendData, size_t sendSize, void* recvData, size_t recvSize) {
+    const char* source = static_cast<const char*>(sendData);
+    char* destination = static_cast<char*>(recvData);
+    size_t sent = 0;
+    size_t received = 0;
+
+    while (sent < sendSize || received < recvSize) {
+        pollfd fds[2] = {
+            { nextSocket, static_cast<short>(sent < sendSize ? POLLOUT : 0), 0 },
+            { previousSocket, static_cast<short>(received < recvSize ? POLLIN : 0), 0 },
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("poll failed during exchange");
+        }
+
+        // poll reports a hang-up even where no events were asked for: a neighbour that finished
+        // and closed its end is only an error while there is still data to move on that socket
+        if (sent < sendSize && (fds[0].revents & POLLOUT)) {
+            ssize_t count = send(nextSocket, source + sent, sendSize - sent, MSG_NOSIGNAL);
+            if (count < 0 && errno != EAGAIN && errno != EINTR) {
+                throw std::runtime_error("Lost connection to the next rank.");
+            }
+            if (count > 0) sent += count;
+        } else if (sent < sendSize && (fds[0].revents & (POLLERR | POLLHUP))) {
+            throw std::runtime_error("Lost connection to the next rank.");
+        }
+
+        if (received < recvSize && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t count = recv(previousSocket, destination + received, recvSize - received, 0);
+            if (count == 0 || (count < 0 && errno != EAGAIN && errno != EINTR)) {
+                throw std::runtime_error("Lost connection to the previous rank.");
+            }
+            if (count > 0) received += count;
+        }
+    }
+}
+
+std::string SocketTransport::socketName(const std::string& directory, const std::string& jobName, int rank) {
+    return directory + "/" + jobName + "." + std::to_string(rank) + ".sock";
+}
@@ -0,0 +1,349 @@
+#include "layers/BatchNormLayer.h"
+#include "utils/Serialization.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+BatchNormLayer::BatchNormLayer(double momentum, double epsilon, std::shared_ptr<ActivationFunction> activationFunction)
+    : momentum(momentum), epsilon(epsilon), activationFunction(std::move(activationFunction)) {
+    if (momentum <= 0.0 || momentum > 1.0) {
+        throw std::invalid_argument("Momentum must be in (0, 1].");
+    }
+    if (epsilon <= 0.0) {
+        throw std::invalid_argument("Epsilon must be positive.");
+    }
+}
+
+BatchNormLayer::BatchNormLayer(std::shared_ptr<ActivationFunction> activationFunction)
+    : BatchNormLayer(0.1, 1e-5, std::move(activationFunction)) {}
+
+void BatchNormLayer::initialize(const std::vector<int>& inputShape) {
+    if (inputShape.size() != 1 && inputShape.size() != 3) {
+        throw std::invalid_argument("Expected input shape with 1 dimension (features) or 3 dimensions (depth, height, width).");
+    }
+    perFeature = inputShape.size() == 1;
+    channels = inputShape[0];
+    // Gamma starts at one and beta at zero
+    parameters.resize(2 * channels);
+    std::fill(parameters.parameters(), parameters.parameters() + channels, 1.0);
+
+    // A loaded layer already carries its running statistics.
+    if (runningMean.empty()) {
+        runningMean.assign(channels, 0.0);
+        runningVariance.assign(channels, 1.0);
+    } else if (runningMean.size() != channels) {
+        throw std::invalid_argument("Running statistics do not match the input shape.");
+    }
+    refreshInferenceAffine();
+}
+
+template <typename Tensor, typename Visit>
+void BatchNormLayer::forEachValue(Tensor& tensor, Visit visit) const {
+    for (size_t d = 0; d < tensor.size(); ++d) {
+        for (auto& row : tensor[d]) {
+            for (size_t j = 0; j < row.size(); ++j) {
+                visit(perFeature ? j : d, row[j]);
+            }
+        }
+    }
+}
+
+std::vector<std::vector<std::vector<double>>> BatchNormLayer::forward(const std::vector<std::vector<std::vector<double>>>& input) {
+    return forward(input, defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> BatchNormLayer::backward(std::vector<std::vector<std::vector<double>>> gradient) {
+    return backward(std::move(gradient), defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> BatchNormLayer::forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) {
+    const double* gamma = parameters.parameters();
+    const double* beta = gamma + channels;
+    std::vector<double> inverseStd(channels);
+    for (size_t c = 0; c < channels; ++c) {
+        inverseStd[c] = 1.0 / std::sqrt(runningVariance[c] + epsilon);
+    }
+
+    // cache.input keeps the normalized input for backward
+    cache.input = input;
+    cache.output = input;
+    auto& normalized = cache.input;
+    auto& output = cache.output;
+    for (size_t d = 0; d < output.size(); ++d) {
+        for (size_t i = 0; i < output[d].size(); ++i) {
+            for (size_t j = 0; j < output[d][i].size(); ++j) {
+                size_t c = perFeature ? j : d;
+                double value = (input[d][i][j] - runningMean[c]) * inverseStd[c];
+                normalized[d][i][j] = value;
+                output[d][i][j] = activationFunction->activate(gamma[c] * value + beta[c]);
+            }
+        }
+    }
+    return output;
+}
+
+std::vector<std::vector<std::vector<double>>> BatchNormLayer::infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const {
+    // Nothing is kept for backward, so the transform folds into one multiply-add per value
+    auto& output = workspace.output;
+    output = input;
+    forEachValue(output, [&](size_t c, double& value) {
+        value = activationFunction->activate(inferenceScale[c] * value + inferenceShift[c]);
+    });
+    return output;
+}
+
+std::vector<std::vector<std::vector<double>>> BatchNormLayer::backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) {
+    return backpropagate(gradient, cache, parameters.gradients(), 1.0);
+}
+
+std::vector<std::vector<std::vector<double>>> BatchNormLayer::backwardAndUpdate(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache, double learningRate) {
+    return backpropagate(gradient, cache, parameters.parameters(), -learningRate);
+}
+
+std::vector<std::vector<std::vector<double>>> BatchNormLayer::backpropagate(std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                            double* target, double scale) {
+    const auto& normalized = cache.input;
+    if (gradient.empty() || normalized.empty()) {
+        throw std::runtime_error("Invalid input: one or more vectors are empty");
+    }
+
+    // The running statistics are constants here, so the layer is a per-channel affine map.
+    // gamma and beta are read here, before target (which may be the parameters) is written.
+    const double* gamma = parameters.parameters();
+    const double* beta = gamma + channels;
+    std::vector<double> gammaGrad(channels, 0.0);
+    std::vector<double> betaGrad(channels, 0.0);
+    std::vector<double> inputScale(channels);
+    for (size_t c = 0; c < channels; ++c) {
+        inputScale[c] = gamma[c] / std::sqrt(runningVariance[c] + epsilon);
+    }
+    for (size_t d = 0; d < gradient.size(); ++d) {
+        for (size_t i = 0; i < gradient[d].size(); ++i) {
+            for (size_t j = 0; j < gradient[d][i].size(); ++j) {
+                size_t c = perFeature ? j : d;
+                // The activation's derivative takes its input, rebuilt from the normalized value
+                double preActivation = gamma[c] * normalized[d][i][j] + beta[c];
+                double g = gradient[d][i][j] * activationFunction->derivative(preActivation);
+                gammaGrad[c] += g * normalized[d][i][j];
+                betaGrad[c] += g;
+                gradient[d][i][j] = g * inputScale[c];
+            }
+        }
+    }
+
+    for (size_t c = 0; c < channels; ++c) {
+        target[c] += scale * gammaGrad[c];
+        target[channels + c] += scale * betaGrad[c];
+    }
+    return gradient;
+}
+
+void BatchNormLayer::forwardMiniBatch(std::vector<std::vector<std::vector<std::vector<double>>>>& batch, std::vector<LayerCache>& caches) {
+    const double* gamma = parameters.parameters();
+    const double* beta = gamma + channels;
+    if (batch.empty()) {
+        return;
+    }
+    caches.resize(batch.size());
+
+    // Sums are taken relative to the first value of each channel so that the one-pass variance
+    // does not cancel catastrophically for inputs with a large mean.
+    std::vector<double> reference(channels, 0.0);
+    std::vector<double> sum(channels, 0.0);
+    std::vector<double> sumOfSquares(channels, 0.0);
+    std::vector<size_t> count(channels, 0);
+    for (const auto& sample : batch) {
+        forEachValue(sample, [&](size_t c, double value) {
+            if (count[c]++ == 0) {
+                reference[c] = value;
+            }
+            double centered = value - reference[c];
+            sum[c] += centered;
+            sumOfSquares[c] += centered * centered;
+        });
+    }
+
+    // 1 / sqrt(variance + epsilon) of this mini-batch, which backwardMiniBatch needs
+    std::vector<double> mean(channels);
+    auto& batchInverseStd = caches[0].batchStatistics;
+    batchInverseStd.resize(channels);
+    for (size_t c = 0; c < channels; ++c) {
+        double n = static_cast<double>(count[c]);
+        double centeredMean = sum[c] / n;
+        double variance = std::max(0.0, sumOfSquares[c] / n - centeredMean * centeredMean);
+        mean[c] = reference[c] + centeredMean;
+        batchInverseStd[c] = 1.0 / std::sqrt(variance + epsilon);
+
+        double unbiasedVariance = count[c] > 1 ? variance * n / (n - 1.0) : variance;
+        runningMean[c] += momentum * (mean[c] - runningMean[c]);
+        runningVariance[c] += momentum * (unbiasedVariance - runningVariance[c]);
+    }
+    refreshInferenceAffine();
+
+    // Normalize, scale, shift and activate in one pass over each sample.
+    for (size_t k = 0; k < batch.size(); ++k) {
+        auto& sample = batch[k];
+        caches[k].input = sample;
+        auto& normalized = caches[k].input;
+        for (size_t d = 0; d < sample.size(); ++d) {
+            for (size_t i = 0; i < sample[d].size(); ++i) {
+                for (size_t j = 0; j < sample[d][i].size(); ++j) {
+                    size_t c = perFeature ? j : d;
+                    double value = (sample[d][i][j] - mean[c]) * batchInverseStd[c];
+                    normalized[d][i][j] = value;
+                    sample[d][i][j] = activationFunction->activate(gamma[c] * value + beta[c]);
+                }
+            }
+        }
+    }
+}
+
+void BatchNormLayer::backwardMiniBatch(std::vector<std::vector<std::vector<std::vector<double>>>>& gradients, std::vector<LayerCache>& caches) {
+    const double* gamma = parameters.parameters();
+    const double* beta = gamma + channels;
+    double* gammaGradients = parameters.gradients();
+    double* betaGradients = gammaGradients + channels;
+    if (gradients.empty()) {
+        return;
+    }
+    const auto& batchInverseStd = caches[0].batchStatistics;
+
+    // One pass applies the activation derivative and reduces both sums the input gradient needs:
+    // dx = gamma * invStd / n * (n * g - sum(g) - xhat * sum(g * xhat)).
+    std::vector<double> sumGradient(channels, 0.0);
+    std::vector<double> sumGradientNormalized(channels, 0.0);
+    std::vector<size_t> count(channels, 0);
+    for (size_t k = 0; k < gradients.size(); ++k) {
+        auto& gradient = gradients[k];
+        const auto& normalized = caches[k].input;
+        for (size_t d = 0; d < gradient.size(); ++d) {
+            for (size_t i = 0; i < gradient[d].size(); ++i) {
+                for (size_t j = 0; j < gradient[d][i].size(); ++j) {
+                    size_t c = perFeature ? j : d;
+                    double g = gradient[d][i][j] * activationFunction->derivative(gamma[c] * normalized[d][i][j] + beta[c]);
+                    gradient[d][i][j] = g;
+                    sumGradient[c] += g;
+                    sumGradientNormalized[c] += g * normalized[d][i][j];
+                    ++count[c];
+                }
+            }
+        }
+    }
+
+    std::vector<double> meanGradient(channels);
+    std::vector<double> meanGradientNormalized(channels);
+    for (size_t c = 0; c < channels; ++c) {
+        gammaGradients[c] += sumGradientNormalized[c];
+        betaGradients[c] += sumGradient[c];
+        meanGradient[c] = sumGradient[c] / count[c];
+        meanGradientNormalized[c] = sumGradientNormalized[c] / count[c];
+    }
+
+    for (size_t k = 0; k < gradients.size(); ++k) {
+        auto& gradient = gradients[k];
+        const auto& normalized = caches[k].input;
+        for (size_t d = 0; d < gradient.size(); ++d) {
+            for (size_t i = 0; i < gradient[d].size(); ++i) {
+                for (size_t j = 0; j < gradient[d][i].size(); ++j) {
+                    size_t c = perFeature ? j : d;
+                    gradient[d][i][j] = gamma[c] * batchInverseStd[c] *
+                                        (gradient[d][i][j] - meanGradient[c] - normalized[d][i][j] * meanGradientNormalized[c]);
+                }
+            }
+        }
+    }
+}
+
+void BatchNormLayer::updateParameters(double learningRate, int miniBatchSize) {
+    parameters.applyGradients(learningRate / miniBatchSize);
+    refreshInferenceAffine();
+}
+
+void BatchNormLayer::resetGradients() {
+    parameters.zeroGradients();
+}
+
+size_t BatchNormLayer::getParameterCount() const {
+    return parameters.size();
+}
+
+void BatchNormLayer::readParameters(double* buffer) const {
+    std::copy(parameters.parameters(), parameters.parameters() + parameters.size(), buffer);
+}
+
+void BatchNormLayer::writeParameters(const double* buffer) {
+    std::copy(buffer, buffer + parameters.size(), parameters.parameters());
+    refreshInferenceAffine();
+}
+
+void BatchNormLayer::readGradients(double* buffer) const {
+    std::copy(parameters.gradients(), parameters.gradients() + parameters.size(), buffer);
+}
+
+void BatchNormLayer::writeGradients(const double* buffer) {
+    std::copy(buffer, buffer + parameters.size(), parameters.gradients());
+}
+
+void BatchNormLayer::bindStorage(std::shared_ptr<ParameterStore> store, size_t offset) {
+    parameters.bind(std::move(store), offset);
+}
+
+void BatchNormLayer::parametersChanged() {
+    refreshInferenceAffine();
+}
+
+void BatchNormLayer::refreshInferenceAffine() {
+    getInferenceAffine(inferenceScale, inferenceShift);
+}
+
+void BatchNormLayer::getInferenceAffine(std::vector<double>& scale, std::vector<double>& shift) const {
+    const double* gamma = parameters.parameters();
+    const double* beta = gamma + channels;
+    scale.resize(channels);
+    shift.resize(channels);
+    for (size_t c = 0; c < channels; ++c) {
+        scale[c] = gamma[c] / std::sqrt(runningVariance[c] + epsilon);
+        shift[c] = beta[c] - runningMean[c] * scale[c];
+    }
+}
+
+std::shared_ptr<ActivationFunction> BatchNormLayer::getActivationFunction() const {
+    return activationFunction;
+}
+
+std::vector<int> BatchNormLayer::getOutputShape(const std::vector<int>& inputShape) {
+    return inputShape;
+}
+
+SpatialLayer::Window BatchNormLayer::getWindow() const {
+    return {1, 1, 0, 1};
+}
+
+std::shared_ptr<Layer> BatchNormLayer::clone() const {
+    return std::make_shared<BatchNormLayer>(*this);
+}
+
+void BatchNormLayer::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "BatchNormLayer");
+    Serialization::writeDouble(stream, momentum);
+    Serialization::writeDouble(stream, epsilon);
+    activationFunction->save(stream);
+    Serialization::writeInt(stream, static_cast<int32_t>(runningMean.size()));
+    Serialization::writeDoubles(stream, runningMean.data(), runningMean.size());
+    Serialization::writeDoubles(stream, runningVariance.data(), runningVariance.size());
+}
+
+std::shared_ptr<BatchNormLayer> BatchNormLayer::load(std::istream& stream) {
+    double momentum = Serialization::readDouble(stream);
+    double epsilon = Serialization::readDouble(stream);
+    auto layer = std::make_shared<BatchNormLayer>(momentum, epsilon, Serialization::readActivationFunction(stream));
+    int32_t channels = Serialization::readInt(stream);
+    if (channels < 0) {
+        throw std::runtime_error("Invalid channel count in network file.");
+    }
+    layer->runningMean.resize(channels);
+    layer->runningVariance.resize(channels);
+    Serialization::readDoubles(stream, layer->runningMean.data(), channels);
+    Serialization::readDoubles(stream, layer->runningVariance.data(), channels);
+    return layer;
+}
@@ -1,10 +1,35 @@
 #include "layers/ConvolutionalLayer.h"
-#include "utils/MatrixUtils.h"
+#include "utils/BlockedTensor.h"
+#include "utils/ConvolutionKernels.h"
+#include "utils/Serialization.h"
+#include "utils/ThreadPool.h"
 #include "utils/activationFunctions/ReLU.h"
 #include <iostream>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+ConvolutionalLayer::ConvolutionalLayer(int filterSize, int numFilters, int stride, int padding, int dilation, int groups, std::shared_ptr<ActivationFunction> activationFunction)
+    : filterSize(filterSize), numFilters(numFilters), stride(stride), padding(padding), dilation(dilation), groups(groups), activationFunction(activationFunction) {
+    if (groups < 1 || numFilters % groups != 0) {
+        throw std::invalid_argument("Number of filters must be divisible by the number of groups");
+    }
+    if (dilation < 1) {
+        throw std::invalid_argument("Dilation must be positive");
+    }
+    if (padding == SamePadding) {
+        this->padding = dilation * (filterSize - 1) / 2;
+    } else if (padding < 0) {
+        throw std::invalid_argument("Padding must be non-negative");
+    }
+}
+
+ConvolutionalLayer::ConvolutionalLayer(int filterSize, int numFilters, int stride, int groups, std::shared_ptr<ActivationFunction> activationFunction)
+    : ConvolutionalLayer(filterSize, numFilters, stride, 0, 1, groups, activationFunction) {}
 
 ConvolutionalLayer::ConvolutionalLayer(int filterSize, int numFilters, int stride, std::shared_ptr<ActivationFunction> activationFunction)
-    : filterSize(filterSize), numFilters(numFilters), stride(stride), activationFunction(activationFunction) {}
+    : ConvolutionalLayer(filterSize, numFilters, stride, 1, activationFunction) {}
 
 ConvolutionalLayer::ConvolutionalLayer(int filterSize, int numFilters, std::shared_ptr<ActivationFunction> activationFunction)
     : ConvolutionalLayer(filterSize, numFilters, 1, activationFunction) {}
@@ -12,156 +37,580 @@ ConvolutionalLayer::ConvolutionalLayer(int filterSize, int numFilters, std::shar
 ConvolutionalLayer::ConvolutionalLayer(int filterSize, int numFilters)
     : ConvolutionalLayer(filterSize, numFilters, 1, std::make_shared<ReLU>()) {}
 
-void ConvolutionalLayer::initializeFilters(int inputDepth) {
+namespace {
+
+// Minimum multiply-adds per task, so a task outweighs the cost of scheduling it.
+const size_t minimumTaskWork = 16384;
+
+// Copies input into padded with a zero border of the given width, reusing padded's storage.
+void copyWithHalo(const std::vector<std::vector<std::vector<double>>>& input, int padding,
+                  std::vector<std::vector<std::vector<double>>>& padded) {
+    int height = input[0].size();
+    int width = input[0][0].size();
+    padded.resize(input.size());
+    for (size_t d = 0; d < input.size(); ++d) {
+        padded[d].resize(height + 2 * padding);
+        for (int i = 0; i < height + 2 * padding; ++i) {
+            auto& row = padded[d][i];
+            row.assign(width + 2 * padding, 0.0);
+            if (i >= padding && i < height + padding) {
+                std::copy(input[d][i - padding].begin(), input[d][i - padding].end(), row.begin() + padding);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void ConvolutionalLayer::initializeFilters() {
     std::random_device rd;
     std::mt19937 gen(rd());
-    std::normal_distribution<> dist(0.0, std::sqrt(2.0 / (inputDepth * filterSize * filterSize)));
+    std::normal_distribution<> dist(0.0, std::sqrt(2.0 / (filterDepth * filterSize * filterSize)));
+
+    double* filters = parameters.parameters();
+    for (size_t k = 0; k < biasOffset(); ++k) {
+        filters[k] = dist(gen);
+    }
+}
+
+void ConvolutionalLayer::initialize(const std::vector<int>& inputShape) {
+    int inputDepth = inputShape[0];
+    if (inputDepth % groups != 0) {
+        throw std::invalid_argument("Input depth must be divisible by the number of groups");
+    }
+    checkInputSize(inputShape);
+    filterDepth = inputDepth / groups;
+    // Biases start at zero
+    parameters.resize(static_cast<size_t>(numFilters) * filterDepth * filterSize * filterSize + numFilters);
+    initializeFilters();
+    packBlockedFilters();
+    setForwardConfig(ConvolutionConfig());
+    if (ConvolutionTuner::isEnabled()) {
+        tune(inputShape);
+    }
+}
+
+std::string ConvolutionalLayer::tuningKey(const std::vector<int>& inputShape) const {
+    // The thread count is part of the key since it shifts the balance between the algorithms
+    std::ostringstream key;
+    key << ConvolutionTuner::cpuModel() << " | " << ThreadPool::global().getThreadCount() << " pool workers | conv input "
+        << inputShape[0] << "x" << inputShape[1] << "x" << inputShape[2] << " filterSize " << filterSize << " numFilters "
+        << numFilters << " stride " << stride << " padding " << padding << " dilation " << dilation << " groups " << groups;
+    return key.str();
+}
+
+void ConvolutionalLayer::tune(const std::vector<int>& inputShape) {
+    std::string key = tuningKey(inputShape);
+    ConvolutionConfig best;
+    if (ConvolutionTuner::lookup(key, best)) {
+        setForwardConfig(best);
+        return;
+    }
+
+    std::vector<ConvolutionConfig> candidates;
+    candidates.push_back({ConvolutionConfig::Generic, 0});
+    if (ConvolutionKernels::select(filterSize, stride, dilation) != ConvolutionKernels::generic) {
+        candidates.push_back({ConvolutionConfig::Specialized, 0});
+    }
+    int pixels = outputSize(inputShape[1]) * outputSize(inputShape[2]);
+    for (int tileSize : {16, 64, 256, 1024}) {
+        candidates.push_back({ConvolutionConfig::Im2col, std::min(tileSize, pixels)});
+        if (tileSize >= pixels) {
+            break;
+        }
+    }
+    candidates.push_back({ConvolutionConfig::Blocked, 0});
+
+    // The timings do not depend on the values, only on the shape
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> value(-1.0, 1.0);
+    std::vector<std::vector<std::vector<double>>> input(inputShape[0], std::vector<std::vector<double>>(inputShape[1], std::vector<double>(inputShape[2])));
+    for (auto& channel : input) {
+        for (auto& row : channel) {
+            for (auto& v : row) {
+                v = value(gen);
+            }
+        }
+    }
+
+    LayerCache scratch;
+    double bestSeconds = std::numeric_limits<double>::max();
+    for (const auto& candidate : candidates) {
+        setForwardConfig(candidate);
+        double seconds = ConvolutionTuner::secondsPerRun([&] { forward(input, scratch); });
+        if (seconds < bestSeconds) {
+            bestSeconds = seconds;
+            best = candidate;
+        }
+    }
+    setForwardConfig(best);
+    ConvolutionTuner::store(key, best);
+}
+
+const ConvolutionConfig& ConvolutionalLayer::getForwardConfig() const {
+    return forwardConfig;
+}
 
-    filters.resize(numFilters);
+void ConvolutionalLayer::setForwardConfig(const ConvolutionConfig& config) {
+    if (config.algorithm == ConvolutionConfig::Im2col && config.tileSize < 1) {
+        throw std::invalid_argument("Im2col needs a positive tile size");
+    }
+    forwardConfig = config;
+    channelKernel = config.algorithm == ConvolutionConfig::Generic ? ConvolutionKernels::generic
+                                                                    : ConvolutionKernels::select(filterSize, stride, dilation);
+}
+
+size_t ConvolutionalLayer::filterOffset(int f, int d) const {
+    return (static_cast<size_t>(f) * filterDepth + d) * filterSize * filterSize;
+}
+
+size_t ConvolutionalLayer::biasOffset() const {
+    return static_cast<size_t>(numFilters) * filterDepth * filterSize * filterSize;
+}
+
+int ConvolutionalLayer::groupOffset(int f) const {
+    return f / (numFilters / groups) * filterDepth;
+}
+
+int ConvolutionalLayer::outputSize(int inputSize) const {
+    return (inputSize + 2 * padding - dilation * (filterSize - 1) - 1) / stride + 1;
+}
+
+size_t ConvolutionalLayer::grainSize(size_t workPerIndex) {
+    return std::max<size_t>(1, minimumTaskWork / std::max<size_t>(1, workPerIndex));
+}
+
+void ConvolutionalLayer::checkInputSize(const std::vector<int>& inputShape) const {
+    int extent = dilation * (filterSize - 1) + 1;
+    if (inputShape[1] + 2 * padding < extent || inputShape[2] + 2 * padding < extent) {
+        throw std::invalid_argument("Input is smaller than the dilated filter");
+    }
+}
+
+void ConvolutionalLayer::packBlockedFilters() {
+    const int B = BlockedTensor::BlockSize;
+    int inputDepth = filterDepth * groups;
+    int filterBlocks = (numFilters + B - 1) / B;
+    int depthBlocks = (inputDepth + B - 1) / B;
+
+    blockedFilters.assign(static_cast<size_t>(filterBlocks) * depthBlocks * filterSize * filterSize * B * B, 0.0);
+    blockedBiases.assign(static_cast<size_t>(filterBlocks) * B, 0.0);
+    // Grouped filters are packed against all input channels, with zeros outside their group.
+    const double* values = parameters.parameters();
     for (int f = 0; f < numFilters; ++f) {
-        filters[f].resize(inputDepth);
-        for (int d = 0; d < inputDepth; ++d) {
-            filters[f][d].resize(filterSize, std::vector<double>(filterSize));
+        for (int channel = 0; channel < filterDepth; ++channel) {
+            int d = groupOffset(f) + channel;
+            const double* filter = values + filterOffset(f, channel);
             for (int i = 0; i < filterSize; ++i) {
                 for (int j = 0; j < filterSize; ++j) {
-                    filters[f][d][i][j] = dist(gen);
+                    size_t tap = ((static_cast<size_t>(f / B) * depthBlocks + d / B) * filterSize + i) * filterSize + j;
+                    blockedFilters[(tap * B + d % B) * B + f % B] = filter[i * filterSize + j];
                 }
             }
         }
+        blockedBiases[f] = values[biasOffset() + f];
     }
+    blockedFiltersStale = false;
 }
 
-void ConvolutionalLayer::initializeBiases() {
-    biases.resize(numFilters);
-    std::generate(biases.begin(), biases.end(), std::rand);
+void ConvolutionalLayer::forwardBlocked(const BlockedTensor& unpaddedInput, BlockedTensor& output) const {
+    convolveBlocked(unpaddedInput, output, true);
 }
 
-void ConvolutionalLayer::initializeAccumulatedGradients() {
-    accumulatedFilterGradients.resize(numFilters);
-    for (int f = 0; f < numFilters; ++f) {
-        accumulatedFilterGradients[f].resize(filters[f].size());
-        for (size_t d = 0; d < filters[f].size(); ++d) {
-            accumulatedFilterGradients[f][d].resize(filterSize, std::vector<double>(filterSize, 0.0));
+void ConvolutionalLayer::convolveBlocked(const BlockedTensor& unpaddedInput, BlockedTensor& output, bool activate) const {
+    const int B = BlockedTensor::BlockSize;
+    int outputHeight = outputSize(unpaddedInput.height);
+    int outputWidth = outputSize(unpaddedInput.width);
+    output.resize(numFilters, outputHeight, outputWidth);
+
+    BlockedTensor padded;
+    if (padding > 0) {
+        unpaddedInput.copyWithHalo(padding, padded);
+    }
+    const BlockedTensor& input = padding > 0 ? padded : unpaddedInput;
+    size_t depthBlockStride = static_cast<size_t>(filterSize) * filterSize * B * B;
+    size_t blockStride = input.blocks() * depthBlockStride;
+
+    // Split by output rows of a filter block
+    size_t rowWork = static_cast<size_t>(outputWidth) * filterSize * filterSize * B * ((filterDepth + B - 1) / B * B);
+    ThreadPool::global().parallelFor(0, static_cast<size_t>(output.blocks()) * outputHeight, grainSize(rowWork), [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            int fb = static_cast<int>(row / outputHeight);
+            int y = static_cast<int>(row % outputHeight);
+            int valid = std::min(B, numFilters - fb * B);
+            // Only the input blocks holding the groups of this block's filters can contribute.
+            int firstDepthBlock = groupOffset(fb * B) / B;
+            int lastDepthBlock = (groupOffset(fb * B + valid - 1) + filterDepth - 1) / B;
+            const double* blockFilters = &blockedFilters[fb * blockStride + firstDepthBlock * depthBlockStride];
+            for (int x = 0; x < outputWidth; ++x) {
+                double sum[B];
+                for (int k = 0; k < B; ++k) {
+                    sum[k] = blockedBiases[fb * B + k];
+                }
+
+                // Every input channel value is broadcast against B filters; the k loops vectorize.
+                // Padded input channels are zero in both operands, so all B lanes can be used.
+                const double* tap = blockFilters;
+                for (int db = firstDepthBlock; db <= lastDepthBlock; ++db) {
+                    for (int i = 0; i < filterSize; ++i) {
+                        for (int j = 0; j < filterSize; ++j) {
+                            const double* pixel = input.pixel(db, y * stride + i * dilation, x * stride + j * dilation);
+                            for (int lane = 0; lane < B; ++lane, tap += B) {
+                                double value = pixel[lane];
+                                for (int k = 0; k < B; ++k) {
+                                    sum[k] += value * tap[k];
+                                }
+                            }
+                        }
+                    }
+                }
+
+                double* out = output.pixel(fb, y, x);
+                for (int k = 0; k < valid; ++k) {
+                    out[k] = activate ? activationFunction->activate(sum[k]) : sum[k];
+                }
+            }
+        }
+    });
+}
+
+std::vector<std::vector<std::vector<double>>> ConvolutionalLayer::forward(const std::vector<std::vector<std::vector<double>>>& input) {
+    return forward(input, defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> ConvolutionalLayer::backward(std::vector<std::vector<std::vector<double>>> gradient) {
+    return backward(std::move(gradient), defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> ConvolutionalLayer::forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) {
+    // backward needs the halo-padded input and takes the activation's derivative at the
+    // pre-activation, so both stay in the cache
+    convolve(input, cache, false);
+    auto activatedOutput = cache.output;
+    for (auto& channel : activatedOutput) {
+        for (auto& row : channel) {
+            for (double& value : row) {
+                value = activationFunction->activate(value);
+            }
         }
     }
-    accumulatedBiasGradients.resize(numFilters, 0.0);
+    return activatedOutput;
 }
 
-void ConvolutionalLayer::initialize(const std::vector<int>& inputShape) {
-    int inputDepth = inputShape[0];
-    initializeFilters(inputDepth);
-    initializeBiases();
-    initializeAccumulatedGradients();
+std::vector<std::vector<std::vector<double>>> ConvolutionalLayer::infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const {
+    convolve(input, workspace, true);
+    return workspace.output;
 }
 
-std::vector<std::vector<std::vector<double>>> ConvolutionalLayer::forward(const std::vector<std::vector<std::vector<double>>>& input) {
-    this->input = input;
-    int inputDepth = input.size();
-    int inputSize = input[0].size();
-    int outputSize = (inputSize - filterSize) / stride + 1;
+void ConvolutionalLayer::convolve(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace, bool activate) const {
+    // Every tap of every output pixel lands inside the halo-padded buffer, so the channel kernels
+    // needs no bounds checks.
+    std::vector<std::vector<std::vector<double>>>& paddedInput = workspace.input;
+    copyWithHalo(input, padding, paddedInput);
+    int outputHeight = outputSize(input[0].size());
+    int outputWidth = outputSize(input[0][0].size());
 
-    std::vector<std::vector<std::vector<double>>> output(numFilters, std::vector<std::vector<double>>(outputSize, std::vector<double>(outputSize)));
-    activatedOutput = std::vector<std::vector<std::vector<double>>>(numFilters, std::vector<std::vector<double>>(outputSize, std::vector<double>(outputSize)));
+    std::vector<std::vector<std::vector<double>>>& output = workspace.output;
+    if (forwardConfig.algorithm == ConvolutionConfig::Blocked && !blockedFiltersStale) {
+        BlockedTensor blockedOutput;
+        convolveBlocked(BlockedTensor::fromNested(input), blockedOutput, activate);
+        output = blockedOutput.toNested();
+        return;
+    }
 
-    for (int f = 0; f < numFilters; ++f) {
-        for (int i = 0; i < outputSize; ++i) {
-            for (int j = 0; j < outputSize; ++j) {
-                int x = i * stride;
-                int y = j * stride;
-                double sum = 0.0;
-                for (int d = 0; d < inputDepth; ++d) {
-                    sum += MatrixUtils::applyFilter(input[d], filters[f][d], x, y);
+    output.assign(numFilters, std::vector<std::vector<double>>(outputHeight, std::vector<double>(outputWidth)));
+    if (forwardConfig.algorithm == ConvolutionConfig::Im2col) {
+        forwardIm2col(paddedInput, output, activate);
+    } else {
+        forwardDirect(paddedInput, output, activate);
+    }
+}
+
+void ConvolutionalLayer::forwardDirect(const std::vector<std::vector<std::vector<double>>>& paddedInput,
+                                       std::vector<std::vector<std::vector<double>>>& outputs, bool activate) const {
+    const double* values = parameters.parameters();
+    size_t filterWork = outputs[0].size() * outputs[0][0].size() * filterDepth * filterSize * filterSize;
+    ThreadPool::global().parallelFor(0, numFilters, grainSize(filterWork), [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            auto& output = outputs[f];
+            for (auto& row : output) {
+                std::fill(row.begin(), row.end(), values[biasOffset() + f]);
+            }
+
+            int offset = groupOffset(f);
+            for (int d = 0; d < filterDepth; ++d) {
+                channelKernel(paddedInput[offset + d], values + filterOffset(f, d), filterSize, stride, dilation, output);
+            }
+
+            if (!activate) {
+                continue;
+            }
+            for (auto& row : output) {
+                for (auto& value : row) {
+                    value = activationFunction->activate(value);
                 }
-                output[f][i][j] = sum + biases[f];
-                activatedOutput[f][i][j] = activationFunction->activate(output[f][i][j]);
             }
         }
+    });
+}
+
+void ConvolutionalLayer::forwardIm2col(const std::vector<std::vector<std::vector<double>>>& paddedInput,
+                                       std::vector<std::vector<std::vector<double>>>& output, bool activate) const {
+    int outputWidth = output[0][0].size();
+    size_t pixels = output[0].size() * static_cast<size_t>(outputWidth);
+    size_t rows = static_cast<size_t>(filterDepth) * filterSize * filterSize;
+    size_t tileSize = forwardConfig.tileSize;
+    size_t tiles = (pixels + tileSize - 1) / tileSize;
+    int filtersPerGroup = numFilters / groups;
+    const double* values = parameters.parameters();
+
+    // Row r of columns holds, for every output pixel, the input value under tap r of a filter,
+    // in the [d][i][j] order of the filter's weights.
+    std::vector<double> columns(rows * pixels);
+    for (int g = 0; g < groups; ++g) {
+        ThreadPool::global().parallelFor(0, rows, grainSize(pixels), [&](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r) {
+                const auto& channel = paddedInput[g * filterDepth + r / (filterSize * filterSize)];
+                int i = static_cast<int>(r / filterSize % filterSize) * dilation;
+                int j = static_cast<int>(r % filterSize) * dilation;
+                double* column = &columns[r * pixels];
+                for (size_t p = 0; p < pixels; ++p) {
+                    column[p] = channel[p / outputWidth * stride + i][p % outputWidth * stride + j];
+                }
+            }
+        });
+
+        // Each tile of output pixels is computed for all filters of the group while its slice of
+        // every column row is still in cache.
+        ThreadPool::global().parallelFor(0, tiles, grainSize(tileSize * filtersPerGroup * rows), [&](size_t begin, size_t end) {
+            std::vector<double> sum(tileSize);
+            for (size_t tile = begin; tile < end; ++tile) {
+                size_t first = tile * tileSize;
+                size_t count = std::min(tileSize, pixels - first);
+                for (int k = 0; k < filtersPerGroup; ++k) {
+                    int f = g * filtersPerGroup + k;
+                    const double* filter = values + filterOffset(f, 0);
+                    std::fill(sum.begin(), sum.begin() + count, values[biasOffset() + f]);
+                    for (size_t r = 0; r < rows; ++r) {
+                        double weight = filter[r];
+                        const double* column = &columns[r * pixels + first];
+                        for (size_t p = 0; p < count; ++p) {
+                            sum[p] += weight * column[p];
+                        }
+                    }
+                    for (size_t p = 0; p < count; ++p) {
+                        size_t pixel = first + p;
+                        output[f][pixel / outputWidth][pixel % outputWidth] = activate ? activationFunction->activate(sum[p]) : sum[p];
+                    }
+                }
+            }
+        });
     }
+}
 
-    return activatedOutput;
+std::vector<std::vector<std::vector<double>>> ConvolutionalLayer::backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) {
+    return backpropagate(gradient, cache, parameters.gradients(), 1.0);
 }
 
-std::vector<std::vector<std::vector<double>>> ConvolutionalLayer::backward(std::vector<std::vector<std::vector<double>>> gradient) {
-    if (gradient.empty() || input.empty() || activatedOutput.empty()) {
+std::vector<std::vector<std::vector<double>>> ConvolutionalLayer::backwardAndUpdate(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache, double learningRate) {
+    // The blocked copy is rebuilt once by parametersChanged at the end of the run
+    return backpropagate(gradient, cache, parameters.parameters(), -learningRate);
+}
+
+std::vector<std::vector<std::vector<double>>> ConvolutionalLayer::backpropagate(std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                                double* target, double scale) {
+    const auto& paddedInput = cache.input;
+    const auto& preActivation = cache.output;
+    if (gradient.empty() || paddedInput.empty() || preActivation.empty()) {
         throw std::runtime_error("Invalid input: one or more vectors are empty");
     }
 
-    int inputDepth = input.size();
-    int inputSize = input[0].size();
-    int outputSize = activatedOutput[0].size();
-    std::vector<std::vector<std::vector<double>>> inputGradient(inputDepth, std::vector<std::vector<double>>(inputSize, std::vector<double>(inputSize)));
+    int inputDepth = paddedInput.size();
+    int paddedHeight = paddedInput[0].size();
+    int paddedWidth = paddedInput[0][0].size();
+    int outputHeight = preActivation[0].size();
+    int outputWidth = preActivation[0][0].size();
+    std::vector<std::vector<std::vector<double>>> paddedGradient(inputDepth, std::vector<std::vector<double>>(paddedHeight, std::vector<double>(paddedWidth, 0.0)));
+
+    size_t outputPixels = static_cast<size_t>(outputHeight) * outputWidth;
+    size_t kernelArea = static_cast<size_t>(filterSize) * filterSize;
 
     // Backpropagation through activation function
-    for (int f = 0; f < numFilters; ++f) {
-        for (int i = 0; i < outputSize; ++i) {
-            for (int j = 0; j < outputSize; ++j) {
-                gradient[f][i][j] *= activationFunction->derivative(activatedOutput[f][i][j]);
+    ThreadPool::global().parallelFor(0, numFilters, grainSize(outputPixels), [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            for (int i = 0; i < outputHeight; ++i) {
+                for (int j = 0; j < outputWidth; ++j) {
+                    gradient[f][i][j] *= activationFunction->derivative(preActivation[f][i][j]);
+                }
             }
         }
-    }
+    });
 
-    // Calculate gradients for filters and inputs
-    for (int f = 0; f < numFilters; ++f) {
-        for (int d = 0; d < inputDepth; ++d) {
-            // Calculate gradient for filters
-            auto filterGrad = MatrixUtils::convolve(input[d], gradient[f], stride);
-            for (int i = 0; i < filterSize; ++i) {
-                for (int j = 0; j < filterSize; ++j) {
-                    accumulatedFilterGradients[f][d][i][j] += filterGrad[i][j];
+    // Input gradient, split by input channels so tasks never write the same rows. Every tap
+    // scatters into the padded input gradient, mirroring forward; the halo part is dropped at the
+    // end. This runs before the filter pass below, which may modify the filters in place.
+    const double* values = parameters.parameters();
+    int filtersPerGroup = numFilters / groups;
+    ThreadPool::global().parallelFor(0, inputDepth, grainSize(filtersPerGroup * kernelArea * outputPixels), [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            int group = static_cast<int>(c) / filterDepth;
+            int d = static_cast<int>(c) - group * filterDepth;
+            auto& channelGradient = paddedGradient[c];
+            for (int f = group * filtersPerGroup; f < (group + 1) * filtersPerGroup; ++f) {
+                for (int i = 0; i < filterSize; ++i) {
+                    for (int j = 0; j < filterSize; ++j) {
+                        double weight = values[filterOffset(f, d) + i * filterSize + j];
+                        for (int y = 0; y < outputHeight; ++y) {
+                            double* gradientRow = &channelGradient[y * stride + i * dilation][j * dilation];
+                            const double* outputGradient = gradient[f][y].data();
+                            for (int x = 0; x < outputWidth; ++x) {
+                                gradientRow[x * stride] += outputGradient[x] * weight;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    // Filter and bias gradients, split by filters
+    ThreadPool::global().parallelFor(0, numFilters, grainSize(filterDepth * kernelArea * outputPixels), [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            int offset = groupOffset(f);
+            for (int d = 0; d < filterDepth; ++d) {
+                const auto& channel = paddedInput[offset + d];
+                for (int i = 0; i < filterSize; ++i) {
+                    for (int j = 0; j < filterSize; ++j) {
+                        double filterGrad = 0.0;
+                        for (int y = 0; y < outputHeight; ++y) {
+                            const double* row = &channel[y * stride + i * dilation][j * dilation];
+                            const double* outputGradient = gradient[f][y].data();
+                            for (int x = 0; x < outputWidth; ++x) {
+                                filterGrad += outputGradient[x] * row[x * stride];
+                            }
+                        }
+                        target[filterOffset(f, d) + i * filterSize + j] += scale * filterGrad;
+                    }
                 }
             }
 
-            // Calculate gradient for input
-            auto rotatedFilter = MatrixUtils::rotate180(filters[f][d]);
-            auto inputGrad = MatrixUtils::fullConvolve(rotatedFilter, gradient[f]);
-            for (int i = 0; i < inputSize; ++i) {
-                for (int j = 0; j < inputSize; ++j) {
-                    inputGradient[d][i][j] += inputGrad[i][j];
+            double biasGrad = 0.0;
+            for (int i = 0; i < outputHeight; ++i) {
+                for (int j = 0; j < outputWidth; ++j) {
+                    biasGrad += gradient[f][i][j];
                 }
             }
+            target[biasOffset() + f] += scale * biasGrad;
         }
+    });
 
-        // Calculate gradient for biases
-        for (int i = 0; i < outputSize; ++i) {
-            for (int j = 0; j < outputSize; ++j) {
-                accumulatedBiasGradients[f] += gradient[f][i][j];
-            }
+    if (padding == 0) {
+        return paddedGradient;
+    }
+    int inputHeight = paddedHeight - 2 * padding;
+    int inputWidth = paddedWidth - 2 * padding;
+    std::vector<std::vector<std::vector<double>>> inputGradient(inputDepth, std::vector<std::vector<double>>(inputHeight));
+    for (int d = 0; d < inputDepth; ++d) {
+        for (int i = 0; i < inputHeight; ++i) {
+            const auto& row = paddedGradient[d][i + padding];
+            inputGradient[d][i].assign(row.begin() + padding, row.begin() + padding + inputWidth);
         }
     }
-
     return inputGradient;
 }
 
 void ConvolutionalLayer::updateParameters(double learningRate, int miniBatchSize) {
-    for (int f = 0; f < numFilters; ++f) {
-        for (int d = 0; d < filters[f].size(); ++d) {
-            for (int i = 0; i < filterSize; ++i) {
-                for (int j = 0; j < filterSize; ++j) {
-                    filters[f][d][i][j] -= learningRate * accumulatedFilterGradients[f][d][i][j] / miniBatchSize;
-                    accumulatedFilterGradients[f][d][i][j] = 0;
-                }
-            }
-        }
-        biases[f] -= learningRate * accumulatedBiasGradients[f] / miniBatchSize;
-        accumulatedBiasGradients[f] = 0;
-    }
+    parameters.applyGradients(learningRate / miniBatchSize);
+    packBlockedFilters();
 }
 
 void ConvolutionalLayer::resetGradients() {
+    parameters.zeroGradients();
+}
+
+size_t ConvolutionalLayer::getParameterCount() const {
+    return parameters.size();
+}
+
+void ConvolutionalLayer::readParameters(double* buffer) const {
+    std::copy(parameters.parameters(), parameters.parameters() + parameters.size(), buffer);
+}
+
+void ConvolutionalLayer::writeParameters(const double* buffer) {
+    std::copy(buffer, buffer + parameters.size(), parameters.parameters());
+    packBlockedFilters();
+}
+
+void ConvolutionalLayer::readGradients(double* buffer) const {
+    std::copy(parameters.gradients(), parameters.gradients() + parameters.size(), buffer);
+}
+
+void ConvolutionalLayer::writeGradients(const double* buffer) {
+    std::copy(buffer, buffer + parameters.size(), parameters.gradients());
+}
+
+void ConvolutionalLayer::bindStorage(std::shared_ptr<ParameterStore> store, size_t offset) {
+    parameters.bind(std::move(store), offset);
+}
+
+void ConvolutionalLayer::parametersChanged() {
+    packBlockedFilters();
+}
+
+void ConvolutionalLayer::parametersChanging() {
+    blockedFiltersStale = true;
+}
+
+std::vector<int> ConvolutionalLayer::getOutputShape(const std::vector<int>& inputShape) {
+    checkInputSize(inputShape);
+    return {numFilters, outputSize(inputShape[1]), outputSize(inputShape[2])};
+}
+
+SpatialLayer::Window ConvolutionalLayer::getWindow() const {
+    return {filterSize, stride, padding, dilation};
+}
+
+std::shared_ptr<Layer> ConvolutionalLayer::clone() const {
+    return std::make_shared<ConvolutionalLayer>(*this);
+}
+
+void ConvolutionalLayer::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "ConvolutionalLayer");
+    Serialization::writeInt(stream, filterSize);
+    Serialization::writeInt(stream, numFilters);
+    Serialization::writeInt(stream, stride);
+    Serialization::writeInt(stream, padding);
+    Serialization::writeInt(stream, dilation);
+    Serialization::writeInt(stream, groups);
+    activationFunction->save(stream);
+}
+
+std::shared_ptr<ConvolutionalLayer> ConvolutionalLayer::load(std::istream& stream) {
+    int filterSize = Serialization::readInt(stream);
+    int numFilters = Serialization::readInt(stream);
+    int stride = Serialization::readInt(stream);
+    int padding = Serialization::readInt(stream);
+    int dilation = Serialization::readInt(stream);
+    int groups = Serialization::readInt(stream);
+    return std::make_shared<ConvolutionalLayer>(filterSize, numFilters, stride, padding, dilation, groups, Serialization::readActivationFunction(stream));
+}
+
+std::shared_ptr<ActivationFunction> ConvolutionalLayer::getActivationFunction() const {
+    return activationFunction;
+}
+
+void ConvolutionalLayer::foldAffine(const std::vector<double>& scale, const std::vector<double>& shift, std::shared_ptr<ActivationFunction> activation) {
+    if (scale.size() != static_cast<size_t>(numFilters) || shift.size() != static_cast<size_t>(numFilters)) {
+        throw std::invalid_argument("Expected one scale and shift per filter.");
+    }
+    double* values = parameters.parameters();
     for (int f = 0; f < numFilters; ++f) {
-        for (int d = 0; d < filters[f].size(); ++d) {
-            for (int i = 0; i < filterSize; ++i) {
-                for (int j = 0; j < filterSize; ++j) {
-                    accumulatedFilterGradients[f][d][i][j] = 0;
-                }
-            }
+        double* filter = values + filterOffset(f, 0);
+        for (size_t k = 0; k < filterOffset(1, 0); ++k) {
+            filter[k] *= scale[f];
         }
-        accumulatedBiasGradients[f] = 0;
+        values[biasOffset() + f] = values[biasOffset() + f] * scale[f] + shift[f];
     }
+    activationFunction = std::move(activation);
+    packBlockedFilters();
 }
-
-std::vector<int> ConvolutionalLayer::getOutputShape(const std::vector<int>& inputShape) {
-    int inputSize = inputShape[1];
-    int outputSize = (inputSize - filterSize) / stride + 1;
-    return {numFilters, outputSize, outputSize};
-}
\ No newline at end of file
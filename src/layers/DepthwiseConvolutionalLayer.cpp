@@ -0,0 +1,270 @@
+#include "layers/DepthwiseConvolutionalLayer.h"
+#include "utils/Serialization.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+DepthwiseConvolutionalLayer::DepthwiseConvolutionalLayer(int filterSize, int stride, std::shared_ptr<ActivationFunction> activationFunction)
+    : filterSize(filterSize), stride(stride), activationFunction(activationFunction) {
+    if (filterSize < 1 || stride < 1) {
+        throw std::invalid_argument("Filter size and stride must be positive.");
+    }
+}
+
+DepthwiseConvolutionalLayer::DepthwiseConvolutionalLayer(int filterSize, std::shared_ptr<ActivationFunction> activationFunction)
+    : DepthwiseConvolutionalLayer(filterSize, 1, activationFunction) {}
+
+DepthwiseConvolutionalLayer::DepthwiseConvolutionalLayer(int filterSize)
+    : DepthwiseConvolutionalLayer(filterSize, 1, std::make_shared<ReLU>()) {}
+
+void DepthwiseConvolutionalLayer::initialize(const std::vector<int>& inputShape) {
+    channels = inputShape[0];
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::normal_distribution<> dist(0.0, std::sqrt(2.0 / (filterSize * filterSize)));
+
+    // Biases start at zero
+    size_t filterValues = static_cast<size_t>(channels) * filterSize * filterSize;
+    parameters.resize(filterValues + channels);
+    for (size_t k = 0; k < filterValues; ++k) {
+        parameters.parameters()[k] = dist(gen);
+    }
+    packBlockedFilters();
+}
+
+void DepthwiseConvolutionalLayer::packBlockedFilters() {
+    const int B = BlockedTensor::BlockSize;
+    int blocks = (channels + B - 1) / B;
+    const double* filters = parameters.parameters();
+    const double* biases = filters + static_cast<size_t>(channels) * filterSize * filterSize;
+
+    blockedFilters.assign(static_cast<size_t>(blocks) * filterSize * filterSize * B, 0.0);
+    blockedBiases.assign(static_cast<size_t>(blocks) * B, 0.0);
+    for (int c = 0; c < channels; ++c) {
+        for (int i = 0; i < filterSize; ++i) {
+            for (int j = 0; j < filterSize; ++j) {
+                blockedFilters[((static_cast<size_t>(c / B) * filterSize + i) * filterSize + j) * B + c % B] = filters[(c * filterSize + i) * filterSize + j];
+            }
+        }
+        blockedBiases[c] = biases[c];
+    }
+}
+
+void DepthwiseConvolutionalLayer::forwardBlocked(const BlockedTensor& input, BlockedTensor& output) const {
+    const int B = BlockedTensor::BlockSize;
+    int outputHeight = (input.height - filterSize) / stride + 1;
+    int outputWidth = (input.width - filterSize) / stride + 1;
+    output.resize(input.channels, outputHeight, outputWidth);
+
+    for (int cb = 0; cb < output.blocks(); ++cb) {
+        const double* blockFilters = &blockedFilters[static_cast<size_t>(cb) * filterSize * filterSize * B];
+        int valid = std::min(B, input.channels - cb * B);
+        for (int y = 0; y < outputHeight; ++y) {
+            for (int x = 0; x < outputWidth; ++x) {
+                double sum[B];
+                for (int k = 0; k < B; ++k) {
+                    sum[k] = blockedBiases[cb * B + k];
+                }
+
+                // Channels never mix, so every tap is a lane-wise multiply-add of B channels.
+                const double* tap = blockFilters;
+                for (int i = 0; i < filterSize; ++i) {
+                    for (int j = 0; j < filterSize; ++j, tap += B) {
+                        const double* pixel = input.pixel(cb, y * stride + i, x * stride + j);
+                        for (int k = 0; k < B; ++k) {
+                            sum[k] += pixel[k] * tap[k];
+                        }
+                    }
+                }
+
+                double* out = output.pixel(cb, y, x);
+                for (int k = 0; k < valid; ++k) {
+                    out[k] = activationFunction->activate(sum[k]);
+                }
+            }
+        }
+    }
+}
+
+std::vector<std::vector<std::vector<double>>> DepthwiseConvolutionalLayer::forward(const std::vector<std::vector<std::vector<double>>>& input) {
+    return forward(input, defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> DepthwiseConvolutionalLayer::backward(std::vector<std::vector<std::vector<double>>> gradient) {
+    return backward(std::move(gradient), defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> DepthwiseConvolutionalLayer::forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) {
+    // backward takes the activation's derivative at the pre-activation, so that stays in the cache
+    cache.input = input;
+    convolve(input, cache.output);
+    auto activatedOutput = cache.output;
+    applyActivation(activatedOutput);
+    return activatedOutput;
+}
+
+std::vector<std::vector<std::vector<double>>> DepthwiseConvolutionalLayer::infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const {
+    auto& activatedOutput = workspace.output;
+    convolve(input, activatedOutput);
+    applyActivation(activatedOutput);
+    return activatedOutput;
+}
+
+void DepthwiseConvolutionalLayer::applyActivation(std::vector<std::vector<std::vector<double>>>& values) const {
+    for (auto& channel : values) {
+        for (auto& row : channel) {
+            for (double& value : row) {
+                value = activationFunction->activate(value);
+            }
+        }
+    }
+}
+
+void DepthwiseConvolutionalLayer::convolve(const std::vector<std::vector<std::vector<double>>>& input, std::vector<std::vector<std::vector<double>>>& preActivation) const {
+    int depth = input.size();
+    int outputHeight = (static_cast<int>(input[0].size()) - filterSize) / stride + 1;
+    int outputWidth = (static_cast<int>(input[0][0].size()) - filterSize) / stride + 1;
+    preActivation.assign(depth, std::vector<std::vector<double>>(outputHeight, std::vector<double>(outputWidth)));
+
+    const double* biases = parameters.parameters() + static_cast<size_t>(channels) * filterSize * filterSize;
+    for (int c = 0; c < depth; ++c) {
+        const double* filter = parameters.parameters() + static_cast<size_t>(c) * filterSize * filterSize;
+        for (int y = 0; y < outputHeight; ++y) {
+            for (int x = 0; x < outputWidth; ++x) {
+                double sum = biases[c];
+                for (int i = 0; i < filterSize; ++i) {
+                    const double* row = &input[c][y * stride + i][x * stride];
+                    for (int j = 0; j < filterSize; ++j) {
+                        sum += row[j] * filter[i * filterSize + j];
+                    }
+                }
+                preActivation[c][y][x] = sum;
+            }
+        }
+    }
+}
+
+std::vector<std::vector<std::vector<double>>> DepthwiseConvolutionalLayer::backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) {
+    return backpropagate(gradient, cache, parameters.gradients(), 1.0);
+}
+
+std::vector<std::vector<std::vector<double>>> DepthwiseConvolutionalLayer::backwardAndUpdate(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache, double learningRate) {
+    // Only forwardBlocked reads the blocked copy, and parametersChanged rebuilds it at the end of the run
+    return backpropagate(gradient, cache, parameters.parameters(), -learningRate);
+}
+
+std::vector<std::vector<std::vector<double>>> DepthwiseConvolutionalLayer::backpropagate(std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                                         double* target, double scale) {
+    const auto& input = cache.input;
+    const auto& preActivation = cache.output;
+    if (gradient.empty() || input.empty() || preActivation.empty()) {
+        throw std::runtime_error("Invalid input: one or more vectors are empty");
+    }
+
+    int depth = input.size();
+    int inputHeight = input[0].size();
+    int inputWidth = input[0][0].size();
+    int outputHeight = preActivation[0].size();
+    int outputWidth = preActivation[0][0].size();
+    std::vector<std::vector<std::vector<double>>> inputGradient(depth, std::vector<std::vector<double>>(inputHeight, std::vector<double>(inputWidth, 0.0)));
+    std::vector<double> filterGrad(filterSize * filterSize);
+    size_t filterValues = static_cast<size_t>(filterSize) * filterSize;
+
+    for (int c = 0; c < depth; ++c) {
+        const double* filter = parameters.parameters() + c * filterValues;
+        std::fill(filterGrad.begin(), filterGrad.end(), 0.0);
+        double biasGrad = 0.0;
+
+        // Every output pixel scatters its gradient back over the window it was computed from,
+        // which handles any stride without building a full convolution.
+        for (int y = 0; y < outputHeight; ++y) {
+            for (int x = 0; x < outputWidth; ++x) {
+                double g = gradient[c][y][x] * activationFunction->derivative(preActivation[c][y][x]);
+                biasGrad += g;
+                for (int i = 0; i < filterSize; ++i) {
+                    const double* inputRow = &input[c][y * stride + i][x * stride];
+                    double* inputGradientRow = &inputGradient[c][y * stride + i][x * stride];
+                    for (int j = 0; j < filterSize; ++j) {
+                        inputGradientRow[j] += g * filter[i * filterSize + j];
+                        filterGrad[i * filterSize + j] += g * inputRow[j];
+                    }
+                }
+            }
+        }
+
+        // Applied after the channel's input gradient is complete, since target may be the parameters.
+        for (size_t k = 0; k < filterValues; ++k) {
+            target[c * filterValues + k] += scale * filterGrad[k];
+        }
+        target[channels * filterValues + c] += scale * biasGrad;
+    }
+
+    return inputGradient;
+}
+
+void DepthwiseConvolutionalLayer::updateParameters(double learningRate, int miniBatchSize) {
+    parameters.applyGradients(learningRate / miniBatchSize);
+    packBlockedFilters();
+}
+
+void DepthwiseConvolutionalLayer::resetGradients() {
+    parameters.zeroGradients();
+}
+
+size_t DepthwiseConvolutionalLayer::getParameterCount() const {
+    return parameters.size();
+}
+
+void DepthwiseConvolutionalLayer::readParameters(double* buffer) const {
+    std::copy(parameters.parameters(), parameters.parameters() + parameters.size(), buffer);
+}
+
+void DepthwiseConvolutionalLayer::writeParameters(const double* buffer) {
+    std::copy(buffer, buffer + parameters.size(), parameters.parameters());
+    packBlockedFilters();
+}
+
+void DepthwiseConvolutionalLayer::readGradients(double* buffer) const {
+    std::copy(parameters.gradients(), parameters.gradients() + parameters.size(), buffer);
+}
+
+void DepthwiseConvolutionalLayer::writeGradients(const double* buffer) {
+    std::copy(buffer, buffer + parameters.size(), parameters.gradients());
+}
+
+void DepthwiseConvolutionalLayer::bindStorage(std::shared_ptr<ParameterStore> store, size_t offset) {
+    parameters.bind(std::move(store), offset);
+}
+
+void DepthwiseConvolutionalLayer::parametersChanged() {
+    packBlockedFilters();
+}
+
+std::vector<int> DepthwiseConvolutionalLayer::getOutputShape(const std::vector<int>& inputShape) {
+    int outputHeight = (inputShape[1] - filterSize) / stride + 1;
+    int outputWidth = (inputShape[2] - filterSize) / stride + 1;
+    return {inputShape[0], outputHeight, outputWidth};
+}
+
+SpatialLayer::Window DepthwiseConvolutionalLayer::getWindow() const {
+    return {filterSize, stride, 0, 1};
+}
+
+std::shared_ptr<Layer> DepthwiseConvolutionalLayer::clone() const {
+    return std::make_shared<DepthwiseConvolutionalLayer>(*this);
+}
+
+void DepthwiseConvolutionalLayer::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "DepthwiseConvolutionalLayer");
+    Serialization::writeInt(stream, filterSize);
+    Serialization::writeInt(stream, stride);
+    activationFunction->save(stream);
+}
+
+std::shared_ptr<DepthwiseConvolutionalLayer> DepthwiseConvolutionalLayer::load(std::istream& stream) {
+    int filterSize = Serialization::readInt(stream);
+    int stride = Serialization::readInt(stream);
+    return std::make_shared<DepthwiseConvolutionalLayer>(filterSize, stride, Serialization::readActivationFunction(stream));
+}
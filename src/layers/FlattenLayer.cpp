@@ -1,4 +1,5 @@
 #include "layers/FlattenLayer.h"
+#include "utils/Serialization.h"
 #include <stdexcept>
 
 FlattenLayer::FlattenLayer() : depth(0), height(0), width(0) {}
@@ -13,6 +14,11 @@ void FlattenLayer::initialize(const std::vector<int>& inputShape) {
 }
 
 std::vector<std::vector<std::vector<double>>> FlattenLayer::forward(const std::vector<std::vector<std::vector<double>>>& input) {
+    LayerCache workspace;
+    return infer(input, workspace);
+}
+
+std::vector<std::vector<std::vector<double>>> FlattenLayer::infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache&) const {
     if (input.size() != depth || input[0].size() != height || input[0][0].size() != width) {
         throw std::invalid_argument("Input dimensions do not match the initialized shape.");
     }
@@ -48,10 +54,30 @@ std::vector<std::vector<std::vector<double>>> FlattenLayer::backward(std::vector
     return reshapedGradient;
 }
 
+std::vector<std::vector<std::vector<double>>> FlattenLayer::forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) {
+    return infer(input, cache);
+}
+
+std::vector<std::vector<std::vector<double>>> FlattenLayer::backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache&) {
+    return backward(std::move(gradient));
+}
+
 std::vector<int> FlattenLayer::getOutputShape(const std::vector<int>& inputShape) {
     if (inputShape.size() != 3) {
         throw std::invalid_argument("Expected input shape with 3 dimensions (depth, height, width).");
     }
     int flatSize = inputShape[0] * inputShape[1] * inputShape[2];
     return {flatSize};
+}
+
+std::shared_ptr<Layer> FlattenLayer::clone() const {
+    return std::make_shared<FlattenLayer>(*this);
+}
+
+void FlattenLayer::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "FlattenLayer");
+}
+
+std::shared_ptr<FlattenLayer> FlattenLayer::load(std::istream&) {
+    return std::make_shared<FlattenLayer>();
 }
\ No newline at end of file
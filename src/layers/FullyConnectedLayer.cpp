@@ -1,6 +1,9 @@
 #include "layers/FullyConnectedLayer.h"
-#include "utils/MatrixUtils.h"
+#include "utils/Serialization.h"
+#include "utils/ThreadPool.h"
+#include "utils/BFloat16.h"
 #include <stdexcept>
+#include <algorithm>
 
 FullyConnectedLayer::FullyConnectedLayer(int outputSize, std::shared_ptr<ActivationFunction> activationFunction)
     : outputSize(outputSize), activationFunction(std::move(activationFunction)) {}
@@ -10,10 +13,20 @@ void FullyConnectedLayer::initialize(const std::vector<int>& inputShape) {
         throw std::invalid_argument("Expected input shape with 1 dimension (input size).");
     }
     inputSize = inputShape[0];
-    weights.resize(inputSize, std::vector<double>(outputSize));
-    biases.resize(outputSize, 0.0);
+    // Biases start at zero
+    parameters.resize(static_cast<size_t>(inputSize) * outputSize + outputSize);
     initializeWeights();
-    initializeAccumulatedGradients();
+}
+
+namespace {
+
+// Minimum multiply-adds per task, so a task outweighs the cost of scheduling it.
+const size_t minimumTaskWork = 16384;
+
+} // namespace
+
+size_t FullyConnectedLayer::grainSize(size_t workPerIndex) {
+    return std::max<size_t>(1, minimumTaskWork / std::max<size_t>(1, workPerIndex));
 }
 
 void FullyConnectedLayer::initializeWeights() {
@@ -21,94 +34,283 @@ void FullyConnectedLayer::initializeWeights() {
     std::mt19937 gen(rd());
     std::normal_distribution<> dist(0.0, std::sqrt(2.0 / inputSize));
 
-    for (int i = 0; i < inputSize; ++i) {
-        for (int j = 0; j < outputSize; ++j) {
-            weights[i][j] = dist(gen);
-        }
+    double* weights = parameters.parameters();
+    for (size_t k = 0; k < static_cast<size_t>(inputSize) * outputSize; ++k) {
+        weights[k] = dist(gen);
     }
 }
 
-void FullyConnectedLayer::initializeAccumulatedGradients() {
-    accumulatedWeightGradients.resize(inputSize, std::vector<double>(outputSize, 0.0));
-    accumulatedBiasGradients.resize(outputSize, 0.0);
+const double* FullyConnectedLayer::biases() const {
+    return parameters.parameters() + static_cast<size_t>(inputSize) * outputSize;
 }
 
 std::vector<std::vector<std::vector<double>>> FullyConnectedLayer::forward(const std::vector<std::vector<std::vector<double>>>& input) {
+    return forward(input, defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> FullyConnectedLayer::backward(std::vector<std::vector<std::vector<double>>> gradient) {
+    return backward(std::move(gradient), defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> FullyConnectedLayer::forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) {
+    // In mixed precision backward reads the bfloat16 input infer leaves in the cache
+    if (!usesCompactWeights()) {
+        cache.input = input;
+    }
+    return infer(input, cache);
+}
+
+std::vector<std::vector<std::vector<double>>> FullyConnectedLayer::infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& workspace) const {
     if (input[0][0].size() != inputSize) {
         throw std::invalid_argument("Input dimensions do not match the initialized shape.");
     }
 
-    this->input = input;
-    std::vector<double> flattenedInput = input[0][0];
-    std::vector<double> preActivation = MatrixUtils::multiply(flattenedInput, weights, biases);
-    std::vector<double> postActivation(outputSize);
+    if (usesCompactWeights()) {
+        workspace.compactInput.resize(inputSize);
+        BFloat16::fromDoubles(input[0][0].data(), workspace.compactInput.data(), inputSize);
+        std::vector<double> postActivation = compactPreActivation(workspace.compactInput);
+        for (double& value : postActivation) {
+            value = BFloat16::round(activationFunction->activate(value));
+        }
+        return { { postActivation } };
+    }
 
-    for (int i = 0; i < outputSize; ++i) {
-        postActivation[i] = activationFunction->activate(preActivation[i]);
+    std::vector<double> postActivation = fullPrecisionPreActivation(input[0][0]);
+    for (double& value : postActivation) {
+        value = activationFunction->activate(value);
     }
 
     return { { postActivation } };
 }
 
-std::vector<std::vector<std::vector<double>>> FullyConnectedLayer::backward(std::vector<std::vector<std::vector<double>>> gradient) {
-    std::vector<double> postActivationGradient = gradient[0][0];
+std::vector<std::vector<std::vector<double>>> FullyConnectedLayer::backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) {
+    if (usesCompactWeights()) {
+        return backpropagateMixed(gradient, cache, parameters.gradients(), 1.0);
+    }
+    return backpropagate(gradient, cache, parameters.gradients(), 1.0);
+}
+
+std::vector<std::vector<std::vector<double>>> FullyConnectedLayer::backwardAndUpdate(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache, double learningRate) {
+    // The compact copy is refreshed once by parametersChanged at the end of the run; refreshing it
+    // here would race with the other threads' forward passes
+    if (usesCompactWeights()) {
+        return backpropagateMixed(gradient, cache, parameters.parameters(), -learningRate);
+    }
+    return backpropagate(gradient, cache, parameters.parameters(), -learningRate);
+}
+
+std::vector<std::vector<std::vector<double>>> FullyConnectedLayer::backpropagate(const std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                                 double* target, double scale) {
+    const std::vector<double>& postActivationGradient = gradient[0][0];
     std::vector<double> preActivationGradient(outputSize);
 
-    std::vector<double> flattenedInput = input[0][0];
-    std::vector<double> preActivation = MatrixUtils::multiply(flattenedInput, weights, biases);
+    const std::vector<double>& flattenedInput = cache.input[0][0];
+    std::vector<double> outputPreActivation = fullPrecisionPreActivation(flattenedInput);
 
     for (int i = 0; i < outputSize; ++i) {
-        preActivationGradient[i] = postActivationGradient[i] * activationFunction->derivative(preActivation[i]);
+        preActivationGradient[i] = postActivationGradient[i] * activationFunction->derivative(outputPreActivation[i]);
     }
 
+    // The input gradient reads a weight before its target is written, so the result is the
+    // same whether target is the gradient accumulator or the parameters themselves.
+    // Rows of the weight matrix are independent, so they are split across the thread pool.
+    const double* weights = parameters.parameters();
     std::vector<double> inputGradient(inputSize);
-    std::vector<std::vector<double>> weightGradient(inputSize, std::vector<double>(outputSize));
-    std::vector<double> biasGradient(outputSize);
+    ThreadPool::global().parallelFor(0, inputSize, grainSize(outputSize), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const double* row = weights + i * outputSize;
+            double* targetRow = target + i * outputSize;
+            double sum = 0.0;
+            for (int j = 0; j < outputSize; ++j) {
+                sum += preActivationGradient[j] * row[j];
+                targetRow[j] += scale * preActivationGradient[j] * flattenedInput[i];
+            }
+            inputGradient[i] = sum;
+        }
+    });
+    double* biasTarget = target + static_cast<size_t>(inputSize) * outputSize;
+    for (int j = 0; j < outputSize; ++j) {
+        biasTarget[j] += scale * preActivationGradient[j];
+    }
+
+    return { { inputGradient } };
+}
+
+std::vector<std::vector<std::vector<double>>> FullyConnectedLayer::backpropagateMixed(const std::vector<std::vector<std::vector<double>>>& gradient, const LayerCache& cache,
+                                                                                      double* target, double scale) {
+    const std::vector<double>& postActivationGradient = gradient[0][0];
+    std::vector<double> preActivation = compactPreActivation(cache.compactInput);
+    std::vector<float> preActivationGradient(outputSize);
+    for (int j = 0; j < outputSize; ++j) {
+        preActivationGradient[j] = static_cast<float>(postActivationGradient[j] * activationFunction->derivative(preActivation[j]));
+    }
 
+    // Input gradient from the bf16 weights, accumulated in float32 row by row of the transposed copy
+    std::vector<float> inputGradientSum(inputSize, 0.0f);
     for (int j = 0; j < outputSize; ++j) {
+        const uint16_t* row = &compactWeights[static_cast<size_t>(j) * inputSize];
+        float g = preActivationGradient[j];
         for (int i = 0; i < inputSize; ++i) {
-            inputGradient[i] += preActivationGradient[j] * weights[i][j];
-            weightGradient[i][j] += preActivationGradient[j] * flattenedInput[i];
+            inputGradientSum[i] += g * BFloat16::toFloat(row[i]);
         }
-        biasGradient[j] += preActivationGradient[j];
     }
 
+    // Parameter gradients go to the full-precision master copy
     for (int i = 0; i < inputSize; ++i) {
+        double x = BFloat16::toFloat(cache.compactInput[i]);
+        double* targetRow = target + static_cast<size_t>(i) * outputSize;
         for (int j = 0; j < outputSize; ++j) {
-            accumulatedWeightGradients[i][j] += weightGradient[i][j];
+            targetRow[j] += scale * preActivationGradient[j] * x;
         }
     }
+    double* biasTarget = target + static_cast<size_t>(inputSize) * outputSize;
     for (int j = 0; j < outputSize; ++j) {
-        accumulatedBiasGradients[j] += biasGradient[j];
+        biasTarget[j] += scale * preActivationGradient[j];
     }
 
+    std::vector<double> inputGradient(inputSize);
+    for (int i = 0; i < inputSize; ++i) {
+        inputGradient[i] = BFloat16::round(inputGradientSum[i]);
+    }
     return { { inputGradient } };
 }
 
-void FullyConnectedLayer::updateParameters(double learningRate, int miniBatchSize) {
+void FullyConnectedLayer::setMixedPrecision(bool enabled) {
+    mixedPrecision = enabled;
+    if (mixedPrecision) {
+        refreshCompactWeights();
+    } else {
+        compactWeights.clear();
+    }
+}
+
+bool FullyConnectedLayer::usesCompactWeights() const {
+    return mixedPrecision && !compactWeightsStale;
+}
+
+void FullyConnectedLayer::refreshCompactWeights() {
+    compactWeights.resize(static_cast<size_t>(inputSize) * outputSize);
+    const double* weights = parameters.parameters();
     for (int i = 0; i < inputSize; ++i) {
         for (int j = 0; j < outputSize; ++j) {
-            weights[i][j] -= learningRate * accumulatedWeightGradients[i][j] / miniBatchSize;
-            accumulatedWeightGradients[i][j] = 0;
+            compactWeights[static_cast<size_t>(j) * inputSize + i] = BFloat16::fromFloat(static_cast<float>(weights[static_cast<size_t>(i) * outputSize + j]));
         }
     }
-    for (int j = 0; j < outputSize; ++j) {
-        biases[j] -= learningRate * accumulatedBiasGradients[j] / miniBatchSize;
-        accumulatedBiasGradients[j] = 0;
-    }
+}
+
+std::vector<double> FullyConnectedLayer::compactPreActivation(const std::vector<uint16_t>& compactInput) const {
+    std::vector<double> preActivation(outputSize);
+    const double* bias = biases();
+    ThreadPool::global().parallelFor(0, outputSize, grainSize(inputSize), [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j) {
+            preActivation[j] = bias[j] + BFloat16::dot(&compactWeights[j * inputSize], compactInput.data(), inputSize);
+        }
+    });
+    return preActivation;
+}
+
+std::vector<double> FullyConnectedLayer::fullPrecisionPreActivation(const std::vector<double>& input) const {
+    // Each task owns a range of output neurons and walks the weight rows over that range, so the
+    // inner loop reads contiguous weights.
+    std::vector<double> output(biases(), biases() + outputSize);
+    const double* weights = parameters.parameters();
+    ThreadPool::global().parallelFor(0, outputSize, grainSize(inputSize), [&](size_t begin, size_t end) {
+        double* out = output.data();
+        for (int i = 0; i < inputSize; ++i) {
+            double x = input[i];
+            const double* row = weights + static_cast<size_t>(i) * outputSize;
+            for (size_t j = begin; j < end; ++j) {
+                out[j] += x * row[j];
+            }
+        }
+    });
+    return output;
+}
+
+void FullyConnectedLayer::updateParameters(double learningRate, int miniBatchSize) {
+    parameters.applyGradients(learningRate / miniBatchSize);
+    parametersChanged();
 }
 
 void FullyConnectedLayer::resetGradients() {
-    for (int i = 0; i < inputSize; ++i) {
+    parameters.zeroGradients();
+}
+
+size_t FullyConnectedLayer::getParameterCount() const {
+    return parameters.size();
+}
+
+void FullyConnectedLayer::readParameters(double* buffer) const {
+    std::copy(parameters.parameters(), parameters.parameters() + parameters.size(), buffer);
+}
+
+void FullyConnectedLayer::writeParameters(const double* buffer) {
+    std::copy(buffer, buffer + parameters.size(), parameters.parameters());
+    parametersChanged();
+}
+
+void FullyConnectedLayer::readGradients(double* buffer) const {
+    std::copy(parameters.gradients(), parameters.gradients() + parameters.size(), buffer);
+}
+
+void FullyConnectedLayer::writeGradients(const double* buffer) {
+    std::copy(buffer, buffer + parameters.size(), parameters.gradients());
+}
+
+void FullyConnectedLayer::bindStorage(std::shared_ptr<ParameterStore> store, size_t offset) {
+    parameters.bind(std::move(store), offset);
+}
+
+void FullyConnectedLayer::parametersChanged() {
+    compactWeightsStale = false;
+    if (mixedPrecision) {
+        refreshCompactWeights();
+    }
+}
+
+void FullyConnectedLayer::parametersChanging() {
+    compactWeightsStale = true;
+}
+
+std::vector<int> FullyConnectedLayer::getOutputShape(const std::vector<int>& inputShape) {
+    return { outputSize };
+}
+
+std::shared_ptr<Layer> FullyConnectedLayer::clone() const {
+    return std::make_shared<FullyConnectedLayer>(*this);
+}
+
+void FullyConnectedLayer::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "FullyConnectedLayer");
+    Serialization::writeInt(stream, outputSize);
+    activationFunction->save(stream);
+}
+
+std::shared_ptr<FullyConnectedLayer> FullyConnectedLayer::load(std::istream& stream) {
+    int outputSize = Serialization::readInt(stream);
+    return std::make_shared<FullyConnectedLayer>(outputSize, Serialization::readActivationFunction(stream));
+}
+
+std::shared_ptr<ActivationFunction> FullyConnectedLayer::getActivationFunction() const {
+    return activationFunction;
+}
+
+void FullyConnectedLayer::foldAffine(const std::vector<double>& scale, const std::vector<double>& shift, std::shared_ptr<ActivationFunction> activation) {
+    if (scale.size() != static_cast<size_t>(outputSize) || shift.size() != static_cast<size_t>(outputSize)) {
+        throw std::invalid_argument("Expected one scale and shift per output.");
+    }
+    double* values = parameters.parameters();
+    for (int i = 0; i <= inputSize; ++i) {
+        // The row after the last weight row is the biases
+        double* row = values + static_cast<size_t>(i) * outputSize;
         for (int j = 0; j < outputSize; ++j) {
-            accumulatedWeightGradients[i][j] = 0;
+            row[j] *= scale[j];
         }
     }
+    double* bias = values + static_cast<size_t>(inputSize) * outputSize;
     for (int j = 0; j < outputSize; ++j) {
-        accumulatedBiasGradients[j] = 0;
+        bias[j] += shift[j];
     }
+    activationFunction = std::move(activation);
+    parametersChanged();
 }
-
-std::vector<int> FullyConnectedLayer::getOutputShape(const std::vector<int>& inputShape) {
-    return { outputSize };
-}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "layers/MaxPoolingLayer.h"
+#include "utils/Serialization.h"
+#include <algorithm>
+#include <stdexcept>
+
+MaxPoolingLayer::MaxPoolingLayer(int poolSize) : poolSize(poolSize) {
+    if (poolSize < 1) {
+        throw std::invalid_argument("Pool size must be positive.");
+    }
+}
+
+std::vector<std::vector<std::vector<double>>> MaxPoolingLayer::forward(const std::vector<std::vector<std::vector<double>>>& input) {
+    return forward(input, defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> MaxPoolingLayer::backward(std::vector<std::vector<std::vector<double>>> gradient) {
+    return backward(std::move(gradient), defaultCache);
+}
+
+std::vector<std::vector<std::vector<double>>> MaxPoolingLayer::forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache& cache) {
+    cache.input = input;
+    return infer(input, cache);
+}
+
+std::vector<std::vector<std::vector<double>>> MaxPoolingLayer::infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache&) const {
+    int depth = input.size();
+    int outputHeight = input[0].size() / poolSize;
+    int outputWidth = input[0][0].size() / poolSize;
+    std::vector<std::vector<std::vector<double>>> output(depth, std::vector<std::vector<double>>(outputHeight, std::vector<double>(outputWidth)));
+
+    for (int d = 0; d < depth; ++d) {
+        for (int i = 0; i < outputHeight; ++i) {
+            for (int j = 0; j < outputWidth; ++j) {
+                double maxVal = input[d][i * poolSize][j * poolSize];
+                for (int k = 0; k < poolSize; ++k) {
+                    for (int l = 0; l < poolSize; ++l) {
+                        maxVal = std::max(maxVal, input[d][i * poolSize + k][j * poolSize + l]);
+                    }
+                }
+                output[d][i][j] = maxVal;
+            }
+        }
+    }
+    return output;
+}
+
+std::vector<std::vector<std::vector<double>>> MaxPoolingLayer::backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache& cache) {
+    const auto& input = cache.input;
+    if (input.empty()) {
+        throw std::runtime_error("Invalid input: one or more vectors are empty");
+    }
+    int depth = input.size();
+    std::vector<std::vector<std::vector<double>>> inputGradient(depth, std::vector<std::vector<double>>(input[0].size(), std::vector<double>(input[0][0].size(), 0.0)));
+
+    // Route each output gradient to the first maximum of its window
+    for (int d = 0; d < depth; ++d) {
+        for (size_t i = 0; i < gradient[d].size(); ++i) {
+            for (size_t j = 0; j < gradient[d][i].size(); ++j) {
+                int maxK = 0;
+                int maxL = 0;
+                for (int k = 0; k < poolSize; ++k) {
+                    for (int l = 0; l < poolSize; ++l) {
+                        if (input[d][i * poolSize + k][j * poolSize + l] > input[d][i * poolSize + maxK][j * poolSize + maxL]) {
+                            maxK = k;
+                            maxL = l;
+                        }
+                    }
+                }
+                inputGradient[d][i * poolSize + maxK][j * poolSize + maxL] += gradient[d][i][j];
+            }
+        }
+    }
+    return inputGradient;
+}
+
+void MaxPoolingLayer::forwardBlocked(const BlockedTensor& input, BlockedTensor& output) const {
+    const int B = BlockedTensor::BlockSize;
+    output.resize(input.channels, input.height / poolSize, input.width / poolSize);
+
+    for (int block = 0; block < input.blocks(); ++block) {
+        for (int y = 0; y < output.height; ++y) {
+            for (int x = 0; x < output.width; ++x) {
+                double* out = output.pixel(block, y, x);
+                const double* first = input.pixel(block, y * poolSize, x * poolSize);
+                std::copy(first, first + B, out);
+                for (int k = 0; k < poolSize; ++k) {
+                    for (int l = 0; l < poolSize; ++l) {
+                        const double* pixel = input.pixel(block, y * poolSize + k, x * poolSize + l);
+                        for (int lane = 0; lane < B; ++lane) {
+                            out[lane] = std::max(out[lane], pixel[lane]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+std::vector<int> MaxPoolingLayer::getOutputShape(const std::vector<int>& inputShape) {
+    if (inputShape.size() != 3) {
+        throw std::invalid_argument("Expected input shape with 3 dimensions (depth, height, width).");
+    }
+    return { inputShape[0], inputShape[1] / poolSize, inputShape[2] / poolSize };
+}
+
+SpatialLayer::Window MaxPoolingLayer::getWindow() const {
+    return {poolSize, poolSize, 0, 1};
+}
+
+std::shared_ptr<Layer> MaxPoolingLayer::clone() const {
+    return std::make_shared<MaxPoolingLayer>(*this);
+}
+
+void MaxPoolingLayer::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "MaxPoolingLayer");
+    Serialization::writeInt(stream, poolSize);
+}
+
+std::shared_ptr<MaxPoolingLayer> MaxPoolingLayer::load(std::istream& stream) {
+    return std::make_shared<MaxPoolingLayer>(Serialization::readInt(stream));
+}
@@ -1,15 +1,22 @@
 #include "layers/SoftmaxLayer.h"
+#include "utils/Serialization.h"
 #include <cmath>
 #include <algorithm>
 
 std::vector<std::vector<std::vector<double>>> SoftmaxLayer::forward(const std::vector<std::vector<std::vector<double>>>& input) {
-    this->input = input;
-    std::vector<double> flattenedInput = input[0][0];
-    std::vector<double> softmaxOutput = softmax(flattenedInput);
+    std::vector<double> softmaxOutput = softmax(input[0][0]);
     return { { softmaxOutput } };
 }
 
-std::vector<double> SoftmaxLayer::softmax(const std::vector<double>& input) {
+std::vector<std::vector<std::vector<double>>> SoftmaxLayer::forward(const std::vector<std::vector<std::vector<double>>>& input, LayerCache&) {
+    return forward(input);
+}
+
+std::vector<std::vector<std::vector<double>>> SoftmaxLayer::infer(const std::vector<std::vector<std::vector<double>>>& input, LayerCache&) const {
+    return { { softmax(input[0][0]) } };
+}
+
+std::vector<double> SoftmaxLayer::softmax(const std::vector<double>& input) const {
     std::vector<double> output(input.size());
     double max = *std::max_element(input.begin(), input.end());
 
@@ -30,6 +37,22 @@ std::vector<std::vector<std::vector<double>>> SoftmaxLayer::backward(std::vector
     return gradient;  // Normally you'd compute the gradient for softmax here
 }
 
+std::vector<std::vector<std::vector<double>>> SoftmaxLayer::backward(std::vector<std::vector<std::vector<double>>> gradient, LayerCache&) {
+    return gradient;
+}
+
 std::vector<int> SoftmaxLayer::getOutputShape(const std::vector<int>& inputShape) {
     return { inputShape[0] };
+}
+
+std::shared_ptr<Layer> SoftmaxLayer::clone() const {
+    return std::make_shared<SoftmaxLayer>(*this);
+}
+
+void SoftmaxLayer::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "SoftmaxLayer");
+}
+
+std::shared_ptr<SoftmaxLayer> SoftmaxLayer::load(std::istream&) {
+    return std::make_shared<SoftmaxLayer>();
 }
\ No newline at end of file
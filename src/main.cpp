@@ -38,7 +38,8 @@ int main() {
     std::string testLabelsFile = "../data/t10k-labels.idx1-ubyte";
     auto testDataset = MNISTReader::readMNISTData(testImagesFile, testLabelsFile);
 
-    cnn.SGD(trainDataset, 30, 32, testDataset);
+    cnn.setOverlappedEvaluation(true);
+    cnn.SGD(trainDataset, 30, 32, testDataset, "mnist_model.bin");
 
     auto input = testDataset[2].getImageData();
     auto output = cnn.forward(input);
@@ -0,0 +1,69 @@
+#include "serving/InferenceClient.h"
+#include "serving/Protocol.h"
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+InferenceClient::InferenceClient(const std::string& socketPath) {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path is too long: " + socketPath);
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) close(fd);
+        throw std::runtime_error("Failed to connect to " + socketPath);
+    }
+}
+
+InferenceClient::~InferenceClient() {
+    close(fd);
+}
+
+std::vector<double> InferenceClient::infer(const std::vector<double>& input) {
+    auto payload = call(Protocol::Infer, input.data(), static_cast<unsigned>(input.size()), input.size() * sizeof(double));
+    std::vector<double> output(payload.size() / sizeof(double));
+    std::memcpy(output.data(), payload.data(), output.size() * sizeof(double));
+    return output;
+}
+
+std::vector<int> InferenceClient::getInputShape() {
+    auto payload = call(Protocol::Shape, nullptr, 0, 0);
+    std::vector<int32_t> dims(payload.size() / sizeof(int32_t));
+    std::memcpy(dims.data(), payload.data(), dims.size() * sizeof(int32_t));
+    return std::vector<int>(dims.begin(), dims.end());
+}
+
+std::string InferenceClient::getStats() {
+    auto payload = call(Protocol::Stats, nullptr, 0, 0);
+    return std::string(payload.begin(), payload.end());
+}
+
+std::vector<char> InferenceClient::call(unsigned type, const void* payload, unsigned count, size_t payloadBytes) {
+    Protocol::RequestHeader header{ type, count };
+    if (!Protocol::writeFully(fd, &header, sizeof(header)) || !Protocol::writeFully(fd, payload, payloadBytes)) {
+        throw std::runtime_error("Lost connection to the inference server.");
+    }
+
+    Protocol::ResponseHeader response;
+    if (!Protocol::readFully(fd, &response, sizeof(response))) {
+        throw std::runtime_error("Lost connection to the inference server.");
+    }
+    size_t elementSize = 1;
+    if (response.status == Protocol::Ok && type == Protocol::Infer) elementSize = sizeof(double);
+    if (response.status == Protocol::Ok && type == Protocol::Shape) elementSize = sizeof(int32_t);
+
+    std::vector<char> body(response.count * elementSize);
+    if (!Protocol::readFully(fd, body.data(), body.size())) {
+        throw std::runtime_error("Lost connection to the inference server.");
+    }
+    if (response.status != Protocol::Ok) {
+        throw std::runtime_error("Inference server error: " + std::string(body.begin(), body.end()));
+    }
+    return body;
+}
@@ -0,0 +1,255 @@
+#include "serving/InferenceServer.h"
+#include "serving/Protocol.h"
+#include "utils/MatrixUtils.h"
+#include <cstring>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+InferenceServer::InferenceServer(const CNN& model, const InferenceServerConfig& config)
+    : model(model), config(config), stats(config.maxBatchSize), inputShape(model.getInputShape()), stopping(false), listenSocket(-1) {
+    if (inputShape.size() != 3) {
+        throw std::invalid_argument("The served model must take a (depth, height, width) input.");
+    }
+    if (config.maxBatchSize < 1 || config.numWorkers < 1) {
+        throw std::invalid_argument("maxBatchSize and numWorkers must be positive.");
+    }
+    inputSize = std::accumulate(inputShape.begin(), inputShape.end(), size_t(1), std::multiplies<size_t>());
+
+    batcher = std::thread(&InferenceServer::batchLoop, this);
+    for (int i = 0; i < config.numWorkers; ++i) {
+        workers.emplace_back(&InferenceServer::workerLoop, this);
+    }
+}
+
+InferenceServer::~InferenceServer() {
+    stop();
+    batcher.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void InferenceServer::run(const std::string& socketPath) {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path is too long: " + socketPath);
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    unlink(socketPath.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 128) != 0) {
+        if (fd >= 0) close(fd);
+        throw std::runtime_error("Failed to listen on " + socketPath);
+    }
+    {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        listenSocket = fd;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+
+    std::map<std::thread::id, std::thread> connectionThreads;
+    while (true) {
+        int client = accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) break;
+            continue;
+        }
+        // Join the connections that closed since the last accept, so a long-running server does
+        // not keep their threads
+        std::vector<std::thread::id> finished;
+        {
+            std::lock_guard<std::mutex> lock(connectionMutex);
+            std::swap(finished, finishedConnections);
+            connections.insert(client);
+        }
+        for (const auto& id : finished) {
+            connectionThreads[id].join();
+            connectionThreads.erase(id);
+        }
+        std::thread thread(&InferenceServer::serveConnection, this, client);
+        auto id = thread.get_id();
+        connectionThreads.emplace(id, std::move(thread));
+    }
+
+    for (auto& connection : connectionThreads) {
+        connection.second.join();
+    }
+    finishedConnections.clear();
+    close(fd);
+    unlink(socketPath.c_str());
+}
+
+void InferenceServer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    pendingCondition.notify_all();
+    batchCondition.notify_all();
+
+    // Wake the accept loop and every connection blocked in read
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    if (listenSocket >= 0) {
+        shutdown(listenSocket, SHUT_RDWR);
+    }
+    for (int fd : connections) {
+        shutdown(fd, SHUT_RDWR);
+    }
+}
+
+const ServerStats& InferenceServer::getStats() const {
+    return stats;
+}
+
+std::future<std::vector<std::vector<std::vector<double>>>> InferenceServer::submit(std::vector<std::vector<std::vector<double>>> input) {
+    auto request = std::make_unique<Request>();
+    request->input = std::move(input);
+    auto future = request->result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            throw std::runtime_error("Server is shutting down.");
+        }
+        pending.emplace_back(std::move(request), std::chrono::steady_clock::now());
+    }
+    pendingCondition.notify_all();
+    return future;
+}
+
+void InferenceServer::batchLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        pendingCondition.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            // Stopping with nothing left to batch: let idle workers exit
+            batchCondition.notify_all();
+            return;
+        }
+
+        // Hold the batch open until it is full or the oldest request has waited maxWait
+        auto deadline = pending.front().second + config.maxWait;
+        pendingCondition.wait_until(lock, deadline, [this] {
+            return stopping || pending.size() >= static_cast<size_t>(config.maxBatchSize);
+        });
+
+        Batch batch;
+        while (!pending.empty() && batch.size() < static_cast<size_t>(config.maxBatchSize)) {
+            batch.push_back(std::move(pending.front().first));
+            pending.pop_front();
+        }
+        batches.push_back(std::move(batch));
+        batchCondition.notify_one();
+    }
+}
+
+void InferenceServer::workerLoop() {
+    CNN::InferenceWorkspace workspace;
+    while (true) {
+        Batch batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            batchCondition.wait(lock, [this] { return !batches.empty() || (stopping && pending.empty()); });
+            if (batches.empty()) {
+                return;
+            }
+            batch = std::move(batches.front());
+            batches.pop_front();
+        }
+
+        std::vector<std::vector<std::vector<std::vector<double>>>> inputs;
+        inputs.reserve(batch.size());
+        for (auto& request : batch) {
+            inputs.push_back(std::move(request->input));
+        }
+
+        try {
+            auto outputs = model.forwardBatch(inputs, workspace);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i]->result.set_value(std::move(outputs[i]));
+            }
+        } catch (...) {
+            for (auto& request : batch) {
+                request->result.set_exception(std::current_exception());
+            }
+        }
+        stats.recordBatch(static_cast<int>(batch.size()));
+    }
+}
+
+void InferenceServer::serveConnection(int fd) {
+    while (handleRequest(fd)) {
+    }
+    // Closed under the lock, so that stop never shuts down a reused descriptor
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    connections.erase(fd);
+    close(fd);
+    finishedConnections.push_back(std::this_thread::get_id());
+}
+
+bool InferenceServer::handleRequest(int fd) {
+    Protocol::RequestHeader header;
+    if (!Protocol::readFully(fd, &header, sizeof(header))) {
+        return false;
+    }
+
+    auto respondText = [fd](Protocol::Status status, const std::string& text) {
+        Protocol::ResponseHeader response{ status, static_cast<uint32_t>(text.size()) };
+        return Protocol::writeFully(fd, &response, sizeof(response)) && Protocol::writeFully(fd, text.data(), text.size());
+    };
+
+    switch (header.type) {
+    case Protocol::Infer: {
+        if (header.count != inputSize) {
+            // The payload is not consumed, so the connection cannot continue
+            respondText(Protocol::Error, "Expected " + std::to_string(inputSize) + " input values.");
+            return false;
+        }
+        std::vector<double> values(header.count);
+        if (!Protocol::readFully(fd, values.data(), values.size() * sizeof(double))) {
+            return false;
+        }
+
+        auto arrival = std::chrono::steady_clock::now();
+        std::vector<double> flatOutput;
+        try {
+            auto future = submit(MatrixUtils::unflatten(values, inputShape[0], inputShape[1], inputShape[2]));
+            for (const auto& channel : future.get()) {
+                for (const auto& row : channel) {
+                    flatOutput.insert(flatOutput.end(), row.begin(), row.end());
+                }
+            }
+        } catch (const std::exception& e) {
+            return respondText(Protocol::Error, e.what());
+        }
+        stats.recordLatency(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - arrival).count());
+
+        Protocol::ResponseHeader response{ Protocol::Ok, static_cast<uint32_t>(flatOutput.size()) };
+        return Protocol::writeFully(fd, &response, sizeof(response)) &&
+               Protocol::writeFully(fd, flatOutput.data(), flatOutput.size() * sizeof(double));
+    }
+    case Protocol::Stats:
+        return respondText(Protocol::Ok, stats.report());
+    case Protocol::Shape: {
+        std::vector<int32_t> dims(inputShape.begin(), inputShape.end());
+        Protocol::ResponseHeader response{ Protocol::Ok, static_cast<uint32_t>(dims.size()) };
+        return Protocol::writeFully(fd, &response, sizeof(response)) &&
+               Protocol::writeFully(fd, dims.data(), dims.size() * sizeof(int32_t));
+    }
+    default:
+        respondText(Protocol::Error, "Unknown message type.");
+        return false;
+    }
+}
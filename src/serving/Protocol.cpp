@@ -0,0 +1,28 @@
+#include "serving/Protocol.h"
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+bool Protocol::readFully(int fd, void* data, size_t size) {
+    char* destination = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t count = read(fd, destination, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        destination += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool Protocol::writeFully(int fd, const void* data, size_t size) {
+    const char* source = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t count = send(fd, source, size, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        source += count;
+        size -= count;
+    }
+    return true;
+}
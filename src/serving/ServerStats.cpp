@@ -0,0 +1,54 @@
+#include "serving/ServerStats.h"
+#include <algorithm>
+#include <sstream>
+
+ServerStats::ServerStats(int maxBatchSize, size_t latencyWindow)
+    : latencyWindow(latencyWindow), batchSizeCounts(maxBatchSize + 1, 0), totalRequests(0) {}
+
+void ServerStats::recordBatch(int batchSize) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++batchSizeCounts[std::min<size_t>(batchSize, batchSizeCounts.size() - 1)];
+}
+
+void ServerStats::recordLatency(double microseconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++totalRequests;
+    latencies.push_back(microseconds);
+    if (latencies.size() > latencyWindow) {
+        latencies.pop_front();
+    }
+}
+
+std::string ServerStats::report() const {
+    std::vector<double> sorted;
+    std::vector<uint64_t> batches;
+    uint64_t requests = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sorted.assign(latencies.begin(), latencies.end());
+        batches = batchSizeCounts;
+        requests = totalRequests;
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    std::ostringstream out;
+    out << "Requests: " << requests << "\n";
+    if (!sorted.empty()) {
+        out << "Latency (us):";
+        for (double percentile : {50.0, 90.0, 99.0, 99.9}) {
+            size_t index = std::min(sorted.size() - 1, static_cast<size_t>(percentile / 100.0 * sorted.size()));
+            out << " p" << percentile << "=" << sorted[index];
+        }
+        out << "\n";
+    }
+
+    uint64_t totalBatches = 0;
+    for (uint64_t count : batches) totalBatches += count;
+    out << "Batch sizes (" << totalBatches << " batches):\n";
+    for (size_t size = 1; size < batches.size(); ++size) {
+        if (batches[size] > 0) {
+            out << "  " << size << ": " << batches[size] << "\n";
+        }
+    }
+    return out.str();
+}
@@ -0,0 +1,61 @@
+#include "utils/BFloat16.h"
+#include <cstring>
+#if defined(__AVX512BF16__)
+#include <immintrin.h>
+#endif
+
+uint16_t BFloat16::fromFloat(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000) {
+        return static_cast<uint16_t>((bits >> 16) | 0x0040); // quiet NaN
+    }
+    uint32_t roundingBias = 0x7fff + ((bits >> 16) & 1);
+    return static_cast<uint16_t>((bits + roundingBias) >> 16);
+}
+
+float BFloat16::toFloat(uint16_t value) {
+    uint32_t bits = static_cast<uint32_t>(value) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+void BFloat16::fromDoubles(const double* input, uint16_t* output, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        output[i] = fromFloat(static_cast<float>(input[i]));
+    }
+}
+
+double BFloat16::round(double value) {
+    return toFloat(fromFloat(static_cast<float>(value)));
+}
+
+float BFloat16::dot(const uint16_t* a, const uint16_t* b, size_t count) {
+    size_t i = 0;
+    float sum = 0.0f;
+#if defined(__AVX512BF16__)
+    __m512 accumulator = _mm512_setzero_ps();
+    for (; i + 32 <= count; i += 32) {
+        __m512bh va = (__m512bh)_mm512_loadu_si512(a + i);
+        __m512bh vb = (__m512bh)_mm512_loadu_si512(b + i);
+        accumulator = _mm512_dpbf16_ps(accumulator, va, vb);
+    }
+    sum = _mm512_reduce_add_ps(accumulator);
+#else
+    // Independent partial sums so the compiler can vectorize the conversion and multiply-add
+    float partial[8] = {};
+    for (; i + 8 <= count; i += 8) {
+        for (size_t k = 0; k < 8; ++k) {
+            partial[k] += toFloat(a[i + k]) * toFloat(b[i + k]);
+        }
+    }
+    for (float value : partial) {
+        sum += value;
+    }
+#endif
+    for (; i < count; ++i) {
+        sum += toFloat(a[i]) * toFloat(b[i]);
+    }
+    return sum;
+}
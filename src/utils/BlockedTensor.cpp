@@ -0,0 +1,44 @@
+#include "utils/BlockedTensor.h"
+#include <algorithm>
+
+void BlockedTensor::resize(int channels, int height, int width) {
+    this->channels = channels;
+    this->height = height;
+    this->width = width;
+    data.assign(static_cast<size_t>(blocks()) * height * width * BlockSize, 0.0);
+}
+
+BlockedTensor BlockedTensor::fromNested(const std::vector<std::vector<std::vector<double>>>& input) {
+    BlockedTensor tensor;
+    tensor.resize(static_cast<int>(input.size()), static_cast<int>(input[0].size()), static_cast<int>(input[0][0].size()));
+    for (int c = 0; c < tensor.channels; ++c) {
+        for (int y = 0; y < tensor.height; ++y) {
+            for (int x = 0; x < tensor.width; ++x) {
+                tensor.pixel(c / BlockSize, y, x)[c % BlockSize] = input[c][y][x];
+            }
+        }
+    }
+    return tensor;
+}
+
+std::vector<std::vector<std::vector<double>>> BlockedTensor::toNested() const {
+    std::vector<std::vector<std::vector<double>>> output(channels, std::vector<std::vector<double>>(height, std::vector<double>(width)));
+    for (int c = 0; c < channels; ++c) {
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                output[c][y][x] = pixel(c / BlockSize, y, x)[c % BlockSize];
+            }
+        }
+    }
+    return output;
+}
+
+void BlockedTensor::copyWithHalo(int padding, BlockedTensor& padded) const {
+    padded.resize(channels, height + 2 * padding, width + 2 * padding);
+    for (int block = 0; block < blocks(); ++block) {
+        for (int y = 0; y < height; ++y) {
+            const double* row = pixel(block, y, 0);
+            std::copy(row, row + static_cast<size_t>(width) * BlockSize, padded.pixel(block, y + padding, padding));
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#include "utils/ConvolutionKernels.h"
+#include <cstddef>
+#include <utility>
+
+namespace {
+
+// Sum over all K x K taps for the output pixel at column x, expanded at compile time so
+// every tap is a separate multiply-add with constant offsets.
+template <int K, int S, size_t... Taps>
+inline double sumTaps(const double* taps, const double* const* rows, int x, std::index_sequence<Taps...>) {
+    return ((taps[Taps] * rows[Taps / K][x * S + static_cast<int>(Taps % K)]) + ...);
+}
+
+template <int K, int S>
+void specialized(const std::vector<std::vector<double>>& input, const double* filter, int,
+                 int, int, std::vector<std::vector<double>>& output) {
+    // Taps are copied into a local array so they can stay in registers across the whole channel.
+    double taps[K * K];
+    for (int t = 0; t < K * K; ++t) {
+        taps[t] = filter[t];
+    }
+
+    int outputHeight = output.size();
+    int outputWidth = output[0].size();
+    for (int y = 0; y < outputHeight; ++y) {
+        const double* rows[K];
+        for (int i = 0; i < K; ++i) {
+            rows[i] = input[y * S + i].data();
+        }
+        double* out = output[y].data();
+        for (int x = 0; x < outputWidth; ++x) {
+            out[x] += sumTaps<K, S>(taps, rows, x, std::make_index_sequence<K * K>());
+        }
+    }
+}
+
+const int specializedSizes[] = {1, 3, 5, 7};
+
+// Indexed by [position of the filter size in specializedSizes][stride - 1].
+const ConvolutionKernels::ChannelKernel dispatchTable[4][2] = {
+    {specialized<1, 1>, specialized<1, 2>},
+    {specialized<3, 1>, specialized<3, 2>},
+    {specialized<5, 1>, specialized<5, 2>},
+    {specialized<7, 1>, specialized<7, 2>},
+};
+
+} // namespace
+
+ConvolutionKernels::ChannelKernel ConvolutionKernels::select(int filterSize, int stride, int dilation) {
+    if (dilation == 1 && (stride == 1 || stride == 2)) {
+        for (int k = 0; k < 4; ++k) {
+            if (specializedSizes[k] == filterSize) {
+                return dispatchTable[k][stride - 1];
+            }
+        }
+    }
+    return generic;
+}
+
+void ConvolutionKernels::generic(const std::vector<std::vector<double>>& input, const double* filter, int filterSize,
+                                 int stride, int dilation, std::vector<std::vector<double>>& output) {
+    // One filter tap at a time over the whole output, so the innermost loop is a
+    // multiply-add along an input row.
+    int outputHeight = output.size();
+    int outputWidth = output[0].size();
+    for (int i = 0; i < filterSize; ++i) {
+        for (int j = 0; j < filterSize; ++j) {
+            double weight = filter[i * filterSize + j];
+            for (int y = 0; y < outputHeight; ++y) {
+                const double* row = &input[y * stride + i * dilation][j * dilation];
+                double* out = output[y].data();
+                for (int x = 0; x < outputWidth; ++x) {
+                    out[x] += weight * row[x * stride];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,174 @@
+#include "utils/ConvolutionTuner.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
+std::string ConvolutionConfig::toString() const {
+    switch (algorithm) {
+        case Generic:
+            return "generic";
+        case Specialized:
+            return "specialized";
+        case Im2col:
+            return "im2col:" + std::to_string(tileSize);
+        case Blocked:
+            return "blocked";
+    }
+    return "";
+}
+
+bool ConvolutionConfig::parse(const std::string& text, ConvolutionConfig& config) {
+    ConvolutionConfig parsed;
+    if (text == "generic") {
+        parsed.algorithm = Generic;
+    } else if (text == "specialized") {
+        parsed.algorithm = Specialized;
+    } else if (text == "blocked") {
+        parsed.algorithm = Blocked;
+    } else if (text.compare(0, 7, "im2col:") == 0) {
+        parsed.algorithm = Im2col;
+        try {
+            parsed.tileSize = std::stoi(text.substr(7));
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (parsed.tileSize < 1) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    config = parsed;
+    return true;
+}
+
+ConvolutionTuner::State& ConvolutionTuner::state() {
+    static State instance;
+    return instance;
+}
+
+void ConvolutionTuner::enable(const std::string& cachePath) {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (s.cachePath != cachePath) {
+        s.choices.clear();
+        s.loaded = false;
+    }
+    s.enabled = true;
+    s.cachePath = cachePath;
+}
+
+void ConvolutionTuner::disable() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.enabled = false;
+}
+
+bool ConvolutionTuner::isEnabled() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.enabled;
+}
+
+void ConvolutionTuner::load(State& s) {
+    if (s.loaded) {
+        return;
+    }
+    s.loaded = true;
+    if (s.cachePath.empty()) {
+        return;
+    }
+    // A missing file is an empty cache. Each line is "key<TAB>config"; later lines win, and
+    // lines that do not parse (e.g. from a newer version) are skipped.
+    std::ifstream file(s.cachePath);
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t tab = line.rfind('\t');
+        ConvolutionConfig config;
+        if (tab != std::string::npos && ConvolutionConfig::parse(line.substr(tab + 1), config)) {
+            s.choices[line.substr(0, tab)] = config;
+        }
+    }
+}
+
+bool ConvolutionTuner::lookup(const std::string& key, ConvolutionConfig& config) {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    load(s);
+    auto it = s.choices.find(key);
+    if (it == s.choices.end()) {
+        return false;
+    }
+    config = it->second;
+    return true;
+}
+
+void ConvolutionTuner::store(const std::string& key, const ConvolutionConfig& config) {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    load(s);
+    s.choices[key] = config;
+    if (s.cachePath.empty()) {
+        return;
+    }
+    // Appending a single line keeps concurrent writers from corrupting each other's entries.
+    std::ofstream file(s.cachePath, std::ios::app);
+    file << key + "\t" + config.toString() + "\n";
+    file.flush();
+    if (!file) {
+        std::cerr << "Failed to write the convolution tuning cache " << s.cachePath << "\n";
+    }
+}
+
+std::string ConvolutionTuner::cpuModel() {
+    static const std::string model = [] {
+        std::string name;
+#ifdef __APPLE__
+        char brand[256];
+        size_t size = sizeof(brand);
+        if (sysctlbyname("machdep.cpu.brand_string", brand, &size, nullptr, 0) == 0) {
+            name = brand;
+        }
+#else
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (name.empty() && std::getline(cpuinfo, line)) {
+            // x86 reports "model name", some ARM kernels only "Processor" or "CPU part"
+            if (line.compare(0, 10, "model name") == 0 || line.compare(0, 9, "Processor") == 0 || line.compare(0, 8, "CPU part") == 0) {
+                size_t start = line.find(':');
+                start = start == std::string::npos ? start : line.find_first_not_of(" \t", start + 1);
+                if (start != std::string::npos) {
+                    name = line.substr(start);
+                }
+            }
+        }
+#endif
+        // The model becomes part of a tab-separated line of the cache file
+        std::replace(name.begin(), name.end(), '\t', ' ');
+        return name.empty() ? std::string("unknown CPU") : name;
+    }();
+    return model;
+}
+
+double ConvolutionTuner::secondsPerRun(const std::function<void()>& run) {
+    const int minRuns = 3;
+    const int maxRuns = 50;
+    const double minSeconds = 0.05;
+
+    run();
+    double best = std::numeric_limits<double>::max();
+    double total = 0.0;
+    for (int runs = 0; runs < maxRuns && (runs < minRuns || total < minSeconds); ++runs) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, seconds);
+        total += seconds;
+    }
+    return best;
+}
@@ -1,12 +1,57 @@
 #include "utils/ImageData.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
 
 ImageData::ImageData(const std::vector<std::vector<std::vector<double>>>& imageData, const std::vector<double>& label)
-    : imageData(imageData), label(label) {}
+    : imageData(imageData), label(label), numClasses(static_cast<uint16_t>(label.size())) {
+    labelIndex = static_cast<uint16_t>(std::distance(label.begin(), std::max_element(label.begin(), label.end())));
+}
+
+ImageData::ImageData(int depth, int height, int width, std::vector<uint8_t> pixels, double pixelScale, uint16_t label, uint16_t numClasses)
+    : pixels(std::move(pixels)), pixelScale(pixelScale), depth(static_cast<uint16_t>(depth)), height(static_cast<uint16_t>(height)),
+      width(static_cast<uint16_t>(width)), labelIndex(label), numClasses(numClasses) {
+    if (this->pixels.size() != static_cast<size_t>(depth) * height * width) {
+        throw std::invalid_argument("Pixel buffer size does not match the image shape.");
+    }
+    if (label >= numClasses) {
+        throw std::invalid_argument("Label is out of range for the number of classes.");
+    }
+}
+
+std::vector<std::vector<std::vector<double>>> ImageData::getImageData() const {
+    if (!isCompact()) {
+        return imageData;
+    }
+    std::vector<std::vector<std::vector<double>>> image(depth, std::vector<std::vector<double>>(height, std::vector<double>(width)));
+    const uint8_t* pixel = pixels.data();
+    for (auto& channel : image) {
+        for (auto& row : channel) {
+            for (auto& value : row) {
+                value = *pixel++ * pixelScale;
+            }
+        }
+    }
+    return image;
+}
 
-const std::vector<std::vector<std::vector<double>>>& ImageData::getImageData() const {
-    return imageData;
+std::vector<double> ImageData::getLabel() const {
+    if (!isCompact()) {
+        return label;
+    }
+    std::vector<double> oneHot(numClasses, 0.0);
+    oneHot[labelIndex] = 1.0;
+    return oneHot;
 }
 
-const std::vector<double>& ImageData::getLabel() const {
-    return label;
-}
\ No newline at end of file
+int ImageData::getLabelIndex() const {
+    return labelIndex;
+}
+
+int ImageData::getNumClasses() const {
+    return numClasses;
+}
+
+bool ImageData::isCompact() const {
+    return !pixels.empty();
+}
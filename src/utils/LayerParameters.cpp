@@ -0,0 +1,58 @@
+#include "utils/LayerParameters.h"
+#include <algorithm>
+#include <stdexcept>
+
+LayerParameters::LayerParameters(const LayerParameters& other) {
+    copyFrom(other);
+}
+
+LayerParameters& LayerParameters::operator=(const LayerParameters& other) {
+    if (this != &other) {
+        copyFrom(other);
+    }
+    return *this;
+}
+
+void LayerParameters::copyFrom(const LayerParameters& other) {
+    store.reset();
+    count = other.count;
+    ownedParameters.assign(other.parameterData, other.parameterData + other.count);
+    ownedGradients.assign(other.gradientData, other.gradientData + other.count);
+    parameterData = ownedParameters.data();
+    gradientData = ownedGradients.data();
+}
+
+void LayerParameters::resize(size_t size) {
+    store.reset();
+    count = size;
+    ownedParameters.assign(count, 0.0);
+    ownedGradients.assign(count, 0.0);
+    parameterData = ownedParameters.data();
+    gradientData = ownedGradients.data();
+}
+
+void LayerParameters::bind(std::shared_ptr<ParameterStore> target, size_t offset) {
+    if (!target || offset + count > target->size()) {
+        throw std::out_of_range("Parameter range does not fit in the store.");
+    }
+    std::copy(parameterData, parameterData + count, target->parameters() + offset);
+    std::copy(gradientData, gradientData + count, target->gradients() + offset);
+    parameterData = target->parameters() + offset;
+    gradientData = target->gradients() + offset;
+    store = std::move(target);
+    ownedParameters.clear();
+    ownedParameters.shrink_to_fit();
+    ownedGradients.clear();
+    ownedGradients.shrink_to_fit();
+}
+
+void LayerParameters::zeroGradients() {
+    std::fill(gradientData, gradientData + count, 0.0);
+}
+
+void LayerParameters::applyGradients(double step) {
+    for (size_t i = 0; i < count; ++i) {
+        parameterData[i] -= step * gradientData[i];
+        gradientData[i] = 0.0;
+    }
+}
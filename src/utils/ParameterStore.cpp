@@ -0,0 +1,54 @@
+#include "utils/ParameterStore.h"
+#include <cstring>
+#include <new>
+
+namespace {
+
+double* allocateAligned(size_t count) {
+    // aligned_alloc needs a size that is a multiple of the alignment
+    size_t bytes = (count * sizeof(double) + ParameterStore::Alignment - 1) / ParameterStore::Alignment * ParameterStore::Alignment;
+    void* buffer = std::aligned_alloc(ParameterStore::Alignment, bytes == 0 ? ParameterStore::Alignment : bytes);
+    if (!buffer) {
+        throw std::bad_alloc();
+    }
+    std::memset(buffer, 0, bytes);
+    return static_cast<double*>(buffer);
+}
+
+} // namespace
+
+ParameterStore::ParameterStore(size_t size)
+    : count(size), parameterBuffer(allocateAligned(size)), gradientBuffer(allocateAligned(size)) {}
+
+size_t ParameterStore::size() const {
+    return count;
+}
+
+double* ParameterStore::parameters() {
+    return parameterBuffer.get();
+}
+
+const double* ParameterStore::parameters() const {
+    return parameterBuffer.get();
+}
+
+double* ParameterStore::gradients() {
+    return gradientBuffer.get();
+}
+
+const double* ParameterStore::gradients() const {
+    return gradientBuffer.get();
+}
+
+void ParameterStore::zeroGradients() {
+    std::memset(gradientBuffer.get(), 0, count * sizeof(double));
+}
+
+void ParameterStore::applyGradients(double step) {
+    double* __restrict parameter = parameterBuffer.get();
+    double* __restrict gradient = gradientBuffer.get();
+    for (size_t i = 0; i < count; ++i) {
+        parameter[i] -= step * gradient[i];
+        gradient[i] = 0.0;
+    }
+}
@@ -0,0 +1,76 @@
+#include "utils/Serialization.h"
+#include "utils/activationFunctions/ELU.h"
+#include "utils/activationFunctions/Identity.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <stdexcept>
+
+namespace {
+
+void checkStream(std::istream& stream) {
+    if (!stream) {
+        throw std::runtime_error("Unexpected end of network file.");
+    }
+}
+
+} // namespace
+
+void Serialization::writeInt(std::ostream& stream, int32_t value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+int32_t Serialization::readInt(std::istream& stream) {
+    int32_t value = 0;
+    stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    checkStream(stream);
+    return value;
+}
+
+void Serialization::writeDouble(std::ostream& stream, double value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+double Serialization::readDouble(std::istream& stream) {
+    double value = 0.0;
+    stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+    checkStream(stream);
+    return value;
+}
+
+void Serialization::writeString(std::ostream& stream, const std::string& value) {
+    writeInt(stream, static_cast<int32_t>(value.size()));
+    stream.write(value.data(), value.size());
+}
+
+std::string Serialization::readString(std::istream& stream) {
+    int32_t size = readInt(stream);
+    if (size < 0 || size > 1024) {
+        throw std::runtime_error("Malformed string in network file.");
+    }
+    std::string value(size, '\0');
+    stream.read(&value[0], size);
+    checkStream(stream);
+    return value;
+}
+
+void Serialization::writeDoubles(std::ostream& stream, const double* values, size_t count) {
+    stream.write(reinterpret_cast<const char*>(values), count * sizeof(double));
+}
+
+void Serialization::readDoubles(std::istream& stream, double* values, size_t count) {
+    stream.read(reinterpret_cast<char*>(values), count * sizeof(double));
+    checkStream(stream);
+}
+
+std::shared_ptr<ActivationFunction> Serialization::readActivationFunction(std::istream& stream) {
+    std::string type = readString(stream);
+    if (type == "ReLU") {
+        return std::make_shared<ReLU>();
+    }
+    if (type == "ELU") {
+        return std::make_shared<ELU>(readDouble(stream));
+    }
+    if (type == "Identity") {
+        return std::make_shared<Identity>();
+    }
+    throw std::runtime_error("Unknown activation function in network file: " + type);
+}
@@ -0,0 +1,176 @@
+#include "utils/ThreadPool.h"
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Identifies the pool and queue of the current thread when it is a pool worker.
+thread_local const ThreadPool* workerPool = nullptr;
+thread_local int workerQueue = -1;
+
+std::mutex globalMutex;
+std::unique_ptr<ThreadPool> globalPool;
+
+} // namespace
+
+ThreadPool::ThreadPool(int numThreads, bool pinThreads) {
+    numThreads = std::max(0, numThreads);
+    for (int i = 0; i <= numThreads; ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (int i = 0; i < numThreads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i, pinThreads);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::getThreadCount() const {
+    return static_cast<int>(workers.size());
+}
+
+ThreadPool& ThreadPool::global() {
+    std::lock_guard<std::mutex> lock(globalMutex);
+    if (!globalPool) {
+        int hardwareThreads = static_cast<int>(std::thread::hardware_concurrency());
+        globalPool = std::make_unique<ThreadPool>(std::max(0, hardwareThreads - 1), false);
+    }
+    return *globalPool;
+}
+
+void ThreadPool::configureGlobal(int numThreads, bool pinThreads) {
+    std::lock_guard<std::mutex> lock(globalMutex);
+    globalPool.reset();
+    globalPool = std::make_unique<ThreadPool>(numThreads, pinThreads);
+}
+
+void ThreadPool::workerLoop(int index, bool pinThread) {
+    workerPool = this;
+    workerQueue = index;
+#ifdef __linux__
+    if (pinThread) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET((index + 1) % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+#else
+    (void)pinThread;
+#endif
+
+    while (true) {
+        if (runQueuedTask(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+int ThreadPool::currentQueue() const {
+    return workerPool == this ? workerQueue : static_cast<int>(queues.size()) - 1;
+}
+
+void ThreadPool::push(int queue, const Task& task) {
+    {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+        queues[queue]->tasks.push_back(task);
+    }
+    queued.fetch_add(1);
+    // Taking the lock orders this push before a worker's check of queued, so no wakeup is lost.
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_one();
+}
+
+bool ThreadPool::runQueuedTask(int queue) {
+    // Newest task of our own queue first (its data is likely in cache), otherwise steal the oldest,
+    // and so largest, task of another queue.
+    int queueCount = static_cast<int>(queues.size());
+    for (int k = 0; k < queueCount; ++k) {
+        int victim = (queue + k) % queueCount;
+        Task task;
+        {
+            std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+            auto& tasks = queues[victim]->tasks;
+            if (tasks.empty()) {
+                continue;
+            }
+            if (k == 0) {
+                task = tasks.back();
+                tasks.pop_back();
+            } else {
+                task = tasks.front();
+                tasks.pop_front();
+            }
+        }
+        queued.fetch_sub(1);
+        run(task, queue);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(Task task, int queue) {
+    Loop& loop = *task.loop;
+    // The caller still waits for pending to drop to zero, so a throwing chunk must not unwind
+    // past this frame; its exception is handed to the caller instead.
+    try {
+        while (task.end - task.begin > loop.grain && !loop.failed.load()) {
+            size_t chunks = (task.end - task.begin + loop.grain - 1) / loop.grain;
+            size_t middle = task.begin + chunks / 2 * loop.grain;
+            loop.pending.fetch_add(1);
+            push(queue, Task{ &loop, middle, task.end });
+            task.end = middle;
+        }
+        if (!loop.failed.load()) {
+            (*loop.body)(task.begin, task.end);
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(loop.errorMutex);
+        if (!loop.error) {
+            loop.error = std::current_exception();
+        }
+        loop.failed.store(true);
+    }
+    loop.pending.fetch_sub(1);
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (begin >= end) {
+        return;
+    }
+    grain = std::max<size_t>(1, grain);
+    if (workers.empty() || end - begin <= grain) {
+        body(begin, end);
+        return;
+    }
+
+    Loop loop;
+    loop.body = &body;
+    loop.grain = grain;
+    int queue = currentQueue();
+    run(Task{ &loop, begin, end }, queue);
+    while (loop.pending.load() > 0) {
+        if (!runQueuedTask(queue)) {
+            std::this_thread::yield();
+        }
+    }
+    if (loop.error) {
+        std::rethrow_exception(loop.error);
+    }
+}
@@ -1,4 +1,5 @@
 #include "utils/activationFunctions/ELU.h"
+#include "utils/Serialization.h"
 #include <cmath>
 
 ELU::ELU(double alpha) : alpha(alpha) {}
@@ -9,4 +10,9 @@ double ELU::activate(double x) const {
 
 double ELU::derivative(double x) const {
     return x > 0 ? 1 : alpha * std::exp(x);
+}
+
+void ELU::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "ELU");
+    Serialization::writeDouble(stream, alpha);
 }
\ No newline at end of file
@@ -0,0 +1,14 @@
+#include "utils/activationFunctions/Identity.h"
+#include "utils/Serialization.h"
+
+double Identity::activate(double x) const {
+    return x;
+}
+
+double Identity::derivative(double) const {
+    return 1.0;
+}
+
+void Identity::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "Identity");
+}
@@ -1,4 +1,5 @@
 #include "utils/activationFunctions/ReLU.h"
+#include "utils/Serialization.h"
 #include <algorithm>
 
 double ReLU::activate(double x) const {
@@ -7,4 +8,8 @@ double ReLU::activate(double x) const {
 
 double ReLU::derivative(double x) const {
     return x > 0 ? 1.0 : 0.0;
+}
+
+void ReLU::save(std::ostream& stream) const {
+    Serialization::writeString(stream, "ReLU");
 }
\ No newline at end of file
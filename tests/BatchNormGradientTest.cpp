@@ -0,0 +1,46 @@
+#include "GradientCheck.h"
+#include "layers/BatchNormLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include "utils/activationFunctions/Identity.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <iostream>
+
+// Finite-difference check of BatchNormLayer's per-sample and mini-batch gradients, per channel and
+// per feature, for activations whose derivative differs between their input and their output.
+
+namespace {
+
+const double tolerance = 1e-6;
+
+bool check(const std::string& name, std::shared_ptr<ActivationFunction> activation, const std::vector<int>& shape) {
+    std::mt19937 gen(7);
+    BatchNormLayer layer(activation);
+    layer.initialize(shape);
+    GradientCheck::randomizeParameters(layer, gen);
+
+    size_t depth = shape.size() == 3 ? shape[0] : 1;
+    size_t height = shape.size() == 3 ? shape[1] : 1;
+    size_t width = shape.size() == 3 ? shape[2] : shape[0];
+    double sample = GradientCheck::sampleError(layer, GradientCheck::randomTensor(depth, height, width, gen), gen);
+
+    std::vector<GradientCheck::Tensor> batch;
+    for (int k = 0; k < 4; ++k) {
+        batch.push_back(GradientCheck::randomTensor(depth, height, width, gen));
+    }
+    double miniBatch = GradientCheck::batchError(layer, batch, gen);
+
+    bool passed = sample < tolerance && miniBatch < tolerance;
+    std::cout << (passed ? "ok   " : "FAIL ") << name << ": per-sample error " << sample << ", mini-batch error " << miniBatch << "\n";
+    return passed;
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+    passed &= check("ELU, per channel", std::make_shared<ELU>(1.0), {3, 4, 5});
+    passed &= check("ELU, per feature", std::make_shared<ELU>(0.5), {6});
+    passed &= check("ReLU, per channel", std::make_shared<ReLU>(), {2, 3, 3});
+    passed &= check("Identity, per channel", std::make_shared<Identity>(), {2, 3, 3});
+    return passed ? 0 : 1;
+}
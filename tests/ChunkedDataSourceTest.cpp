@@ -0,0 +1,210 @@
+#include "data/ChunkedDataSource.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+// Reads a small chunked dataset through ChunkedDataSource with a shuffle buffer smaller than a
+// chunk, checking that every sample comes out once per epoch and that the chunk order changes
+// between epochs; that a truncated file and a corrupt header are reported; and, given the path of
+// CNNidxconvert, that a converted IDX file pair decodes to the original pixels and labels.
+
+namespace {
+
+const int height = 2;
+const int width = 2;
+const int numClasses = 10;
+const int samplesPerChunk = 8;
+// Not a multiple of samplesPerChunk, so the last chunk is short
+const int sampleCount = 50;
+
+bool report(const std::string& name, bool passed) {
+    std::cout << (passed ? "ok   " : "FAIL ") << name << "\n";
+    return passed;
+}
+
+std::string tempPath(const std::string& name) {
+    return "/tmp/CNNcppTest-" + std::to_string(getpid()) + "." + name;
+}
+
+// Sample i stores i in its first two pixels (low and high byte) and has label i % numClasses.
+std::vector<uint8_t> samplePixels(int i) {
+    return {static_cast<uint8_t>(i % 256), static_cast<uint8_t>(i / 256), 7, 9};
+}
+
+void writeDataset(const std::string& path) {
+    ChunkedDatasetWriter writer(path, 1, height, width, numClasses, samplesPerChunk, 1.0);
+    for (int i = 0; i < sampleCount; ++i) {
+        writer.addSample(samplePixels(i).data(), i % numClasses);
+    }
+    writer.close();
+}
+
+// The sample index stored in an image, or -1 if the image does not match samplePixels.
+int sampleIndex(const ImageData& sample) {
+    auto image = sample.getImageData();
+    int i = static_cast<int>(image[0][0][0]) + 256 * static_cast<int>(image[0][0][1]);
+    bool matches = image.size() == 1 && image[0].size() == static_cast<size_t>(height) && image[0][0].size() == static_cast<size_t>(width) &&
+                   image[0][1][0] == 7.0 && image[0][1][1] == 9.0 && sample.getLabelIndex() == i % numClasses;
+    return matches ? i : -1;
+}
+
+// Reads one epoch; returns the sample indices in the order they came out.
+std::vector<int> readEpoch(ChunkedDataSource& source) {
+    std::vector<int> indices;
+    std::vector<ImageData> batch;
+    source.startEpoch();
+    while (source.nextBatch(batch, 3)) {
+        for (const auto& sample : batch) {
+            indices.push_back(sampleIndex(sample));
+        }
+    }
+    return indices;
+}
+
+bool eachSampleOnce(const std::vector<int>& indices, int count) {
+    std::vector<int> seen(count, 0);
+    for (int i : indices) {
+        if (i < 0 || i >= count || seen[i]++ > 0) {
+            return false;
+        }
+    }
+    return static_cast<int>(indices.size()) == count;
+}
+
+// Chunks in the order their first sample came out. Every chunk holds more records than the
+// shuffle buffer, so this is the order in which they were read.
+std::vector<int> chunkOrder(const std::vector<int>& indices) {
+    std::vector<int> order;
+    for (int i : indices) {
+        int chunk = i / samplesPerChunk;
+        if (std::find(order.begin(), order.end(), chunk) == order.end()) {
+            order.push_back(chunk);
+        }
+    }
+    return order;
+}
+
+template <typename Action>
+bool throwsRuntimeError(Action action) {
+    try {
+        action();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void writeBigEndianInt(std::ofstream& stream, int32_t value) {
+    uint8_t bytes[4] = {uint8_t(value >> 24), uint8_t(value >> 16), uint8_t(value >> 8), uint8_t(value)};
+    stream.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+}
+
+bool checkConverter(const std::string& converter) {
+    std::string imagesPath = tempPath("images.idx");
+    std::string labelsPath = tempPath("labels.idx");
+    std::string outputPath = tempPath("converted.chunks");
+    {
+        std::ofstream images(imagesPath, std::ios::binary);
+        std::ofstream labels(labelsPath, std::ios::binary);
+        writeBigEndianInt(images, 0x00000803);
+        writeBigEndianInt(images, sampleCount);
+        writeBigEndianInt(images, height);
+        writeBigEndianInt(images, width);
+        writeBigEndianInt(labels, 0x00000801);
+        writeBigEndianInt(labels, sampleCount);
+        for (int i = 0; i < sampleCount; ++i) {
+            auto pixels = samplePixels(i);
+            uint8_t label = static_cast<uint8_t>(i % numClasses);
+            images.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+            labels.write(reinterpret_cast<const char*>(&label), sizeof(label));
+        }
+    }
+
+    std::string command = converter + " " + imagesPath + " " + labelsPath + " " + outputPath + " " + std::to_string(samplesPerChunk) + " " +
+                          std::to_string(numClasses) + " > /dev/null";
+    bool converted = std::system(command.c_str()) == 0;
+    bool passed = false;
+    if (converted) {
+        ChunkedDataSourceConfig config;
+        config.shuffleBufferSize = 5;
+        config.seed = 3;
+        ChunkedDataSource source(outputPath, config);
+        std::vector<int> indices;
+        std::vector<ImageData> batch;
+        source.startEpoch();
+        while (source.nextBatch(batch, 3)) {
+            for (const auto& sample : batch) {
+                // The converter keeps the default pixel scale of 1/255
+                auto image = sample.getImageData();
+                int i = static_cast<int>(std::lround(image[0][0][0] * 255.0)) + 256 * static_cast<int>(std::lround(image[0][0][1] * 255.0));
+                bool matches = std::lround(image[0][1][0] * 255.0) == 7 && std::lround(image[0][1][1] * 255.0) == 9 &&
+                               sample.getLabelIndex() == i % numClasses;
+                indices.push_back(matches ? i : -1);
+            }
+        }
+        passed = source.getHeader().sampleCount == sampleCount && eachSampleOnce(indices, sampleCount);
+    }
+    std::remove(imagesPath.c_str());
+    std::remove(labelsPath.c_str());
+    std::remove(outputPath.c_str());
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool passed = true;
+    std::string path = tempPath("chunks");
+    writeDataset(path);
+
+    ChunkedDataSourceConfig config;
+    config.shuffleBufferSize = 5;
+    config.readAheadChunks = 2;
+    config.seed = 11;
+    {
+        ChunkedDataSource source(path, config);
+        std::vector<int> first = readEpoch(source);
+        std::vector<int> second = readEpoch(source);
+        passed &= report("every sample comes out once in the first epoch", eachSampleOnce(first, sampleCount));
+        passed &= report("every sample comes out once in the second epoch", eachSampleOnce(second, sampleCount));
+        passed &= report("the chunk order changes between epochs", chunkOrder(first) != chunkOrder(second));
+
+        // Stopping early and starting over drops the rest of the epoch
+        std::vector<ImageData> batch;
+        source.startEpoch();
+        source.nextBatch(batch, 4);
+        passed &= report("an epoch cut short is restarted cleanly", eachSampleOnce(readEpoch(source), sampleCount));
+    }
+
+    // Cut off the last record and a half; the header still claims all of them
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3 * (height * width + sizeof(uint16_t)) / 2);
+    passed &= report("a truncated file raises the reader's error", throwsRuntimeError([&] {
+        ChunkedDataSource source(path, config);
+        readEpoch(source);
+    }));
+
+    {
+        std::ofstream file(path, std::ios::binary);
+        ChunkedDatasetHeader header;
+        header.depth = 1;
+        header.height = height;
+        header.width = width;
+        header.numClasses = numClasses;
+        header.samplesPerChunk = samplesPerChunk;
+        header.sampleCount = -20;
+        header.write(file);
+    }
+    passed &= report("a negative sample count is rejected", throwsRuntimeError([&] { ChunkedDataSource source(path, config); }));
+    std::remove(path.c_str());
+
+    if (argc > 1) {
+        passed &= report("CNNidxconvert output decodes to the IDX samples", checkConverter(argv[1]));
+    }
+    return passed ? 0 : 1;
+}
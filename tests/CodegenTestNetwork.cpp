@@ -0,0 +1,83 @@
+#include "GradientCheck.h"
+#include "cnn/CNN.h"
+#include "layers/BatchNormLayer.h"
+#include "layers/ConvolutionalLayer.h"
+#include "layers/DepthwiseConvolutionalLayer.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/MaxPoolingLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include "utils/activationFunctions/Identity.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <iostream>
+
+// Saves a small network covering every layer CNNcodegen emits, with padded, dilated and grouped
+// convolutions, batch normalization that CNNcodegen folds into the preceding convolution or fully
+// connected layer and one it cannot fold, and randomized parameters and running statistics, for the
+// GeneratedCodeSelfTest ctest target.
+//   CodegenTestNetwork <network>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <network>\n";
+        return 1;
+    }
+
+    CNN network(0.01, {3, 13, 11});
+    network.addLayer(std::make_shared<ConvolutionalLayer>(3, 4, 1, ConvolutionalLayer::SamePadding, 1, 1, std::make_shared<Identity>()));
+    network.addLayer(std::make_shared<BatchNormLayer>(std::make_shared<ELU>(0.7)));
+    network.addLayer(std::make_shared<ConvolutionalLayer>(3, 6, 2, 1, 2, 2, std::make_shared<ReLU>()));
+    network.addLayer(std::make_shared<DepthwiseConvolutionalLayer>(2, 1, std::make_shared<ELU>(1.0)));
+    network.addLayer(std::make_shared<MaxPoolingLayer>(2));
+    // Follows a pooling layer, so it stays a layer of its own
+    network.addLayer(std::make_shared<BatchNormLayer>(std::make_shared<ReLU>()));
+    network.addLayer(std::make_shared<FlattenLayer>());
+    network.addLayer(std::make_shared<FullyConnectedLayer>(12, std::make_shared<Identity>()));
+    network.addLayer(std::make_shared<BatchNormLayer>(std::make_shared<ELU>(1.0)));
+    network.addLayer(std::make_shared<FullyConnectedLayer>(7, std::make_shared<Identity>()));
+    network.addLayer(std::make_shared<SoftmaxLayer>());
+
+    // Non-zero biases, so that a misplaced bias or padding offset shows up in the outputs
+    std::mt19937 gen(3);
+    for (size_t l = 0; l < network.getLayerCount(); ++l) {
+        if (auto layer = std::dynamic_pointer_cast<ParameterizedLayer>(network.getLayer(l))) {
+            GradientCheck::randomizeParameters(*layer, gen);
+        }
+    }
+
+    // Move the running statistics away from zero mean and unit variance with a few mini-batches of
+    // shifted inputs
+    for (size_t l = 0; l < network.getLayerCount(); ++l) {
+        auto batchNorm = std::dynamic_pointer_cast<BatchNormLayer>(network.getLayer(l));
+        if (!batchNorm) {
+            continue;
+        }
+        const auto& shape = network.getLayerInputShape(l);
+        for (int step = 0; step < 5; ++step) {
+            std::vector<GradientCheck::Tensor> batch;
+            for (int k = 0; k < 4; ++k) {
+                auto sample = shape.size() == 1 ? GradientCheck::randomTensor(1, 1, shape[0], gen)
+                                                : GradientCheck::randomTensor(shape[0], shape[1], shape[2], gen);
+                for (auto& channel : sample) {
+                    for (auto& row : channel) {
+                        for (size_t j = 0; j < row.size(); ++j) {
+                            row[j] = 2.0 * row[j] + 0.3 * static_cast<double>(j % 3);
+                        }
+                    }
+                }
+                batch.push_back(sample);
+            }
+            std::vector<LayerCache> caches;
+            batchNorm->forwardMiniBatch(batch, caches);
+        }
+    }
+
+    try {
+        network.saveNetwork(argv[1]);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "GradientCheck.h"
+#include "layers/ConvolutionalLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include "utils/activationFunctions/Identity.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <iostream>
+
+// Finite-difference check of ConvolutionalLayer's input and parameter gradients with padding,
+// dilation, strides and groups, under every forward algorithm, and of the input size checks.
+
+namespace {
+
+const double tolerance = 1e-6;
+
+bool check(const std::string& name, int filterSize, int numFilters, int stride, int padding, int dilation, int groups,
+           std::shared_ptr<ActivationFunction> activation, const std::vector<int>& shape) {
+    bool passed = true;
+    std::vector<ConvolutionConfig> configs(4);
+    configs[0].algorithm = ConvolutionConfig::Generic;
+    configs[1].algorithm = ConvolutionConfig::Specialized;
+    configs[2].algorithm = ConvolutionConfig::Im2col;
+    configs[2].tileSize = 8;
+    configs[3].algorithm = ConvolutionConfig::Blocked;
+    for (const auto& config : configs) {
+        std::mt19937 gen(5);
+        ConvolutionalLayer layer(filterSize, numFilters, stride, padding, dilation, groups, activation);
+        layer.initialize(shape);
+        GradientCheck::randomizeParameters(layer, gen);
+        layer.setForwardConfig(config);
+        double error = GradientCheck::sampleError(layer, GradientCheck::randomTensor(shape[0], shape[1], shape[2], gen), gen);
+
+        bool ok = error < tolerance;
+        std::cout << (ok ? "ok   " : "FAIL ") << name << ", " << config.toString() << ": error " << error << "\n";
+        passed &= ok;
+    }
+    return passed;
+}
+
+bool rejects(const std::string& name, int filterSize, int stride, int padding, int dilation, const std::vector<int>& shape) {
+    ConvolutionalLayer layer(filterSize, 2, stride, padding, dilation, 1, std::make_shared<ReLU>());
+    bool passed = false;
+    try {
+        layer.getOutputShape(shape);
+    } catch (const std::invalid_argument&) {
+        passed = true;
+    }
+    std::cout << (passed ? "ok   " : "FAIL ") << name << " is rejected\n";
+    return passed;
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+    passed &= check("3x3, padding 1", 3, 3, 1, 1, 1, 1, std::make_shared<ReLU>(), {2, 6, 7});
+    passed &= check("3x3, same padding, dilation 2", 3, 3, 1, ConvolutionalLayer::SamePadding, 2, 1, std::make_shared<ReLU>(), {2, 7, 8});
+    passed &= check("3x3, 2 groups", 3, 4, 1, 0, 1, 2, std::make_shared<Identity>(), {4, 5, 6});
+    passed &= check("3x3, stride 2, padding 1, dilation 2, 2 groups", 3, 4, 2, 1, 2, 2, std::make_shared<ReLU>(), {4, 8, 7});
+    passed &= check("2x2, stride 2, padding 2", 2, 2, 2, 2, 1, 1, std::make_shared<Identity>(), {1, 5, 5});
+    passed &= check("3x3, padding 1, ELU", 3, 3, 1, 1, 1, 1, std::make_shared<ELU>(1.0), {2, 6, 7});
+    passed &= check("3x3, stride 2, dilation 2, 2 groups, ELU", 3, 4, 2, 1, 2, 2, std::make_shared<ELU>(1.0), {4, 8, 7});
+
+    passed &= rejects("6x6 input with a 3x3 filter at dilation 3", 3, 1, 0, 3, {1, 6, 6});
+    passed &= rejects("4x9 input with a 5x5 filter at stride 2", 5, 2, 0, 1, {1, 4, 9});
+    return passed ? 0 : 1;
+}
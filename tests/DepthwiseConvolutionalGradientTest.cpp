@@ -0,0 +1,33 @@
+#include "GradientCheck.h"
+#include "layers/DepthwiseConvolutionalLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include "utils/activationFunctions/ReLU.h"
+#include <iostream>
+
+// Finite-difference check of DepthwiseConvolutionalLayer's input and parameter gradients.
+
+namespace {
+
+const double tolerance = 1e-6;
+
+bool check(const std::string& name, int filterSize, int stride, std::shared_ptr<ActivationFunction> activation) {
+    std::mt19937 gen(11);
+    DepthwiseConvolutionalLayer layer(filterSize, stride, activation);
+    layer.initialize({3, 7, 8});
+    GradientCheck::randomizeParameters(layer, gen);
+    double error = GradientCheck::sampleError(layer, GradientCheck::randomTensor(3, 7, 8, gen), gen);
+
+    bool passed = error < tolerance;
+    std::cout << (passed ? "ok   " : "FAIL ") << name << ": error " << error << "\n";
+    return passed;
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+    passed &= check("3x3, stride 1, ELU", 3, 1, std::make_shared<ELU>(1.0));
+    passed &= check("3x3, stride 2, ELU", 3, 2, std::make_shared<ELU>(1.0));
+    passed &= check("2x2, stride 1, ReLU", 2, 1, std::make_shared<ReLU>());
+    return passed ? 0 : 1;
+}
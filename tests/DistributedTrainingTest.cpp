@@ -0,0 +1,197 @@
+#include "cnn/CNN.h"
+#include "distributed/GradientSynchronizer.h"
+#include "distributed/SharedMemoryTransport.h"
+#include "distributed/SocketTransport.h"
+#include "layers/ConvolutionalLayer.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Forks worldSize ranks that train the same network with data-parallel SGD, over shared memory and
+// over sockets, on a data set that does not divide evenly between them. Checks that every rank
+// ends with the same parameters, and that a mini-batch spread over the ranks makes the same update
+// as single-process SGD on the union of their shards.
+
+namespace {
+
+const int worldSize = 3;
+const size_t sampleCount = 101;
+const double tolerance = 1e-12;
+// The ranks and the single process sum the gradients in different orders
+const double unionTolerance = 1e-10;
+
+enum class Backend { SharedMemory, Socket };
+
+std::vector<ImageData> syntheticData(size_t count) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<> value(0.0, 1.0);
+    std::vector<ImageData> data;
+    for (size_t n = 0; n < count; ++n) {
+        std::vector<std::vector<std::vector<double>>> image(1, std::vector<std::vector<double>>(6, std::vector<double>(6)));
+        for (auto& row : image[0]) {
+            for (auto& v : row) {
+                v = value(gen);
+            }
+        }
+        std::vector<double> label(4, 0.0);
+        label[n % 4] = 1.0;
+        data.emplace_back(image, label);
+    }
+    return data;
+}
+
+std::string jobNameFor(Backend backend, const std::string& check) {
+    return "CNNcppTest-" + std::to_string(getpid()) + (backend == Backend::Socket ? "-socket-" : "-shm-") + check;
+}
+
+std::string parameterPath(const std::string& jobName, const std::string& name) {
+    return "/tmp/" + jobName + "." + name + ".params";
+}
+
+std::shared_ptr<Transport> makeTransport(Backend backend, int rank, const std::string& jobName) {
+    if (backend == Backend::Socket) {
+        return std::make_shared<SocketTransport>(rank, worldSize, "/tmp", jobName);
+    }
+    return std::make_shared<SharedMemoryTransport>(rank, worldSize, jobName);
+}
+
+int runRank(Backend backend, int rank, const std::string& jobName, int epochs, int miniBatchSize) {
+    try {
+        GradientSynchronizer synchronizer(makeTransport(backend, rank, jobName));
+
+        // Every rank starts from its own random initialization; SGD broadcasts rank 0's
+        CNN cnn(0.05, {1, 6, 6});
+        cnn.addLayer(std::make_shared<ConvolutionalLayer>(3, 2, std::make_shared<ELU>(1.0)));
+        cnn.addLayer(std::make_shared<FlattenLayer>());
+        cnn.addLayer(std::make_shared<FullyConnectedLayer>(4, std::make_shared<ELU>(1.0)));
+        cnn.addLayer(std::make_shared<SoftmaxLayer>());
+        if (rank == 0) {
+            cnn.saveNetwork(parameterPath(jobName, "initial"));
+        }
+
+        cnn.SGD(syntheticData(sampleCount), epochs, miniBatchSize, {}, synchronizer);
+        cnn.saveNetwork(parameterPath(jobName, std::to_string(rank)));
+    } catch (const std::exception& e) {
+        std::cerr << "Rank " << rank << ": " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Runs every rank in its own process; false if one of them failed.
+bool runRanks(Backend backend, const std::string& jobName, int epochs, int miniBatchSize) {
+    // A rank writing to std::cerr would otherwise flush its copy of our buffered output
+    std::cout.flush();
+    std::vector<pid_t> children;
+    for (int rank = 0; rank < worldSize; ++rank) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(runRank(backend, rank, jobName, epochs, miniBatchSize));
+        }
+        if (pid < 0) {
+            std::cerr << "Failed to fork rank " << rank << "\n";
+            return false;
+        }
+        children.push_back(pid);
+    }
+
+    bool passed = true;
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        passed &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return passed;
+}
+
+std::vector<double> readParameters(const CNN& cnn) {
+    std::vector<double> values;
+    for (size_t l = 0; l < cnn.getLayerCount(); ++l) {
+        if (auto layer = std::dynamic_pointer_cast<ParameterizedLayer>(cnn.getLayer(l))) {
+            std::vector<double> layerValues(layer->getParameterCount());
+            layer->readParameters(layerValues.data());
+            values.insert(values.end(), layerValues.begin(), layerValues.end());
+        }
+    }
+    return values;
+}
+
+// Reads and removes a saved network's parameters.
+std::vector<double> takeParameters(const std::string& path) {
+    std::vector<double> values = readParameters(CNN::loadNetwork(path));
+    std::remove(path.c_str());
+    return values;
+}
+
+double maxDifference(const std::vector<double>& a, const std::vector<double>& b) {
+    if (a.size() != b.size()) {
+        return INFINITY;
+    }
+    double difference = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        difference = std::max(difference, std::fabs(a[i] - b[i]));
+    }
+    return difference;
+}
+
+bool report(const std::string& name, double difference, double limit) {
+    bool passed = difference <= limit;
+    std::cout << (passed ? "ok   " : "FAIL ") << name << ": max parameter difference " << difference << "\n";
+    return passed;
+}
+
+bool checkRanksAgree(Backend backend, const std::string& backendName) {
+    std::string jobName = jobNameFor(backend, "agree");
+    if (!runRanks(backend, jobName, 3, 8)) {
+        std::cout << "FAIL a rank did not finish training over " << backendName << "\n";
+        return false;
+    }
+    std::remove(parameterPath(jobName, "initial").c_str());
+    std::vector<double> reference = takeParameters(parameterPath(jobName, "0"));
+    double difference = 0.0;
+    for (int rank = 1; rank < worldSize; ++rank) {
+        difference = std::max(difference, maxDifference(takeParameters(parameterPath(jobName, std::to_string(rank))), reference));
+    }
+    return report(std::to_string(worldSize) + " ranks agree after training over " + backendName, difference, tolerance);
+}
+
+bool checkMatchesUnion(Backend backend, const std::string& backendName) {
+    // One epoch of one mini-batch per rank; the shards of the first epoch are the first
+    // worldSize * shardSize samples, strided over the ranks
+    std::string jobName = jobNameFor(backend, "union");
+    int shardSize = static_cast<int>(sampleCount / worldSize);
+    if (!runRanks(backend, jobName, 1, shardSize)) {
+        std::cout << "FAIL a rank did not finish training over " << backendName << "\n";
+        return false;
+    }
+    std::vector<double> distributed = takeParameters(parameterPath(jobName, "0"));
+    for (int rank = 1; rank < worldSize; ++rank) {
+        std::remove(parameterPath(jobName, std::to_string(rank)).c_str());
+    }
+
+    std::string initialPath = parameterPath(jobName, "initial");
+    CNN single = CNN::loadNetwork(initialPath);
+    std::remove(initialPath.c_str());
+    // syntheticData draws the samples in order, so this is the data set's first samples
+    single.SGD(syntheticData(shardSize * worldSize), 1, shardSize * worldSize, {});
+    return report("averaged update over " + backendName + " matches single-process SGD on the union of the shards",
+                  maxDifference(distributed, readParameters(single)), unionTolerance);
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+    passed &= checkRanksAgree(Backend::SharedMemory, "shared memory");
+    passed &= checkRanksAgree(Backend::Socket, "sockets");
+    passed &= checkMatchesUnion(Backend::SharedMemory, "shared memory");
+    passed &= checkMatchesUnion(Backend::Socket, "sockets");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#ifndef GRADIENT_CHECK_H
+#define GRADIENT_CHECK_H
+
+#include "interfaces/BatchLayer.h"
+#include "interfaces/ParameterizedLayer.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Central-difference checks of a layer's gradients for the loss sum(weights * output), where the
+// weights are random. Each check returns the largest error over every input value and parameter,
+// relative to the size of the numerical derivative (absolute below 1).
+namespace GradientCheck {
+
+using Tensor = std::vector<std::vector<std::vector<double>>>;
+
+const double step = 1e-6;
+
+inline Tensor randomTensor(size_t depth, size_t height, size_t width, std::mt19937& gen) {
+    std::uniform_real_distribution<> value(-1.0, 1.0);
+    Tensor tensor(depth, std::vector<std::vector<double>>(height, std::vector<double>(width)));
+    for (auto& channel : tensor) {
+        for (auto& row : channel) {
+            for (auto& v : row) {
+                v = value(gen);
+            }
+        }
+    }
+    return tensor;
+}
+
+inline Tensor randomLike(const Tensor& tensor, std::mt19937& gen) {
+    return randomTensor(tensor.size(), tensor[0].size(), tensor[0][0].size(), gen);
+}
+
+inline double dot(const Tensor& a, const Tensor& b) {
+    double sum = 0.0;
+    for (size_t d = 0; d < a.size(); ++d) {
+        for (size_t i = 0; i < a[d].size(); ++i) {
+            for (size_t j = 0; j < a[d][i].size(); ++j) {
+                sum += a[d][i][j] * b[d][i][j];
+            }
+        }
+    }
+    return sum;
+}
+
+inline double error(double analytic, double numeric) {
+    return std::fabs(analytic - numeric) / std::max(1.0, std::fabs(numeric));
+}
+
+// Randomizes the parameters, so that e.g. biases and batch-norm shifts are not all zero.
+inline void randomizeParameters(ParameterizedLayer& layer, std::mt19937& gen) {
+    std::uniform_real_distribution<> value(-0.5, 0.5);
+    std::vector<double> parameters(layer.getParameterCount());
+    layer.readParameters(parameters.data());
+    for (double& p : parameters) {
+        p += value(gen);
+    }
+    layer.writeParameters(parameters.data());
+}
+
+// Compares the derivatives of loss() with respect to every input value and parameter with the
+// given analytic ones. loss may change input and the layer's parameters, but must restore them.
+template <typename Loss>
+double compare(ParameterizedLayer& layer, std::vector<Tensor>& inputs, const std::vector<Tensor>& inputGradients,
+               const std::vector<double>& parameterGradients, Loss loss) {
+    double maxError = 0.0;
+    for (size_t k = 0; k < inputs.size(); ++k) {
+        for (size_t d = 0; d < inputs[k].size(); ++d) {
+            for (size_t i = 0; i < inputs[k][d].size(); ++i) {
+                for (size_t j = 0; j < inputs[k][d][i].size(); ++j) {
+                    double& value = inputs[k][d][i][j];
+                    double original = value;
+                    value = original + step;
+                    double above = loss();
+                    value = original - step;
+                    double below = loss();
+                    value = original;
+                    maxError = std::max(maxError, error(inputGradients[k][d][i][j], (above - below) / (2 * step)));
+                }
+            }
+        }
+    }
+
+    std::vector<double> parameters(layer.getParameterCount());
+    layer.readParameters(parameters.data());
+    for (size_t p = 0; p < parameters.size(); ++p) {
+        double original = parameters[p];
+        parameters[p] = original + step;
+        layer.writeParameters(parameters.data());
+        double above = loss();
+        parameters[p] = original - step;
+        layer.writeParameters(parameters.data());
+        double below = loss();
+        parameters[p] = original;
+        layer.writeParameters(parameters.data());
+        maxError = std::max(maxError, error(parameterGradients[p], (above - below) / (2 * step)));
+    }
+    return maxError;
+}
+
+// Checks the per-sample forward(input, cache) / backward(gradient, cache) pair.
+inline double sampleError(ParameterizedLayer& layer, Tensor input, std::mt19937& gen) {
+    LayerCache cache;
+    Tensor weights = randomLike(layer.forward(input, cache), gen);
+    layer.resetGradients();
+    std::vector<Tensor> inputGradients = { layer.backward(weights, cache) };
+    std::vector<double> parameterGradients(layer.getParameterCount());
+    layer.readGradients(parameterGradients.data());
+
+    std::vector<Tensor> inputs = { input };
+    return compare(layer, inputs, inputGradients, parameterGradients, [&] {
+        LayerCache scratch;
+        return dot(weights, layer.forward(inputs[0], scratch));
+    });
+}
+
+// Checks forwardMiniBatch / backwardMiniBatch, whose outputs depend on the whole batch.
+template <typename LayerType>
+double batchError(LayerType& layer, std::vector<Tensor> batch, std::mt19937& gen) {
+    std::vector<LayerCache> caches;
+    auto outputs = batch;
+    layer.forwardMiniBatch(outputs, caches);
+    std::vector<Tensor> weights;
+    for (const auto& output : outputs) {
+        weights.push_back(randomLike(output, gen));
+    }
+    layer.resetGradients();
+    auto inputGradients = weights;
+    layer.backwardMiniBatch(inputGradients, caches);
+    std::vector<double> parameterGradients(layer.getParameterCount());
+    layer.readGradients(parameterGradients.data());
+
+    return compare(layer, batch, inputGradients, parameterGradients, [&] {
+        std::vector<LayerCache> scratch;
+        auto perturbed = batch;
+        layer.forwardMiniBatch(perturbed, scratch);
+        double loss = 0.0;
+        for (size_t k = 0; k < perturbed.size(); ++k) {
+            loss += dot(weights[k], perturbed[k]);
+        }
+        return loss;
+    });
+}
+
+} // namespace GradientCheck
+
+#endif // GRADIENT_CHECK_H
@@ -0,0 +1,235 @@
+#include "GradientCheck.h"
+#include "cnn/LayerPipeline.h"
+#include "layers/BatchNormLayer.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include "utils/activationFunctions/Identity.h"
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+// Checks that LayerPipeline matches layer-by-layer inference, that pipelined training of a network
+// with batch normalization accumulates the same gradients as training each micro-batch layer by
+// layer, that an exception thrown inside a stage reaches the caller of forward and train and
+// leaves the pipeline usable, and that the stage threads sleep between runs.
+
+namespace {
+
+using Tensor = LayerPipeline::Tensor;
+
+bool report(const std::string& name, bool passed) {
+    std::cout << (passed ? "ok   " : "FAIL ") << name << "\n";
+    return passed;
+}
+
+void initialize(std::vector<std::shared_ptr<Layer>>& layers) {
+    std::vector<int> shape = {2, 3, 3};
+    for (auto& layer : layers) {
+        if (auto* adaptive = dynamic_cast<AdaptiveLayer*>(layer.get())) {
+            adaptive->initialize(shape);
+        }
+        shape = layer->getOutputShape(shape);
+    }
+}
+
+std::vector<std::shared_ptr<Layer>> buildLayers() {
+    std::vector<std::shared_ptr<Layer>> layers = {
+        std::make_shared<FlattenLayer>(),
+        std::make_shared<FullyConnectedLayer>(12, std::make_shared<ELU>(1.0)),
+        std::make_shared<FullyConnectedLayer>(8, std::make_shared<ELU>(1.0)),
+        std::make_shared<FullyConnectedLayer>(4, std::make_shared<ELU>(1.0)),
+        std::make_shared<SoftmaxLayer>(),
+    };
+    initialize(layers);
+    return layers;
+}
+
+std::vector<std::shared_ptr<Layer>> buildBatchNormLayers(std::mt19937& gen) {
+    std::vector<std::shared_ptr<Layer>> layers = {
+        std::make_shared<FlattenLayer>(),
+        std::make_shared<FullyConnectedLayer>(12, std::make_shared<Identity>()),
+        std::make_shared<BatchNormLayer>(std::make_shared<ELU>(1.0)),
+        std::make_shared<FullyConnectedLayer>(8, std::make_shared<Identity>()),
+        std::make_shared<BatchNormLayer>(std::make_shared<ELU>(1.0)),
+        std::make_shared<FullyConnectedLayer>(4, std::make_shared<Identity>()),
+        std::make_shared<SoftmaxLayer>(),
+    };
+    initialize(layers);
+    for (auto& layer : layers) {
+        if (auto* parameterized = dynamic_cast<ParameterizedLayer*>(layer.get())) {
+            GradientCheck::randomizeParameters(*parameterized, gen);
+            parameterized->resetGradients();
+        }
+    }
+    return layers;
+}
+
+Tensor lossGradient(size_t k, const Tensor& output) {
+    Tensor gradient = output;
+    gradient[0][0][k % gradient[0][0].size()] -= 1.0;
+    return gradient;
+}
+
+// What CNN::updateMiniBatchLayerwise does with each micro-batch, without updating the parameters.
+void trainLayerwise(std::vector<std::shared_ptr<Layer>>& layers, const std::vector<Tensor>& inputs, size_t microBatchSize) {
+    for (size_t first = 0; first < inputs.size(); first += microBatchSize) {
+        std::vector<Tensor> batch(inputs.begin() + first, inputs.begin() + std::min(inputs.size(), first + microBatchSize));
+        std::vector<std::vector<LayerCache>> caches(layers.size(), std::vector<LayerCache>(batch.size()));
+        for (size_t l = 0; l < layers.size(); ++l) {
+            if (auto* batchLayer = dynamic_cast<BatchLayer*>(layers[l].get())) {
+                batchLayer->forwardMiniBatch(batch, caches[l]);
+                continue;
+            }
+            for (size_t k = 0; k < batch.size(); ++k) {
+                batch[k] = layers[l]->forward(batch[k], caches[l][k]);
+            }
+        }
+        for (size_t k = 0; k < batch.size(); ++k) {
+            batch[k] = lossGradient(first + k, batch[k]);
+        }
+        for (size_t l = layers.size(); l-- > 0;) {
+            if (auto* batchLayer = dynamic_cast<BatchLayer*>(layers[l].get())) {
+                batchLayer->backwardMiniBatch(batch, caches[l]);
+                continue;
+            }
+            for (size_t k = 0; k < batch.size(); ++k) {
+                batch[k] = layers[l]->backward(std::move(batch[k]), caches[l][k]);
+            }
+        }
+    }
+}
+
+std::vector<double> readGradients(const std::vector<std::shared_ptr<Layer>>& layers) {
+    std::vector<double> gradients;
+    for (const auto& layer : layers) {
+        if (auto* parameterized = dynamic_cast<ParameterizedLayer*>(layer.get())) {
+            std::vector<double> layerGradients(parameterized->getParameterCount());
+            parameterized->readGradients(layerGradients.data());
+            gradients.insert(gradients.end(), layerGradients.begin(), layerGradients.end());
+        }
+    }
+    return gradients;
+}
+
+std::vector<Tensor> inferAll(const std::vector<std::shared_ptr<Layer>>& layers, const std::vector<Tensor>& inputs) {
+    std::vector<Tensor> outputs;
+    for (const auto& input : inputs) {
+        Tensor output = input;
+        LayerCache workspace;
+        for (const auto& layer : layers) {
+            output = layer->infer(output, workspace);
+        }
+        outputs.push_back(output);
+    }
+    return outputs;
+}
+
+std::vector<Tensor> randomInputs(size_t count, size_t depth, size_t height, size_t width, std::mt19937& gen) {
+    std::vector<Tensor> inputs;
+    for (size_t k = 0; k < count; ++k) {
+        inputs.push_back(GradientCheck::randomTensor(depth, height, width, gen));
+    }
+    return inputs;
+}
+
+double maxDifference(const std::vector<Tensor>& a, const std::vector<Tensor>& b) {
+    if (a.size() != b.size()) {
+        return INFINITY;
+    }
+    double difference = 0.0;
+    for (size_t k = 0; k < a.size(); ++k) {
+        for (size_t i = 0; i < a[k][0][0].size(); ++i) {
+            difference = std::max(difference, std::fabs(a[k][0][0][i] - b[k][0][0][i]));
+        }
+    }
+    return difference;
+}
+
+double cpuSeconds() {
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 gen(9);
+    auto layers = buildLayers();
+    LayerPipeline pipeline(layers, {2, 3, 5}, false);
+    bool passed = true;
+
+    auto inputs = randomInputs(10, 2, 3, 3, gen);
+    auto outputs = pipeline.forward(inputs, 3);
+    auto expected = inferAll(layers, inputs);
+    passed &= report("forward matches layer-by-layer inference", maxDifference(outputs, expected) == 0.0);
+
+    // Every micro-batch goes forward before any goes backward, so a batch normalization layer has
+    // several micro-batches' statistics in flight
+    auto batchNormLayers = buildBatchNormLayers(gen);
+    std::vector<std::shared_ptr<Layer>> referenceLayers;
+    for (const auto& layer : batchNormLayers) {
+        referenceLayers.push_back(layer->clone());
+    }
+    auto trainingInputs = randomInputs(12, 2, 3, 3, gen);
+    {
+        LayerPipeline trainer(batchNormLayers, {2, 4, 5, 7}, false);
+        trainer.train(trainingInputs, 3, lossGradient);
+    }
+    trainLayerwise(referenceLayers, trainingInputs, 3);
+    std::vector<double> gradients = readGradients(batchNormLayers);
+    std::vector<double> referenceGradients = readGradients(referenceLayers);
+    double gradientDifference = gradients.size() == referenceGradients.size() ? 0.0 : INFINITY;
+    for (size_t i = 0; i < gradients.size() && i < referenceGradients.size(); ++i) {
+        gradientDifference = std::max(gradientDifference, std::fabs(gradients[i] - referenceGradients[i]));
+    }
+    std::cout << "     max gradient difference " << gradientDifference << "\n";
+    passed &= report("train with batch normalization matches layer-by-layer training", gradientDifference < 1e-12);
+    passed &= report("train updates the running statistics like layer-by-layer training",
+                     maxDifference(inferAll(batchNormLayers, trainingInputs), inferAll(referenceLayers, trainingInputs)) < 1e-12);
+
+    // Inputs of the wrong size make the first fully connected layer throw inside stage 1
+    auto badInputs = randomInputs(10, 1, 2, 2, gen);
+    bool caught = false;
+    try {
+        pipeline.forward(badInputs, 3);
+    } catch (const std::invalid_argument&) {
+        caught = true;
+    }
+    passed &= report("forward rethrows a stage's exception", caught);
+
+    caught = false;
+    try {
+        pipeline.train(badInputs, 3, [](size_t, const Tensor& output) { return output; });
+    } catch (const std::invalid_argument&) {
+        caught = true;
+    }
+    passed &= report("train rethrows a stage's exception", caught);
+
+    caught = false;
+    try {
+        pipeline.train(inputs, 3, [](size_t k, const Tensor& output) {
+            if (k == 4) {
+                throw std::runtime_error("loss");
+            }
+            return output;
+        });
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    passed &= report("train rethrows a loss gradient's exception", caught);
+
+    passed &= report("is usable after an exception", maxDifference(pipeline.forward(inputs, 3), expected) == 0.0);
+
+    // Polling stages would burn CPU time while the caller sleeps
+    double cpuStart = cpuSeconds();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    double idle = cpuSeconds() - cpuStart;
+    std::cout << "     idle stages used " << idle << " s of CPU time in 0.3 s\n";
+    passed &= report("stages sleep between runs", idle < 0.05);
+
+    return passed ? 0 : 1;
+}
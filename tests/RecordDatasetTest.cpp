@@ -0,0 +1,179 @@
+#include "data/RecordDataset.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <unistd.h>
+
+// Decodes a synthetic CIFAR-100 style data set split over two files with one and with several
+// threads, and compares the pixels, labels and channel statistics with values computed here; then
+// checks that formats with negative offsets or a label inside the pixels, and normalization with a
+// zero standard deviation, are rejected.
+
+namespace {
+
+const int fileHeaderBytes = 3;
+const std::vector<size_t> recordsPerFile = {23, 14};
+// The pixels are stored as floats, the statistics as doubles
+const double pixelTolerance = 1e-6;
+const double statisticsTolerance = 1e-12;
+
+bool report(const std::string& name, bool passed) {
+    std::cout << (passed ? "ok   " : "FAIL ") << name << "\n";
+    return passed;
+}
+
+std::string tempPath(const std::string& name) {
+    return "/tmp/CNNcppTest-" + std::to_string(getpid()) + "." + name;
+}
+
+// CIFAR-100 records, shrunk to 3x5x4 images and with a header in front of each file
+RecordFormat testFormat() {
+    RecordFormat format = RecordFormat::cifar100(true);
+    format.fileHeaderBytes = fileHeaderBytes;
+    format.height = 5;
+    format.width = 4;
+    return format;
+}
+
+struct Expected {
+    std::vector<std::vector<uint8_t>> pixels;
+    std::vector<int> labels;
+    ChannelStatistics statistics;
+};
+
+// Writes the files and returns what they hold. Every channel gets its own offset, so the channel
+// statistics differ.
+Expected writeFiles(const std::vector<std::string>& paths, const RecordFormat& format) {
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> label(0, format.numClasses - 1);
+    size_t planeSize = static_cast<size_t>(format.height) * format.width;
+
+    Expected expected;
+    for (size_t f = 0; f < paths.size(); ++f) {
+        std::ofstream file(paths[f], std::ios::binary);
+        std::vector<uint8_t> header(fileHeaderBytes, 0xAB);
+        file.write(reinterpret_cast<const char*>(header.data()), header.size());
+        for (size_t r = 0; r < recordsPerFile[f]; ++r) {
+            std::vector<uint8_t> record(format.recordSize());
+            // The coarse label the fine-label format skips
+            record[0] = 0xFF;
+            record[format.labelOffset] = static_cast<uint8_t>(label(gen));
+            std::vector<uint8_t> pixels(format.pixelCount());
+            for (size_t p = 0; p < pixels.size(); ++p) {
+                pixels[p] = static_cast<uint8_t>(std::min(255, byte(gen) / 2 + 40 * static_cast<int>(p / planeSize)));
+            }
+            std::copy(pixels.begin(), pixels.end(), record.begin() + format.pixelOffset);
+            file.write(reinterpret_cast<const char*>(record.data()), record.size());
+            expected.labels.push_back(record[format.labelOffset]);
+            expected.pixels.push_back(pixels);
+        }
+    }
+
+    for (int c = 0; c < format.depth; ++c) {
+        double sum = 0.0;
+        double squareSum = 0.0;
+        for (const auto& pixels : expected.pixels) {
+            for (size_t p = c * planeSize; p < (c + 1) * planeSize; ++p) {
+                sum += pixels[p] / 255.0;
+                squareSum += (pixels[p] / 255.0) * (pixels[p] / 255.0);
+            }
+        }
+        double count = static_cast<double>(expected.pixels.size() * planeSize);
+        double mean = sum / count;
+        expected.statistics.mean.push_back(mean);
+        expected.statistics.stddev.push_back(std::sqrt(squareSum / count - mean * mean));
+    }
+    return expected;
+}
+
+// Whether the decoded data set holds the expected labels, pixels (standardized by normalization if
+// given) and statistics of the unnormalized pixels.
+bool matches(const RecordDataset& dataset, const Expected& expected, const RecordFormat& format, const ChannelStatistics* normalization) {
+    if (dataset.size() != expected.labels.size()) {
+        return false;
+    }
+    size_t planeSize = static_cast<size_t>(format.height) * format.width;
+    for (size_t i = 0; i < dataset.size(); ++i) {
+        if (dataset.getLabel(i) != expected.labels[i]) {
+            return false;
+        }
+        const float* pixels = dataset.getPixels(i);
+        for (size_t p = 0; p < format.pixelCount(); ++p) {
+            double value = expected.pixels[i][p] / 255.0;
+            if (normalization) {
+                size_t c = p / planeSize;
+                value = (value - normalization->mean[c]) / normalization->stddev[c];
+            }
+            if (std::fabs(pixels[p] - value) > pixelTolerance) {
+                return false;
+            }
+        }
+    }
+    for (int c = 0; c < format.depth; ++c) {
+        if (std::fabs(dataset.getStatistics().mean[c] - expected.statistics.mean[c]) > statisticsTolerance ||
+            std::fabs(dataset.getStatistics().stddev[c] - expected.statistics.stddev[c]) > statisticsTolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Action>
+bool throwsInvalidArgument(Action action) {
+    try {
+        action();
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+    RecordFormat format = testFormat();
+    std::vector<std::string> paths = {tempPath("records0.bin"), tempPath("records1.bin")};
+    Expected expected = writeFiles(paths, format);
+
+    ChannelStatistics supplied;
+    supplied.mean = {0.2, 0.4, 0.6};
+    supplied.stddev = {0.5, 0.25, 2.0};
+    // More threads than the first file has records, so some ranges span both files
+    for (int numThreads : {1, 4, 29}) {
+        std::string threads = " with " + std::to_string(numThreads) + (numThreads == 1 ? " thread" : " threads");
+        passed &= report("decoded pixels, labels and statistics match" + threads,
+                         matches(RecordDataset::read(paths, format, numThreads, false), expected, format, nullptr));
+        passed &= report("pixels are standardized with their own statistics" + threads,
+                         matches(RecordDataset::read(paths, format, numThreads, true), expected, format, &expected.statistics));
+        passed &= report("pixels are standardized with supplied statistics" + threads,
+                         matches(RecordDataset::read(paths, format, numThreads, supplied), expected, format, &supplied));
+    }
+
+    RecordFormat negativeHeader = format;
+    negativeHeader.fileHeaderBytes = -1;
+    RecordFormat negativeLabel = format;
+    negativeLabel.labelOffset = -1;
+    RecordFormat negativePixels = format;
+    negativePixels.pixelOffset = -2;
+    RecordFormat labelInPixels = format;
+    labelInPixels.labelOffset = labelInPixels.pixelOffset + 7;
+    passed &= report("a negative file header size is rejected", throwsInvalidArgument([&] { RecordDataset::read(paths, negativeHeader, 2, false); }));
+    passed &= report("a negative label offset is rejected", throwsInvalidArgument([&] { RecordDataset::read(paths, negativeLabel, 2, false); }));
+    passed &= report("a negative pixel offset is rejected", throwsInvalidArgument([&] { RecordDataset::read(paths, negativePixels, 2, false); }));
+    passed &= report("a label inside the pixels is rejected", throwsInvalidArgument([&] { RecordDataset::read(paths, labelInPixels, 2, false); }));
+
+    ChannelStatistics zeroStddev = supplied;
+    zeroStddev.stddev[1] = 0.0;
+    passed &= report("a zero standard deviation is rejected", throwsInvalidArgument([&] { RecordDataset::read(paths, format, 2, zeroStddev); }));
+
+    for (const auto& path : paths) {
+        std::remove(path.c_str());
+    }
+    return passed ? 0 : 1;
+}
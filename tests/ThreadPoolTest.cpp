@@ -0,0 +1,87 @@
+#include "utils/ThreadPool.h"
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// Checks that parallelFor covers its range exactly once, also when nested, and that an exception
+// thrown by a chunk reaches the caller after the loop's other tasks have drained.
+
+namespace {
+
+bool report(const std::string& name, bool passed) {
+    std::cout << (passed ? "ok   " : "FAIL ") << name << "\n";
+    return passed;
+}
+
+bool coversRange(ThreadPool& pool) {
+    std::vector<std::atomic<int>> counts(10000);
+    pool.parallelFor(0, counts.size(), 7, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            counts[i].fetch_add(1);
+        }
+    });
+    for (const auto& count : counts) {
+        if (count.load() != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool nestedCoversRange(ThreadPool& pool) {
+    std::vector<std::atomic<int>> counts(64 * 64);
+    pool.parallelFor(0, 64, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            pool.parallelFor(0, 64, 4, [&](size_t innerBegin, size_t innerEnd) {
+                for (size_t j = innerBegin; j < innerEnd; ++j) {
+                    counts[i * 64 + j].fetch_add(1);
+                }
+            });
+        }
+    });
+    for (const auto& count : counts) {
+        if (count.load() != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool propagatesException(ThreadPool& pool) {
+    std::atomic<int> running{0};
+    bool caught = false;
+    try {
+        pool.parallelFor(0, 1000, 1, [&](size_t begin, size_t end) {
+            running.fetch_add(1);
+            if (begin <= 500 && 500 < end) {
+                running.fetch_sub(1);
+                throw std::runtime_error("chunk 500");
+            }
+            std::this_thread::yield();
+            running.fetch_sub(1);
+        });
+    } catch (const std::runtime_error& e) {
+        caught = std::string(e.what()) == "chunk 500";
+    }
+    // No chunk may still be running once parallelFor has returned or thrown
+    return caught && running.load() == 0;
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+    for (int threads : {0, 1, 4}) {
+        ThreadPool pool(threads, false);
+        std::string suffix = " with " + std::to_string(threads) + " workers";
+        passed &= report("covers the range" + suffix, coversRange(pool));
+        passed &= report("nested loops cover the range" + suffix, nestedCoversRange(pool));
+        bool rethrows = true;
+        for (int run = 0; run < 20 && rethrows; ++run) {
+            rethrows = propagatesException(pool);
+        }
+        passed &= report("rethrows a chunk's exception" + suffix, rethrows);
+        passed &= report("is usable after an exception" + suffix, coversRange(pool));
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include "cnn/CNN.h"
+#include "cnn/MNISTReader.h"
+#include "distributed/GradientSynchronizer.h"
+#include "distributed/SharedMemoryTransport.h"
+#include "distributed/SocketTransport.h"
+#include "layers/FlattenLayer.h"
+#include "layers/FullyConnectedLayer.h"
+#include "layers/SoftmaxLayer.h"
+#include "utils/activationFunctions/ELU.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Data-parallel MNIST training on one host.
+//   CNNdistributed <worldSize> [shm|socket]                 forks and runs all ranks
+//   CNNdistributed <worldSize> <shm|socket> <rank> <jobName> runs a single rank
+
+namespace {
+
+int runRank(int rank, int worldSize, const std::string& backend, const std::string& jobName) {
+    try {
+        std::shared_ptr<Transport> transport;
+        if (backend == "shm") {
+            transport = std::make_shared<SharedMemoryTransport>(rank, worldSize, jobName);
+        } else if (backend == "socket") {
+            transport = std::make_shared<SocketTransport>(rank, worldSize, "/tmp", jobName);
+        } else {
+            std::cerr << "Unknown backend: " << backend << "\n";
+            return 1;
+        }
+        GradientSynchronizer synchronizer(transport);
+
+        CNN cnn(0.02, {1, 28, 28});
+        cnn.addLayer(std::make_shared<FlattenLayer>());
+        cnn.addLayer(std::make_shared<FullyConnectedLayer>(60, std::make_shared<ELU>(1.0)));
+        cnn.addLayer(std::make_shared<FullyConnectedLayer>(10, std::make_shared<ELU>(1.0)));
+        cnn.addLayer(std::make_shared<SoftmaxLayer>());
+        if (rank == 0) {
+            cnn.printNetworkSummary();
+        }
+
+        auto trainDataset = MNISTReader::readMNISTData("../data/train-images.idx3-ubyte", "../data/train-labels.idx1-ubyte");
+        auto testDataset = MNISTReader::readMNISTData("../data/t10k-images.idx3-ubyte", "../data/t10k-labels.idx1-ubyte");
+
+        cnn.SGD(trainDataset, 30, 32, testDataset, synchronizer);
+    } catch (const std::exception& e) {
+        std::cerr << "Rank " << rank << ": " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <worldSize> [shm|socket] [rank jobName]\n";
+        return 1;
+    }
+    int worldSize = std::stoi(argv[1]);
+    std::string backend = argc > 2 ? argv[2] : "shm";
+
+    if (argc > 4) {
+        return runRank(std::stoi(argv[3]), worldSize, backend, argv[4]);
+    }
+
+    std::string jobName = "CNNcpp-" + std::to_string(getpid());
+    std::vector<pid_t> children;
+    for (int rank = 0; rank < worldSize; ++rank) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int status = runRank(rank, worldSize, backend, jobName);
+            std::cout.flush();
+            _exit(status);
+        }
+        if (pid < 0) {
+            std::cerr << "Failed to fork rank " << rank << "\n";
+            return 1;
+        }
+        children.push_back(pid);
+    }
+
+    int failures = 0;
+    for (pid_t pid : children) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,508 @@
+#include "cnn/CNN.h"
+#include "interfaces/ParameterizedLayer.h"
+#include "utils/Serialization.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Compiles a trained network file into a standalone C++ translation unit: parameters become
+// aligned constexpr arrays and every layer becomes a fixed-shape function, so inference needs no
+// library, heap allocation, virtual dispatch or model loading. Batch normalization is folded into
+// the preceding layer first where possible.
+//   CNNcodegen <network> <output.cpp> [--namespace name] [--reference file [samples]]
+// With --reference, random inputs and their CNN::forward outputs are written to file; building the
+// generated source with -DCNNCPP_GENERATED_SELFTEST gives a program that checks predict against it.
+
+namespace {
+
+struct Activation {
+    std::string type;
+    double alpha = 0.0;
+};
+
+Activation readActivation(std::istream& stream) {
+    Activation activation;
+    activation.type = Serialization::readString(stream);
+    if (activation.type == "ELU") {
+        activation.alpha = Serialization::readDouble(stream);
+    } else if (activation.type != "ReLU" && activation.type != "Identity") {
+        throw std::runtime_error("Unsupported activation function: " + activation.type);
+    }
+    return activation;
+}
+
+int product(const std::vector<int>& shape) {
+    int size = 1;
+    for (int dim : shape) {
+        size *= dim;
+    }
+    return size;
+}
+
+// Depth, height and width of a shape, treating a flat vector as 1x1xN like the nested tensors do.
+void spatialDims(const std::vector<int>& shape, int& depth, int& height, int& width) {
+    if (shape.size() == 3) {
+        depth = shape[0];
+        height = shape[1];
+        width = shape[2];
+    } else {
+        depth = 1;
+        height = 1;
+        width = product(shape);
+    }
+}
+
+std::string literal(double value) {
+    if (!std::isfinite(value)) {
+        throw std::runtime_error("Network contains a non-finite parameter.");
+    }
+    std::ostringstream stream;
+    stream << std::setprecision(17) << value;
+    std::string text = stream.str();
+    if (text.find_first_of(".e") == std::string::npos) {
+        text += ".0";
+    }
+    return text;
+}
+
+class CodeGenerator {
+public:
+    CodeGenerator(CNN& network, std::string nameSpace) : network(network), nameSpace(std::move(nameSpace)) {}
+
+    void generate(std::ostream& out) {
+        std::ostringstream parameters;
+        std::ostringstream functions;
+        std::vector<int> computeLayers;
+        size_t bufferSize = 1;
+
+        for (size_t index = 0; index < network.getLayerCount(); ++index) {
+            std::ostringstream description;
+            network.getLayer(index)->save(description);
+            std::istringstream stream(description.str());
+            std::string type = Serialization::readString(stream);
+            const auto& inputShape = network.getLayerInputShape(index);
+            const auto& outputShape = network.getLayerOutputShape(index);
+
+            // Flatten is a no-op: the generated layout is already [depth][height][width] row-major.
+            if (type == "FlattenLayer") {
+                continue;
+            }
+            std::string name = "layer" + std::to_string(index);
+            if (type == "ConvolutionalLayer") {
+                emitConvolution(name, stream, index, inputShape, outputShape, parameters, functions);
+            } else if (type == "DepthwiseConvolutionalLayer") {
+                emitDepthwiseConvolution(name, stream, index, inputShape, outputShape, parameters, functions);
+            } else if (type == "FullyConnectedLayer") {
+                emitFullyConnected(name, stream, index, inputShape, outputShape, parameters, functions);
+            } else if (type == "BatchNormLayer") {
+                emitBatchNorm(name, stream, index, inputShape, parameters, functions);
+            } else if (type == "MaxPoolingLayer") {
+                emitMaxPooling(name, Serialization::readInt(stream), inputShape, outputShape, functions);
+            } else if (type == "SoftmaxLayer") {
+                emitSoftmax(name, outputShape, functions);
+            } else {
+                throw std::runtime_error("Code generation does not support " + type);
+            }
+            computeLayers.push_back(static_cast<int>(index));
+            bufferSize = std::max<size_t>(bufferSize, product(outputShape));
+        }
+
+        int inputSize = product(network.getInputShape());
+        int outputSize = network.getLayerCount() == 0 ? inputSize : product(network.getLayerOutputShape(network.getLayerCount() - 1));
+
+        out << "// Generated by CNNcodegen; do not edit.\n"
+            << "#include <algorithm>\n#include <cmath>\n#include <cstring>\n\n"
+            << "namespace " << nameSpace << " {\n\n"
+            << "constexpr int inputSize = " << inputSize << ";\n"
+            << "constexpr int outputSize = " << outputSize << ";\n\n"
+            << "namespace {\n\n"
+            << parameters.str()
+            << functions.str()
+            << "} // namespace\n\n";
+
+        out << "// Runs the network on input[inputSize] (depth, height, width row-major) into output[outputSize].\n"
+            << "// Reentrant per thread; the intermediate buffers are thread_local.\n"
+            << "void predict(const double* input, double* output) {\n";
+        if (computeLayers.empty()) {
+            out << "    std::memcpy(output, input, sizeof(double) * inputSize);\n";
+        } else {
+            out << "    alignas(64) static thread_local double buffers[2][" << bufferSize << "];\n";
+            std::string source = "input";
+            for (size_t i = 0; i < computeLayers.size(); ++i) {
+                std::string target = i + 1 == computeLayers.size() ? "output" : "buffers[" + std::to_string(i % 2) + "]";
+                out << "    layer" << computeLayers[i] << "(" << source << ", " << target << ");\n";
+                source = target;
+            }
+        }
+        out << "}\n\n"
+            << "} // namespace " << nameSpace << "\n";
+
+        emitSelfTest(out);
+    }
+
+private:
+    CNN& network;
+    std::string nameSpace;
+
+    std::vector<double> readParameters(size_t index) {
+        auto paramLayer = std::dynamic_pointer_cast<ParameterizedLayer>(network.getLayer(index));
+        std::vector<double> values(paramLayer->getParameterCount());
+        paramLayer->readParameters(values.data());
+        return values;
+    }
+
+    static void emitArray(std::ostream& out, const std::string& name, const double* values, size_t count) {
+        out << "alignas(64) constexpr double " << name << "[" << count << "] = {";
+        for (size_t i = 0; i < count; ++i) {
+            out << (i % 4 == 0 ? "\n    " : " ") << literal(values[i]) << ",";
+        }
+        out << "\n};\n\n";
+    }
+
+    static void emitActivation(std::ostream& out, const std::string& name, const Activation& activation) {
+        out << "inline double " << name << "_activate(double x) {\n";
+        if (activation.type == "ReLU") {
+            out << "    return std::max(0.0, x);\n";
+        } else if (activation.type == "Identity") {
+            out << "    return x;\n";
+        } else {
+            out << "    return x > 0 ? x : " << literal(activation.alpha) << " * (std::exp(x) - 1);\n";
+        }
+        out << "}\n\n";
+    }
+
+    void emitConvolution(const std::string& name, std::istream& stream, size_t index,
+                         const std::vector<int>& inputShape, const std::vector<int>& outputShape,
+                         std::ostream& parameters, std::ostream& out) {
+        int filterSize = Serialization::readInt(stream);
+        int numFilters = Serialization::readInt(stream);
+        int stride = Serialization::readInt(stream);
+        int padding = Serialization::readInt(stream);
+        int dilation = Serialization::readInt(stream);
+        int groups = Serialization::readInt(stream);
+        Activation activation = readActivation(stream);
+
+        std::vector<double> values = readParameters(index);
+        size_t weightCount = values.size() - numFilters;
+        emitArray(parameters, name + "_weights", values.data(), weightCount);
+        emitArray(parameters, name + "_biases", values.data() + weightCount, numFilters);
+        emitActivation(out, name, activation);
+
+        int paddedHeight = inputShape[1] + 2 * padding;
+        int paddedWidth = inputShape[2] + 2 * padding;
+        out << "void " << name << "(const double* __restrict in, double* __restrict out) {\n"
+            << "    constexpr int C = " << inputShape[0] << ", H = " << inputShape[1] << ", W = " << inputShape[2] << ";\n"
+            << "    constexpr int PH = " << paddedHeight << ", PW = " << paddedWidth << ", P = " << padding << ";\n"
+            << "    constexpr int F = " << numFilters << ", OH = " << outputShape[1] << ", OW = " << outputShape[2] << ";\n"
+            << "    constexpr int S = " << stride << ", CPG = " << inputShape[0] / groups << ", FPG = " << numFilters / groups << ";\n";
+        if (padding > 0) {
+            // The border is never written, so the zero-initialized halo survives between calls.
+            out << "    alignas(64) static thread_local double padded[C * PH * PW];\n"
+                << "    for (int c = 0; c < C; ++c)\n"
+                << "        for (int y = 0; y < H; ++y)\n"
+                << "            std::memcpy(padded + (c * PH + y + P) * PW + P, in + (c * H + y) * W, sizeof(double) * W);\n"
+                << "    const double* source = padded;\n";
+        } else {
+            out << "    (void)H; (void)W; (void)P;\n"
+                << "    const double* source = in;\n";
+        }
+        out << "    for (int f = 0; f < F; ++f) {\n"
+            << "        const double* group = source + (f / FPG) * CPG * PH * PW;\n"
+            << "        for (int y = 0; y < OH; ++y) {\n"
+            << "            for (int x = 0; x < OW; ++x) {\n"
+            << "                double sum = " << name << "_biases[f];\n"
+            << "                for (int d = 0; d < CPG; ++d) {\n"
+            << "                    const double* p = group + (d * PH + y * S) * PW + x * S;\n"
+            << "                    const double* w = " << name << "_weights + (f * CPG + d) * " << filterSize * filterSize << ";\n";
+        for (int i = 0; i < filterSize; ++i) {
+            for (int j = 0; j < filterSize; ++j) {
+                out << "                    sum += p[" << i * dilation * paddedWidth + j * dilation << "] * w[" << i * filterSize + j << "];\n";
+            }
+        }
+        out << "                }\n"
+            << "                out[(f * OH + y) * OW + x] = " << name << "_activate(sum);\n"
+            << "            }\n"
+            << "        }\n"
+            << "    }\n"
+            << "}\n\n";
+    }
+
+    void emitDepthwiseConvolution(const std::string& name, std::istream& stream, size_t index,
+                                  const std::vector<int>& inputShape, const std::vector<int>& outputShape,
+                                  std::ostream& parameters, std::ostream& out) {
+        int filterSize = Serialization::readInt(stream);
+        int stride = Serialization::readInt(stream);
+        Activation activation = readActivation(stream);
+
+        int channels = inputShape[0];
+        std::vector<double> values = readParameters(index);
+        size_t weightCount = values.size() - channels;
+        emitArray(parameters, name + "_weights", values.data(), weightCount);
+        emitArray(parameters, name + "_biases", values.data() + weightCount, channels);
+        emitActivation(out, name, activation);
+
+        out << "void " << name << "(const double* __restrict in, double* __restrict out) {\n"
+            << "    constexpr int C = " << channels << ", H = " << inputShape[1] << ", W = " << inputShape[2] << ";\n"
+            << "    constexpr int OH = " << outputShape[1] << ", OW = " << outputShape[2] << ", S = " << stride << ";\n"
+            << "    for (int c = 0; c < C; ++c) {\n"
+            << "        const double* w = " << name << "_weights + c * " << filterSize * filterSize << ";\n"
+            << "        for (int y = 0; y < OH; ++y) {\n"
+            << "            for (int x = 0; x < OW; ++x) {\n"
+            << "                const double* p = in + (c * H + y * S) * W + x * S;\n"
+            << "                double sum = " << name << "_biases[c];\n";
+        for (int i = 0; i < filterSize; ++i) {
+            for (int j = 0; j < filterSize; ++j) {
+                out << "                sum += p[" << i * inputShape[2] + j << "] * w[" << i * filterSize + j << "];\n";
+            }
+        }
+        out << "                out[(c * OH + y) * OW + x] = " << name << "_activate(sum);\n"
+            << "            }\n"
+            << "        }\n"
+            << "    }\n"
+            << "}\n\n";
+    }
+
+    void emitFullyConnected(const std::string& name, std::istream& stream, size_t index,
+                            const std::vector<int>& inputShape, const std::vector<int>& outputShape,
+                            std::ostream& parameters, std::ostream& out) {
+        Serialization::readInt(stream);
+        Activation activation = readActivation(stream);
+
+        int inputs = product(inputShape);
+        int outputs = outputShape[0];
+        std::vector<double> values = readParameters(index);
+
+        // Stored as [input][output]; transpose so each output is a contiguous dot product.
+        std::vector<double> transposed(static_cast<size_t>(inputs) * outputs);
+        for (int i = 0; i < inputs; ++i) {
+            for (int j = 0; j < outputs; ++j) {
+                transposed[static_cast<size_t>(j) * inputs + i] = values[static_cast<size_t>(i) * outputs + j];
+            }
+        }
+        emitArray(parameters, name + "_weights", transposed.data(), transposed.size());
+        emitArray(parameters, name + "_biases", values.data() + transposed.size(), outputs);
+        emitActivation(out, name, activation);
+
+        out << "void " << name << "(const double* __restrict in, double* __restrict out) {\n"
+            << "    constexpr int N = " << inputs << ", M = " << outputs << ";\n"
+            << "    for (int j = 0; j < M; ++j) {\n"
+            << "        const double* w = " << name << "_weights + j * N;\n"
+            << "        double sum = 0.0;\n"
+            << "        for (int i = 0; i < N; ++i) {\n"
+            << "            sum += in[i] * w[i];\n"
+            << "        }\n"
+            << "        out[j] = " << name << "_activate(sum + " << name << "_biases[j]);\n"
+            << "    }\n"
+            << "}\n\n";
+    }
+
+    // Only batch normalization that CNN::foldBatchNormalization could not merge reaches here.
+    void emitBatchNorm(const std::string& name, std::istream& stream, size_t index,
+                       const std::vector<int>& inputShape, std::ostream& parameters, std::ostream& out) {
+        Serialization::readDouble(stream);
+        double epsilon = Serialization::readDouble(stream);
+        Activation activation = readActivation(stream);
+        int channels = Serialization::readInt(stream);
+        std::vector<double> mean(channels);
+        std::vector<double> variance(channels);
+        Serialization::readDoubles(stream, mean.data(), channels);
+        Serialization::readDoubles(stream, variance.data(), channels);
+
+        std::vector<double> values = readParameters(index);
+        std::vector<double> scale(channels);
+        std::vector<double> shift(channels);
+        for (int c = 0; c < channels; ++c) {
+            scale[c] = values[c] / std::sqrt(variance[c] + epsilon);
+            shift[c] = values[channels + c] - mean[c] * scale[c];
+        }
+        emitArray(parameters, name + "_scale", scale.data(), channels);
+        emitArray(parameters, name + "_shift", shift.data(), channels);
+        emitActivation(out, name, activation);
+
+        // Flat inputs are normalized per feature, otherwise per channel.
+        int plane = inputShape.size() == 3 ? inputShape[1] * inputShape[2] : 1;
+        out << "void " << name << "(const double* __restrict in, double* __restrict out) {\n"
+            << "    constexpr int C = " << channels << ", PLANE = " << plane << ";\n"
+            << "    for (int c = 0; c < C; ++c) {\n"
+            << "        for (int k = 0; k < PLANE; ++k) {\n"
+            << "            out[c * PLANE + k] = " << name << "_activate(" << name << "_scale[c] * in[c * PLANE + k] + " << name << "_shift[c]);\n"
+            << "        }\n"
+            << "    }\n"
+            << "}\n\n";
+    }
+
+    static void emitMaxPooling(const std::string& name, int poolSize,
+                               const std::vector<int>& inputShape, const std::vector<int>& outputShape, std::ostream& out) {
+        int depth = 0, height = 0, width = 0;
+        spatialDims(inputShape, depth, height, width);
+        out << "void " << name << "(const double* __restrict in, double* __restrict out) {\n"
+            << "    constexpr int C = " << depth << ", H = " << height << ", W = " << width << ";\n"
+            << "    constexpr int OH = " << outputShape[1] << ", OW = " << outputShape[2] << ", K = " << poolSize << ";\n"
+            << "    (void)H;\n"
+            << "    for (int c = 0; c < C; ++c) {\n"
+            << "        for (int y = 0; y < OH; ++y) {\n"
+            << "            for (int x = 0; x < OW; ++x) {\n"
+            << "                const double* p = in + (c * H + y * K) * W + x * K;\n"
+            << "                double maxValue = p[0];\n";
+        for (int i = 0; i < poolSize; ++i) {
+            for (int j = 0; j < poolSize; ++j) {
+                out << "                maxValue = std::max(maxValue, p[" << i * width + j << "]);\n";
+            }
+        }
+        out << "                out[(c * OH + y) * OW + x] = maxValue;\n"
+            << "            }\n"
+            << "        }\n"
+            << "    }\n"
+            << "}\n\n";
+    }
+
+    static void emitSoftmax(const std::string& name, const std::vector<int>& outputShape, std::ostream& out) {
+        out << "void " << name << "(const double* __restrict in, double* __restrict out) {\n"
+            << "    constexpr int N = " << outputShape[0] << ";\n"
+            << "    double maxValue = *std::max_element(in, in + N);\n"
+            << "    double sum = 0.0;\n"
+            << "    for (int i = 0; i < N; ++i) {\n"
+            << "        out[i] = std::exp(in[i] - maxValue);\n"
+            << "        sum += out[i];\n"
+            << "    }\n"
+            << "    for (int i = 0; i < N; ++i) {\n"
+            << "        out[i] /= sum;\n"
+            << "    }\n"
+            << "}\n\n";
+    }
+
+    void emitSelfTest(std::ostream& out) const {
+        out << "\n#ifdef CNNCPP_GENERATED_SELFTEST\n"
+            << "#include <cstdint>\n#include <cstdio>\n#include <cstdlib>\n#include <vector>\n\n"
+            << "// Checks predict against a reference file written by CNNcodegen --reference:\n"
+            << "// int32 count, int32 inputSize, int32 outputSize, then count (input, output) pairs of doubles.\n"
+            << "int main(int argc, char* argv[]) {\n"
+            << "    if (argc < 2) {\n"
+            << "        std::fprintf(stderr, \"Usage: %s <reference> [tolerance]\\n\", argv[0]);\n"
+            << "        return 2;\n"
+            << "    }\n"
+            << "    double tolerance = argc > 2 ? std::atof(argv[2]) : 1e-9;\n"
+            << "    std::FILE* file = std::fopen(argv[1], \"rb\");\n"
+            << "    int32_t header[3] = {};\n"
+            << "    if (!file || std::fread(header, sizeof(int32_t), 3, file) != 3 || header[1] != " << nameSpace << "::inputSize || header[2] != " << nameSpace << "::outputSize) {\n"
+            << "        std::fprintf(stderr, \"Missing or mismatched reference file.\\n\");\n"
+            << "        return 2;\n"
+            << "    }\n"
+            << "    std::vector<double> input(" << nameSpace << "::inputSize), expected(" << nameSpace << "::outputSize), output(" << nameSpace << "::outputSize);\n"
+            << "    double maxError = 0.0;\n"
+            << "    for (int32_t n = 0; n < header[0]; ++n) {\n"
+            << "        if (std::fread(input.data(), sizeof(double), input.size(), file) != input.size() ||\n"
+            << "            std::fread(expected.data(), sizeof(double), expected.size(), file) != expected.size()) {\n"
+            << "            std::fprintf(stderr, \"Truncated reference file.\\n\");\n"
+            << "            return 2;\n"
+            << "        }\n"
+            << "        " << nameSpace << "::predict(input.data(), output.data());\n"
+            << "        for (size_t i = 0; i < output.size(); ++i) {\n"
+            << "            maxError = std::max(maxError, std::fabs(output[i] - expected[i]) / std::max(1.0, std::fabs(expected[i])));\n"
+            << "        }\n"
+            << "    }\n"
+            << "    std::fclose(file);\n"
+            << "    std::printf(\"%d samples, max error %g\\n\", static_cast<int>(header[0]), maxError);\n"
+            << "    return maxError <= tolerance ? 0 : 1;\n"
+            << "}\n"
+            << "#endif // CNNCPP_GENERATED_SELFTEST\n";
+    }
+};
+
+void writeReference(CNN& network, const std::string& filePath, int samples) {
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open reference file: " + filePath);
+    }
+    int depth = 0, height = 0, width = 0;
+    spatialDims(network.getInputShape(), depth, height, width);
+    int32_t header[3] = {samples, depth * height * width, 0};
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::vector<double> flatInput(header[1]);
+    std::vector<double> flatOutput;
+    std::ostringstream body;
+    for (int n = 0; n < samples; ++n) {
+        std::vector<std::vector<std::vector<double>>> input(depth, std::vector<std::vector<double>>(height, std::vector<double>(width)));
+        size_t k = 0;
+        for (auto& channel : input) {
+            for (auto& row : channel) {
+                for (auto& value : row) {
+                    value = dist(gen);
+                    flatInput[k++] = value;
+                }
+            }
+        }
+        flatOutput.clear();
+        for (const auto& channel : network.forward(input)) {
+            for (const auto& row : channel) {
+                flatOutput.insert(flatOutput.end(), row.begin(), row.end());
+            }
+        }
+        header[2] = static_cast<int32_t>(flatOutput.size());
+        body.write(reinterpret_cast<const char*>(flatInput.data()), sizeof(double) * flatInput.size());
+        body.write(reinterpret_cast<const char*>(flatOutput.data()), sizeof(double) * flatOutput.size());
+    }
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file << body.str();
+    if (!file) {
+        throw std::runtime_error("Failed to write reference file: " + filePath);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <network> <output.cpp> [--namespace name] [--reference file [samples]]\n";
+        return 1;
+    }
+    std::string nameSpace = "cnnGenerated";
+    std::string referencePath;
+    int referenceSamples = 16;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--namespace" && i + 1 < argc) {
+            nameSpace = argv[++i];
+        } else if (arg == "--reference" && i + 1 < argc) {
+            referencePath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                referenceSamples = std::stoi(argv[++i]);
+            }
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    try {
+        // The reference comes from the network as loaded, so it also checks the folding
+        CNN network = CNN::loadNetwork(argv[1]);
+        CNN folded = network.clone();
+        folded.foldBatchNormalization();
+        std::ofstream output(argv[2]);
+        if (!output.is_open()) {
+            throw std::runtime_error(std::string("Failed to open output file: ") + argv[2]);
+        }
+        CodeGenerator(folded, nameSpace).generate(output);
+        if (!output) {
+            throw std::runtime_error(std::string("Failed to write output file: ") + argv[2]);
+        }
+        if (!referencePath.empty()) {
+            writeReference(network, referencePath, referenceSamples);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "data/ChunkedDataset.h"
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// Converts an IDX image/label file pair (the MNIST format) into a chunked dataset file,
+// streaming one sample at a time so the input never has to fit in memory.
+//   CNNidxconvert <images.idx> <labels.idx> <output> [samplesPerChunk] [numClasses]
+
+namespace {
+
+int32_t readBigEndianInt(std::ifstream& stream) {
+    uint8_t bytes[4] = {};
+    stream.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+    if (!stream) {
+        throw std::runtime_error("Truncated IDX header.");
+    }
+    return static_cast<int32_t>((uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3]);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <images.idx> <labels.idx> <output> [samplesPerChunk] [numClasses]\n";
+        return 1;
+    }
+    int samplesPerChunk = argc > 4 ? std::stoi(argv[4]) : 1024;
+    int numClasses = argc > 5 ? std::stoi(argv[5]) : 10;
+
+    try {
+        std::ifstream images(argv[1], std::ios::binary);
+        std::ifstream labels(argv[2], std::ios::binary);
+        if (!images.is_open() || !labels.is_open()) {
+            throw std::runtime_error("Failed to open IDX files.");
+        }
+
+        // Unsigned byte data: images are [count][rows][columns], labels are [count].
+        if (readBigEndianInt(images) != 0x00000803 || readBigEndianInt(labels) != 0x00000801) {
+            throw std::runtime_error("Expected an unsigned byte IDX image file and label file.");
+        }
+        int32_t count = readBigEndianInt(images);
+        int32_t rows = readBigEndianInt(images);
+        int32_t columns = readBigEndianInt(images);
+        if (readBigEndianInt(labels) != count) {
+            throw std::runtime_error("Number of images and labels do not match.");
+        }
+
+        ChunkedDatasetWriter writer(argv[3], 1, rows, columns, numClasses, samplesPerChunk);
+        std::vector<uint8_t> pixels(static_cast<size_t>(rows) * columns);
+        for (int32_t i = 0; i < count; ++i) {
+            uint8_t label = 0;
+            images.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
+            labels.read(reinterpret_cast<char*>(&label), sizeof(label));
+            if (!images || !labels) {
+                throw std::runtime_error("IDX files are shorter than their headers claim.");
+            }
+            writer.addSample(pixels.data(), label);
+        }
+        writer.close();
+        std::cout << "Wrote " << count << " samples of " << rows << "x" << columns << " in chunks of " << samplesPerChunk << " to " << argv[3] << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
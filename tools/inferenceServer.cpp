@@ -0,0 +1,53 @@
+#include "cnn/CNN.h"
+#include "serving/InferenceServer.h"
+#include <csignal>
+#include <pthread.h>
+
+// Serves a saved network over a Unix domain socket until SIGINT/SIGTERM, then prints stats.
+//   CNNserver <modelFile> <socketPath> [maxBatchSize] [maxWaitMicros] [workers]
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <modelFile> <socketPath> [maxBatchSize] [maxWaitMicros] [workers]\n";
+        return 1;
+    }
+
+    InferenceServerConfig config;
+    if (argc > 3) config.maxBatchSize = std::stoi(argv[3]);
+    if (argc > 4) config.maxWait = std::chrono::microseconds(std::stoi(argv[4]));
+    config.numWorkers = argc > 5 ? std::stoi(argv[5]) : std::max(1u, std::thread::hardware_concurrency());
+
+    // Block the shutdown signals before any thread starts so only the waiter below receives them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+        CNN cnn = CNN::loadNetwork(argv[1]);
+        if (cnn.getLayerCount() == 0) {
+            std::cerr << "No network loaded from " << argv[1] << "\n";
+            return 1;
+        }
+        cnn.foldBatchNormalization();
+        cnn.printNetworkSummary();
+
+        InferenceServer server(cnn, config);
+        std::thread signalWaiter([&server, &signals] {
+            int signal = 0;
+            sigwait(&signals, &signal);
+            server.stop();
+        });
+        signalWaiter.detach();
+
+        std::cout << "Serving on " << argv[2] << " (max batch " << config.maxBatchSize << ", max wait "
+                  << config.maxWait.count() << " us, " << config.numWorkers << " workers)" << std::endl;
+        server.run(argv[2]);
+        std::cout << server.getStats().report();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "serving/InferenceClient.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+
+// Closed-loop load generator for CNNserver: every connection sends its next request as soon as
+// the previous response arrives. Prints client-side throughput and latency, then the server stats.
+//   CNNloadgen <socketPath> [connections] [requestsPerConnection]
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <socketPath> [connections] [requestsPerConnection]\n";
+        return 1;
+    }
+    std::string socketPath = argv[1];
+    int connections = argc > 2 ? std::stoi(argv[2]) : 16;
+    int requests = argc > 3 ? std::stoi(argv[3]) : 1000;
+
+    try {
+        auto shape = InferenceClient(socketPath).getInputShape();
+        size_t inputSize = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+
+        std::vector<std::vector<double>> latencies(connections);
+        // An exception escaping a thread would terminate the process, so each connection keeps
+        // its own error for the report after the join
+        std::vector<std::string> errors(connections);
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (int c = 0; c < connections; ++c) {
+            threads.emplace_back([&, c] {
+                try {
+                    InferenceClient client(socketPath);
+                    std::mt19937 gen(c);
+                    std::uniform_real_distribution<> pixel(0.0, 1.0);
+                    std::vector<double> input(inputSize);
+                    for (int r = 0; r < requests; ++r) {
+                        std::generate(input.begin(), input.end(), [&] { return pixel(gen); });
+                        auto sent = std::chrono::steady_clock::now();
+                        client.infer(input);
+                        latencies[c].push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+                    }
+                } catch (const std::exception& e) {
+                    errors[c] = e.what();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        int failed = 0;
+        for (int c = 0; c < connections; ++c) {
+            if (!errors[c].empty()) {
+                std::cerr << "Connection " << c << " failed after " << latencies[c].size() << " requests: " << errors[c] << "\n";
+                ++failed;
+            }
+        }
+        if (failed > 0) {
+            std::cerr << failed << " of " << connections << " connections failed\n";
+            return 1;
+        }
+
+        std::vector<double> all;
+        for (const auto& perConnection : latencies) {
+            all.insert(all.end(), perConnection.begin(), perConnection.end());
+        }
+        std::sort(all.begin(), all.end());
+        std::cout << connections << " connections x " << requests << " requests: " << all.size() / seconds << " requests/sec\n";
+        if (!all.empty()) {
+            std::cout << "Client latency (us):";
+            for (double percentile : {50.0, 90.0, 99.0, 99.9}) {
+                size_t index = std::min(all.size() - 1, static_cast<size_t>(percentile / 100.0 * all.size()));
+                std::cout << " p" << percentile << "=" << all[index];
+            }
+            std::cout << "\n";
+        }
+        std::cout << "\nServer stats:\n" << InferenceClient(socketPath).getStats();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}